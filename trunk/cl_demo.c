@@ -24,9 +24,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "ghost/demosummary.h"
 #include <time.h>	// easyrecord stats
 
-#ifdef _WIN32
 #include "movie.h"
-#else
+#ifndef _WIN32
 #include "errno.h"
 #endif
 
@@ -45,6 +44,24 @@ static qboolean	dz_playback = false;
 qboolean	dz_unpacking = false;
 static	void CheckDZipCompletion ();
 static	void StopDZPlayback ();
+static	void CL_AddTimeDemoFrame (void);
+static	void CL_StopDemoWriter (void);
+
+static	double	td_lastrealtime;
+
+// Recorded messages go into a ring buffer that a thread of its own writes to
+// the demo file, so a slow disk doesn't stall the frame loop. The writer is
+// woken once half of the buffer is used or DEMO_FLUSH_TIME has passed, which
+// bounds what a crash can lose.
+#define	DEMO_BUFSIZE		(1 << 18)	// must hold more than a MAX_MSGLEN message
+#define	DEMO_FLUSH_TIME		1.0
+
+static	byte			demo_buf[DEMO_BUFSIZE];
+static	unsigned int	demo_buf_head, demo_buf_tail;	// bytes queued and written so far
+static	void			*demo_writer;
+static	void			*demo_mutex, *demo_wake_cond, *demo_space_cond;
+static	qboolean		demo_wake, demo_writer_quit;
+static	double			demo_lastwake;
 
 // joe: support for recording demos after connecting to the server
 byte	demo_head[3][MAX_MSGLEN];
@@ -65,16 +82,39 @@ read from the demo file.
 ==============================================================================
 */
 
+static void CL_Benchmark_f (void);
+
+cvar_t	benchmark_runs = {"benchmark_runs", "3"};
+cvar_t	benchmark_warmup = {"benchmark_warmup", "1"};
+cvar_t	benchmark_file = {"benchmark_file", "joequake/benchmark.csv"};
+cvar_t	benchmark_baseline = {"benchmark_baseline", ""};
+cvar_t	benchmark_tolerance = {"benchmark_tolerance", "3"};	// percent
+cvar_t	benchmark_quit = {"benchmark_quit", "0"};
+
 void CL_InitDemo (void)
 {
 	DZip_Init(&dzCtx, NULL);
 	DZip_Cleanup(&dzCtx);
+
+	Cvar_Register (&benchmark_runs);
+	Cvar_Register (&benchmark_warmup);
+	Cvar_Register (&benchmark_file);
+	Cvar_Register (&benchmark_baseline);
+	Cvar_Register (&benchmark_tolerance);
+	Cvar_Register (&benchmark_quit);
+
+	demo_mutex = Sys_CreateMutex ();
+	demo_wake_cond = Sys_CreateCond ();
+	demo_space_cond = Sys_CreateCond ();
+
+	Cmd_AddCommand ("benchmark", CL_Benchmark_f);
 }
 
 
 void CL_ShutdownDemo (void)
 {
 	DZip_Cleanup(&dzCtx);
+	CL_StopDemoWriter ();
 }
 
 
@@ -123,12 +163,109 @@ void CL_StopPlayback (void)
 	if (cls.timedemo)
 		CL_FinishTimeDemo ();
 
-#ifdef _WIN32
 	Movie_StopPlayback ();
-#endif
 
 }
 
+static int CL_DemoWriterThread (void *unused)
+{
+	unsigned int	start, end, ofs, size;
+	qboolean		quit;
+
+	while (1)
+	{
+		Sys_LockMutex (demo_mutex);
+		while (!demo_wake && !demo_writer_quit)
+			Sys_CondWait (demo_wake_cond, demo_mutex);
+		demo_wake = false;
+		quit = demo_writer_quit;
+		start = demo_buf_tail;
+		end = demo_buf_head;
+		Sys_UnlockMutex (demo_mutex);
+
+		// the main thread only appends past end, so this part is ours
+		if (start != end)
+		{
+			ofs = start % DEMO_BUFSIZE;
+			size = min(end - start, DEMO_BUFSIZE - ofs);
+			fwrite (demo_buf + ofs, 1, size, cls.demofile);
+			if (end - start > size)
+				fwrite (demo_buf, 1, end - start - size, cls.demofile);
+			fflush (cls.demofile);
+		}
+
+		Sys_LockMutex (demo_mutex);
+		demo_buf_tail = end;
+		Sys_CondBroadcast (demo_space_cond);
+		Sys_UnlockMutex (demo_mutex);
+
+		// only leave once everything queued has been written
+		if (quit && start == end)
+			break;
+	}
+
+	return 0;
+}
+
+static void CL_StartDemoWriter (void)
+{
+	demo_buf_head = demo_buf_tail = 0;
+	demo_wake = demo_writer_quit = false;
+	demo_lastwake = realtime;
+	demo_writer = Sys_CreateThread (CL_DemoWriterThread, NULL);
+}
+
+// writes out everything that's queued and waits for the writer to exit
+static void CL_StopDemoWriter (void)
+{
+	if (!demo_writer)
+		return;
+
+	Sys_LockMutex (demo_mutex);
+	demo_writer_quit = true;
+	Sys_CondSignal (demo_wake_cond);
+	Sys_UnlockMutex (demo_mutex);
+
+	Sys_WaitThread (demo_writer);
+	demo_writer = NULL;
+}
+
+/*
+====================
+CL_FlushDemo
+
+Waits until everything recorded so far is in the demo file
+====================
+*/
+void CL_FlushDemo (void)
+{
+	if (!demo_writer)
+		return;
+
+	Sys_LockMutex (demo_mutex);
+	demo_wake = true;
+	Sys_CondSignal (demo_wake_cond);
+	while (demo_buf_tail != demo_buf_head)
+		Sys_CondWait (demo_space_cond, demo_mutex);
+	Sys_UnlockMutex (demo_mutex);
+
+	demo_lastwake = realtime;
+}
+
+// copies into the free part of the ring at head, which the writer doesn't
+// see until the new head is published
+static unsigned int CL_QueueDemoData (unsigned int head, void *data, unsigned int size)
+{
+	unsigned int	ofs, part;
+
+	ofs = head % DEMO_BUFSIZE;
+	part = min(size, DEMO_BUFSIZE - ofs);
+	memcpy (demo_buf + ofs, data, part);
+	memcpy (demo_buf, (byte *)data + part, size - part);
+
+	return head + size;
+}
+
 /*
 ====================
 CL_WriteDemoMessage
@@ -140,16 +277,39 @@ void CL_WriteDemoMessage (void)
 {
 	int	i, len;
 	float	f;
+	unsigned int	head;
 
+	Sys_LockMutex (demo_mutex);
+	while (DEMO_BUFSIZE - (demo_buf_head - demo_buf_tail) < net_message.cursize + 16)
+	{
+		// the disk can't keep up, wait for it
+		demo_wake = true;
+		Sys_CondSignal (demo_wake_cond);
+		Sys_CondWait (demo_space_cond, demo_mutex);
+	}
+	head = demo_buf_head;
+	Sys_UnlockMutex (demo_mutex);
+
+	// only this thread moves the head, so the copies don't need the lock
 	len = LittleLong (net_message.cursize);
-	fwrite (&len, 4, 1, cls.demofile);
+	head = CL_QueueDemoData (head, &len, 4);
 	for (i=0 ; i<3 ; i++)
 	{
 		f = LittleFloat (cl.viewangles[i]);
-		fwrite (&f, 4, 1, cls.demofile);
+		head = CL_QueueDemoData (head, &f, 4);
+	}
+	head = CL_QueueDemoData (head, net_message.data, net_message.cursize);
+
+	// publishing the whole message under the lock makes the copies visible to the writer
+	Sys_LockMutex (demo_mutex);
+	demo_buf_head = head;
+	if (demo_buf_head - demo_buf_tail >= DEMO_BUFSIZE / 2 || realtime - demo_lastwake >= DEMO_FLUSH_TIME)
+	{
+		demo_wake = true;
+		demo_lastwake = realtime;
+		Sys_CondSignal (demo_wake_cond);
 	}
-	fwrite (net_message.data, net_message.cursize, 1, cls.demofile);
-	fflush (cls.demofile);
+	Sys_UnlockMutex (demo_mutex);
 }
 
 void PushFrameposEntry (long fbaz)
@@ -265,7 +425,9 @@ int CL_GetMessage (void)
 				// if this is the second frame, grab the real td_starttime
 				// so the bogus time on the first frame doesn't count
 				if (host_framecount == cls.td_startframe + 1)
-					cls.td_starttime = realtime;
+					cls.td_starttime = td_lastrealtime = realtime;
+				else if (host_framecount > cls.td_startframe + 1)
+					CL_AddTimeDemoFrame ();
 			}
 			// modified by joe to handle rewind playing
 			else if (seek_time < 0 && !cl_demorewind.value && cl.ctime <= cl.mtime[0])
@@ -370,6 +532,7 @@ void CL_Stop_f (void)
 	CL_WriteDemoMessage ();
 
 // finish up
+	CL_StopDemoWriter ();
 	fclose (cls.demofile);
 	cls.demofile = NULL;
 	cls.demorecording = false;
@@ -479,6 +642,7 @@ void CL_Record_f (void)
 	fprintf (cls.demofile, "%i\n", cls.forcetrack);
 
 	cls.demorecording = true;
+	CL_StartDemoWriter ();
 
 	// joe: initialize the demo file if we're already connected
 	if (c < 3 && cls.state == ca_connected)
@@ -905,6 +1069,314 @@ void CL_DemoSeek_f (void)
 	seek_was_backwards = seek_backwards = (seek_time <= cl.mtime[0]);
 }
 
+/*
+==============================================================================
+
+BENCHMARK
+
+Runs timedemo on a list of demos, each benchmark_warmup times unmeasured
+and then benchmark_runs times measured, and writes one line of statistics
+per demo to benchmark_file. The statistics of the measured frames are:
+
+mean, stddev	of the average fps of the runs
+low1, low01		average fps of the slowest 1% and 0.1% of the frames
+min, max		fps of the slowest and the fastest frame
+
+When benchmark_baseline names an earlier results file, the demos are
+compared with it, and a drop of the mean or 1% low fps by more than
+benchmark_tolerance percent is reported as a regression.
+
+==============================================================================
+*/
+
+typedef struct
+{
+	char	demo[MAX_QPATH];
+	int		frames;
+	float	mean, stddev, low1, low01, min, max;
+} benchresult_t;
+
+static	float		*td_frametimes;		// of the current timedemo
+static	int			td_numframes, td_maxframes;
+
+static	char		**bench_demos;
+static	int			bench_numdemos, bench_demo, bench_run;
+static	int			bench_runs, bench_warmup;	// the cvars when the benchmark started
+static	float		*bench_frametimes;	// of all measured runs of the current demo
+static	int			bench_numframes, bench_maxframes;
+static	float		*bench_runfps;
+static	benchresult_t	*bench_results;
+
+static void CL_AddTimeDemoFrame (void)
+{
+	if (td_numframes == td_maxframes)
+	{
+		td_maxframes = max(td_maxframes * 2, 4096);
+		td_frametimes = Q_realloc (td_frametimes, td_maxframes * sizeof(float));
+	}
+
+	td_frametimes[td_numframes++] = realtime - td_lastrealtime;
+	td_lastrealtime = realtime;
+}
+
+static int CL_CompareFrameTimes (const void *a, const void *b)
+{
+	float	fa = *(const float *)a, fb = *(const float *)b;
+
+	// slowest first
+	return (fa < fb) - (fa > fb);
+}
+
+// average fps of the slowest fraction of the sorted frames
+static float CL_BenchmarkLowFPS (float fraction)
+{
+	int		i, count;
+	double	time = 0;
+
+	count = max((int)(bench_numframes * fraction), 1);
+	for (i = 0 ; i < count ; i++)
+		time += bench_frametimes[i];
+
+	return time > 0 ? count / time : 0;
+}
+
+static void CL_BenchmarkResult (benchresult_t *res)
+{
+	int		i, runs = bench_runs;
+	double	sum = 0, var = 0;
+
+	for (i = 0 ; i < runs ; i++)
+		sum += bench_runfps[i];
+	res->mean = sum / runs;
+	for (i = 0 ; i < runs ; i++)
+		var += (bench_runfps[i] - res->mean) * (bench_runfps[i] - res->mean);
+	res->stddev = runs > 1 ? sqrt(var / (runs - 1)) : 0;
+
+	res->frames = bench_numframes;
+	if (!bench_numframes)
+	{
+		res->low1 = res->low01 = res->min = res->max = 0;
+		return;
+	}
+
+	qsort (bench_frametimes, bench_numframes, sizeof(float), CL_CompareFrameTimes);
+	res->low1 = CL_BenchmarkLowFPS (0.01);
+	res->low01 = CL_BenchmarkLowFPS (0.001);
+	res->min = bench_frametimes[0] > 0 ? 1 / bench_frametimes[0] : 0;
+	res->max = bench_frametimes[bench_numframes - 1] > 0 ? 1 / bench_frametimes[bench_numframes - 1] : 0;
+}
+
+static FILE *CL_OpenBenchmarkFile (char *filename, char *mode)
+{
+	char	name[MAX_OSPATH];
+	FILE	*f;
+
+	if (COM_IsAbsolutePath(filename))
+		Q_strncpyz (name, filename, sizeof(name));
+	else
+		Q_snprintfz (name, sizeof(name), "%s/%s", com_basedir, filename);
+
+	if (!(f = fopen(name, mode)) && mode[0] == 'w')
+	{
+		COM_CreatePath (name);
+		f = fopen (name, mode);
+	}
+
+	return f;
+}
+
+static void CL_WriteBenchmark (void)
+{
+	int		i;
+	FILE	*f;
+	benchresult_t	*res;
+
+	if (!(f = CL_OpenBenchmarkFile(benchmark_file.string, "wt")))
+	{
+		Con_Printf ("ERROR: Couldn't open %s\n", benchmark_file.string);
+		return;
+	}
+
+	fprintf (f, "demo,runs,frames,mean,stddev,low1,low01,min,max\n");
+	for (i = 0, res = bench_results ; i < bench_numdemos ; i++, res++)
+		fprintf (f, "%s,%i,%i,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n", res->demo, bench_runs, res->frames,
+			res->mean, res->stddev, res->low1, res->low01, res->min, res->max);
+	fclose (f);
+
+	Con_Printf ("Wrote %s\n", benchmark_file.string);
+}
+
+static void CL_CompareBenchmark (void)
+{
+	int		i, regressions = 0;
+	char	line[1024], demo[MAX_QPATH];
+	float	mean, low1, dmean, dlow1;
+	FILE	*f;
+	benchresult_t	*res;
+
+	if (!(f = CL_OpenBenchmarkFile(benchmark_baseline.string, "rt")))
+	{
+		Con_Printf ("ERROR: Couldn't open %s\n", benchmark_baseline.string);
+		return;
+	}
+
+	Con_Printf ("\ncompared with %s:\n", benchmark_baseline.string);
+	while (fgets(line, sizeof(line), f))
+	{
+		if (sscanf(line, "%63[^,],%*d,%*d,%f,%*f,%f", demo, &mean, &low1) != 3)
+			continue;		// the header
+
+		for (i = 0, res = bench_results ; i < bench_numdemos ; i++, res++)
+		{
+			if (strcmp(res->demo, demo) || mean <= 0 || low1 <= 0)
+				continue;
+
+			dmean = (res->mean - mean) * 100 / mean;
+			dlow1 = (res->low1 - low1) * 100 / low1;
+			Con_Printf ("%-20s mean %+6.1f%%  1%% low %+6.1f%%", demo, dmean, dlow1);
+			if (dmean < -benchmark_tolerance.value || dlow1 < -benchmark_tolerance.value)
+			{
+				Con_Printf ("  REGRESSION");
+				regressions++;
+			}
+			Con_Printf ("\n");
+		}
+	}
+	fclose (f);
+
+	Con_Printf ("%i regression%s\n", regressions, regressions == 1 ? "" : "s");
+}
+
+static void CL_ClearBenchmark (void)
+{
+	int	i;
+
+	for (i = 0 ; i < bench_numdemos ; i++)
+		free (bench_demos[i]);
+	free (bench_demos);
+	free (bench_frametimes);
+	free (bench_runfps);
+	free (bench_results);
+	bench_demos = NULL;
+	bench_frametimes = bench_runfps = NULL;
+	bench_results = NULL;
+	bench_numdemos = bench_demo = bench_run = 0;
+	bench_numframes = bench_maxframes = 0;
+}
+
+static void CL_FinishBenchmark (void)
+{
+	int		i;
+	benchresult_t	*res;
+
+	Con_Printf ("\n%-20s %8s %8s %8s %8s %8s %8s\n", "demo", "mean", "stddev", "1% low", "0.1% low", "min", "max");
+	for (i = 0, res = bench_results ; i < bench_numdemos ; i++, res++)
+		Con_Printf ("%-20s %8.1f %8.2f %8.1f %8.1f %8.1f %8.1f\n", res->demo, res->mean, res->stddev, res->low1, res->low01, res->min, res->max);
+
+	CL_WriteBenchmark ();
+	if (benchmark_baseline.string[0])
+		CL_CompareBenchmark ();
+
+	CL_ClearBenchmark ();
+
+	// "quit" would wait for cl_confirmquit with nobody there to answer
+	if (benchmark_quit.value)
+		Host_Quit ();
+}
+
+// called when a timedemo of the benchmark couldn't start playing its demo
+static void CL_AbortBenchmark (void)
+{
+	Con_Printf ("ERROR: couldn't play %s, benchmark aborted\n", bench_demos[bench_demo]);
+
+	CL_ClearBenchmark ();
+
+	if (benchmark_quit.value)
+		Host_Quit ();
+}
+
+// called when a timedemo of the benchmark has finished
+static void CL_NextBenchmarkRun (float fps)
+{
+	int		warmup = bench_warmup, runs = bench_runs;
+
+	if (bench_run >= warmup)
+	{
+		bench_runfps[bench_run - warmup] = fps;
+
+		if (bench_numframes + td_numframes > bench_maxframes)
+		{
+			bench_maxframes = max(bench_maxframes * 2, bench_numframes + td_numframes);
+			bench_frametimes = Q_realloc (bench_frametimes, bench_maxframes * sizeof(float));
+		}
+		memcpy (bench_frametimes + bench_numframes, td_frametimes, td_numframes * sizeof(float));
+		bench_numframes += td_numframes;
+	}
+
+	if (++bench_run == warmup + runs)
+	{
+		CL_BenchmarkResult (&bench_results[bench_demo]);
+		bench_numframes = 0;
+		bench_run = 0;
+
+		if (++bench_demo == bench_numdemos)
+		{
+			CL_FinishBenchmark ();
+			return;
+		}
+	}
+
+	Cbuf_AddText (va("timedemo \"%s\"\n", bench_demos[bench_demo]));
+}
+
+/*
+====================
+CL_Benchmark_f
+
+benchmark <demoname> [demoname ...]
+====================
+*/
+static void CL_Benchmark_f (void)
+{
+	int		i;
+
+	if (cmd_source != src_command)
+		return;
+
+	if (Cmd_Argc() < 2)
+	{
+		Con_Printf ("benchmark <demoname> [...] : runs timedemo benchmark_warmup + benchmark_runs times on each demo\n");
+		return;
+	}
+
+	// dzip unpacks in the background and doesn't report when that fails
+	for (i = 1 ; i < Cmd_Argc() ; i++)
+	{
+		if (strlen(Cmd_Argv(i)) > 3 && !Q_strcasecmp(Cmd_Argv(i) + strlen(Cmd_Argv(i)) - 3, ".dz"))
+		{
+			Con_Printf ("ERROR: can't benchmark %s, unpack it first\n", Cmd_Argv(i));
+			return;
+		}
+	}
+
+	CL_ClearBenchmark ();
+
+	bench_runs = max((int)benchmark_runs.value, 1);
+	bench_warmup = max((int)benchmark_warmup.value, 0);
+
+	bench_numdemos = Cmd_Argc() - 1;
+	bench_demos = Q_malloc (bench_numdemos * sizeof(char *));
+	bench_results = Q_calloc (bench_numdemos, sizeof(benchresult_t));
+	bench_runfps = Q_malloc (bench_runs * sizeof(float));
+	for (i = 0 ; i < bench_numdemos ; i++)
+	{
+		bench_demos[i] = Q_strdup (Cmd_Argv(i + 1));
+		Q_strncpyz (bench_results[i].demo, COM_SkipPath(bench_demos[i]), sizeof(bench_results[i].demo));
+	}
+
+	Cbuf_AddText (va("timedemo \"%s\"\n", bench_demos[0]));
+}
+
 /*
 ====================
 CL_FinishTimeDemo
@@ -923,6 +1395,9 @@ void CL_FinishTimeDemo (void)
 	if (!time)
 		time = 1;
 	Con_Printf ("%i frames %5.1f seconds %5.1f fps\n", frames, time, frames/time);
+
+	if (bench_demos)
+		CL_NextBenchmarkRun (frames / time);
 }
 
 /*
@@ -944,12 +1419,20 @@ void CL_TimeDemo_f (void)
 	}
 
 	CL_PlayDemo_f ();
+
+	// a benchmark would wait forever for this one to finish
+	if (bench_demos && !cls.demoplayback)
+	{
+		CL_AbortBenchmark ();
+		return;
+	}
 	
 // cls.td_starttime will be grabbed at the second frame of the demo, so
 // all the loading time doesn't get counted
 	cls.timedemo = true;
 	cls.td_startframe = host_framecount;
 	cls.td_lastframe = -1;		// get a new message this frame
+	td_numframes = 0;
 }
 
 static char quakechars[8*16] = {
@@ -397,6 +397,9 @@ void CL_ParseServerInfo (void)
 
 	Con_DPrintf ("\nServerinfo packet received\n");
 
+// get the previous level on disk before loading the next one
+	CL_FlushDemo ();
+
 // wipe the client_state_t struct
 	CL_ClearState ();
 
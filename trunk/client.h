@@ -447,6 +447,7 @@ void CL_StopPlayback (void);
 int CL_GetMessage (void);
 void CL_Stop_f (void);
 void CL_Record_f (void);
+void CL_FlushDemo (void);
 void CL_PlayDemo_f (void);
 void CL_DemoSkip_f (void);
 void CL_DemoSeek_f (void);
@@ -1334,6 +1334,24 @@ char	com_netpath[MAX_OSPATH];
 
 filetype_t com_filetype;
 
+// precompressed GPU textures come first, and only when the caller can
+// upload them
+qboolean com_compressedimages = false;
+
+#define	NUM_COMPRESSED_IMAGETYPES	2
+
+static struct
+{
+	char		*extension;
+	filetype_t	type;
+} com_imagetypes[] = {
+	{".dds", image_DDS},
+	{".ktx", image_KTX},
+	{".tga", image_TGA},
+	{".png", image_PNG},
+	{".jpg", image_JPG}
+};
+
 // on disk
 typedef struct
 {
@@ -1596,91 +1614,56 @@ Sets com_filesize and one of handle or file
 */
 int COM_FOpenFile (char *filename, FILE **file)
 {
-	qboolean image = false;
+	int		i, first, numtypes;
 	searchpath_t *search;
 
 	com_filesize = -1;
 	com_netpath[0] = 0;
 
+	// an image is looked for in every format it can come in
 	if (!strcmp(COM_FileExtension(filename), "tga"))
 	{
-		image = true;
+		first = com_compressedimages ? 0 : NUM_COMPRESSED_IMAGETYPES;
+		numtypes = sizeof(com_imagetypes) / sizeof(com_imagetypes[0]);
+	}
+	else
+	{
+		first = numtypes = 0;
 	}
 
 	// search through the path, one element at a time
 	for (search = com_searchpaths ; search ; search = search->next)
 	{
-		if (image)
-		{
-			com_filetype = image_TGA;
-			COM_ForceExtension(filename, ".tga");
-		}
-
-		// is the element a pak file?
-		if (search->pack)
+		i = first;
+		do
 		{
-			if (SearchFileInPak(filename, file, search) != -1)
+			if (i < numtypes)
 			{
-				return com_filesize;
+				com_filetype = com_imagetypes[i].type;
+				COM_ForceExtension (filename, com_imagetypes[i].extension);
 			}
 
-			// try to search for various types of image
-			if (image)
+			// is the element a pak file?
+			if (search->pack)
 			{
-				com_filetype = image_PNG;
-				COM_ForceExtension(filename, ".png");
 				if (SearchFileInPak(filename, file, search) != -1)
-				{
-					return com_filesize;
-				}
-
-				com_filetype = image_JPG;
-				COM_ForceExtension(filename, ".jpg");
-				if (SearchFileInPak(filename, file, search) != -1)
-				{
 					return com_filesize;
-				}
 			}
-		}
-		else
-		{               
-			// check a file in the directory tree
-			Q_snprintfz (com_netpath, sizeof(com_netpath), "%s/%s", search->filename, filename);
-
-			if (!(*file = fopen(com_netpath, "rb")))
+			else
 			{
-				// try to search for various types of image
-				if (image)
-				{
-					com_filetype = image_PNG;
-					COM_ForceExtension(filename, ".png");
-					Q_snprintfz (com_netpath, sizeof(com_netpath), "%s/%s", search->filename, filename);
+				// check a file in the directory tree
+				Q_snprintfz (com_netpath, sizeof(com_netpath), "%s/%s", search->filename, filename);
 
-					if (!(*file = fopen(com_netpath, "rb")))
-					{
-						com_filetype = image_JPG;
-						COM_ForceExtension(filename, ".jpg");
-						Q_snprintfz (com_netpath, sizeof(com_netpath), "%s/%s", search->filename, filename);
-
-						if (!(*file = fopen(com_netpath, "rb")))
-						{
-							continue;
-						}
-					}
-				}
-				else
+				if ((*file = fopen(com_netpath, "rb")))
 				{
-					continue;
+					if (developer.value)
+						Sys_Printf ("FOpenFile: %s\n", com_netpath);
+
+					com_filesize = COM_FileLength (*file);
+					return com_filesize;
 				}
 			}
-
-			if (developer.value)
-				Sys_Printf ("FOpenFile: %s\n", com_netpath);
-
-			com_filesize = COM_FileLength (*file);
-			return com_filesize;
-		}
-		
+		} while (++i < numtypes);
 	}
 
 	if (developer.value)
@@ -240,9 +240,10 @@ size_t LOC_Format(const char *format, const char* (*getarg_fn)(int idx, void* us
 extern	int		com_filesize;
 extern	char	com_netpath[MAX_OSPATH];
 
-typedef enum { image_TGA, image_PNG, image_JPG, other } filetype_t;
+typedef enum { image_TGA, image_PNG, image_JPG, image_DDS, image_KTX, other } filetype_t;
 
 extern	filetype_t com_filetype;
+extern	qboolean com_compressedimages;
 
 struct	cache_user_s;
 
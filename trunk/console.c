@@ -391,6 +391,12 @@ void Con_Printf (char *fmt, ...)
 	vsnprintf (msg, sizeof(msg), fmt, argptr);
 	va_end (argptr);
 
+	if (!Tasks_IsMainThread())
+	{
+		Tasks_DeferPrint (msg);
+		return;
+	}
+
 	// also echo to debugging console
 	Sys_Printf ("%s", msg);
 
@@ -26,13 +26,20 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define ABSOLUTE_MAX_DECALS		32768
 #define MAX_DECAL_VERTICES		128
 #define MAX_DECAL_TRIANGLES		64
+#define MAX_DECAL_RINGS			8
+#define DECAL_RING_VERTICES		32768
 
 typedef struct decal_s
 {
 	vec3_t		origin;
 	vec3_t		normal;
 	vec3_t		tangent;
+	vec3_t		binormal;
 	float		radius;
+	float		width, height;
+
+	// left, right, bottom, top, back and front clip planes
+	plane_t		planes[6];
 
 	struct decal_s	*next;
 	float		die;
@@ -43,19 +50,52 @@ typedef struct decal_s
 
 	int			texture;
 
-	// geometry of decal
+	// where the triangles went in the ring of the texture
+	int			ring, firstvert, numverts;
+
+	// geometry of decal, written by the clipping task
 	int			vertexCount, triangleCount;
 	vec3_t		vertexArray[MAX_DECAL_VERTICES];
 	float		texcoordArray[MAX_DECAL_VERTICES][2];
 	int			triangleArray[MAX_DECAL_TRIANGLES][3];
 } decal_t;
 
+typedef struct
+{
+	float		xyz[3];
+	float		st[2];
+} decalvert_t;
+
+// Clipped decals of one texture are expanded to triangles and appended to
+// a ring of vertexes, which lives in a buffer object where available. The
+// decals share a lifetime so the live ones form one span of the ring, dead
+// and distant ones inside it get a zero color
+typedef struct
+{
+	int			texture;
+	int			head;		// next vertex to write
+	int			end;		// vertexes past this were skipped when head wrapped
+	int			tail;		// oldest live vertex, found every frame
+	qboolean	visible;
+	decalvert_t	*verts;
+	byte		(*colors)[4];
+	GLuint		vbo, colorvbo;
+} decalring_t;
+
 int		decal_blood1, decal_blood2, decal_blood3, decal_q3blood, decal_burn, decal_mark, decal_glow;
 
 static	decal_t	*decals, *active_decals, *free_decals;
 static	int		r_numdecals;
 
-static	plane_t	leftPlane, rightPlane, bottomPlane, topPlane, backPlane, frontPlane;
+// spawned decals wait on queued_decals for the next clipping task, which
+// owns clipping_decals until it's waited for
+static	decal_t	*queued_decals, *clipping_decals;
+static	task_t	*decals_task;
+static	model_t	*decals_worldmodel;
+static	qboolean	decals_discard;		// makes a task that hasn't started yet do nothing
+
+static	decalring_t	decalrings[MAX_DECAL_RINGS];
+static	int		num_decalrings;
 
 qboolean use_decals;
 
@@ -65,7 +105,7 @@ cvar_t	gl_decal_viewdistance = {"gl_decal_viewdistance", "2048"};
 void DecalClipLeaf (decal_t *dec, mleaf_t *leaf);
 void DecalWalkBsp_R (decal_t *dec, mnode_t *node);
 int DecalClipPolygonAgainstPlane (plane_t *plane, int vertexCount, vec3_t *vertex, vec3_t *newVertex);
-int DecalClipPolygon (int vertexCount, vec3_t *vertices, vec3_t *newVertex);
+int DecalClipPolygon (decal_t *dec, int vertexCount, vec3_t *vertices, vec3_t *newVertex);
 
 #define lhrandom(MIN, MAX) ((rand() & 32767) * (((MAX)-(MIN)) * (1.0f / 32767.0f)) + (MIN))
 
@@ -119,6 +159,43 @@ void R_InitDecals (void)
 	decals = Hunk_AllocName (r_numdecals * sizeof(decal_t), "decals");
 }
 
+/*
+===============
+R_WaitDecalsTask
+===============
+*/
+static void R_WaitDecalsTask (void)
+{
+	if (decals_task)
+	{
+		Task_Wait (decals_task);
+		decals_task = NULL;
+	}
+}
+
+/*
+===============
+R_FlushDecals
+
+Waits for the clipping task and throws away what it was clipping. Has to be
+called while the world it walks is still loaded
+===============
+*/
+void R_FlushDecals (void)
+{
+	decal_t	*dec, *next;
+
+	R_WaitDecalsTask ();
+
+	for (dec = clipping_decals ; dec ; dec = next)
+	{
+		next = dec->next;
+		dec->next = free_decals;
+		free_decals = dec;
+	}
+	clipping_decals = NULL;
+}
+
 /*
 ===============
 R_ClearDecals
@@ -131,19 +208,34 @@ void R_ClearDecals (void)
 	if (!qmb_initialized)
 		return;
 
+	// Host_ClearMemory has flushed the task already, the world it would
+	// walk is gone by now so don't let a leftover one run
+	decals_discard = true;
+	R_WaitDecalsTask ();
+	decals_discard = false;
+
 	memset (decals, 0, r_numdecals * sizeof(decal_t));
 	free_decals = &decals[0];
-	active_decals = NULL;
+	active_decals = queued_decals = clipping_decals = NULL;
 
 	for (i = 0 ; i < r_numdecals ; i++)
 		decals[i].next = &decals[i+1];
 	decals[r_numdecals-1].next = NULL;
+
+	for (i = 0 ; i < num_decalrings ; i++)
+		decalrings[i].head = decalrings[i].end = 0;
 }
 
+/*
+===============
+R_SpawnDecal
+
+Sets up the decal and queues it, the next clipping task fits it to the world
+===============
+*/
 void R_SpawnDecal (vec3_t center, vec3_t normal, vec3_t tangent, int tex, int size)
 {
-	int		a;
-	float	width, height, depth, d, one_over_w, one_over_h;
+	float	width, height, depth, d;
 	vec3_t	binormal, test = {0.5, 0.5, 0.5};
 	decal_t	*dec;
 
@@ -156,24 +248,27 @@ void R_SpawnDecal (vec3_t center, vec3_t normal, vec3_t tangent, int tex, int si
 
 	dec = free_decals;
 	free_decals = dec->next;
-	dec->next = active_decals;
-	active_decals = dec;
+	dec->next = queued_decals;
+	queued_decals = dec;
 
 	VectorNormalize (test);
 	CrossProduct (normal, test, tangent);
 
 	VectorCopy (center, dec->origin);
-	VectorCopy (tangent, dec->tangent);
 	VectorCopy (normal, dec->normal);
 	VectorNormalize (tangent);
 	VectorNormalize (normal);
 	CrossProduct (normal, tangent, binormal);
 	VectorNormalize (binormal);
+	VectorCopy (tangent, dec->tangent);
+	VectorCopy (binormal, dec->binormal);
 
 	//width = RandomMinMax (size * 0.5, size);
 	width = size;
 	height = width;
 	depth = width * 0.5;
+	dec->width = width;
+	dec->height = height;
 	dec->radius = max(max(width, height), depth);
 	dec->starttime = cl.time;
 	dec->die = cl.time + gl_decaltime.value;
@@ -181,59 +276,26 @@ void R_SpawnDecal (vec3_t center, vec3_t normal, vec3_t tangent, int tex, int si
 
 	// Calculate boundary planes
 	d = DotProduct (center, tangent);
-	VectorCopy (tangent, leftPlane.normal);
-	leftPlane.dist = -(width * 0.5 - d);
-	VectorNegate (tangent, tangent);
-	VectorCopy (tangent, rightPlane.normal);
-	VectorNegate (tangent, tangent);
-	rightPlane.dist = -(width * 0.5 + d);
-	
+	VectorCopy (tangent, dec->planes[0].normal);
+	dec->planes[0].dist = -(width * 0.5 - d);
+	VectorNegate (tangent, dec->planes[1].normal);
+	dec->planes[1].dist = -(width * 0.5 + d);
+
 	d = DotProduct (center, binormal);
-	VectorCopy (binormal, bottomPlane.normal);
-	bottomPlane.dist = -(height * 0.5 - d);
-	VectorNegate (binormal, binormal);
-	VectorCopy (binormal, topPlane.normal);
-	VectorNegate (binormal, binormal);
-	topPlane.dist = -(height * 0.5 + d);
-	
+	VectorCopy (binormal, dec->planes[2].normal);
+	dec->planes[2].dist = -(height * 0.5 - d);
+	VectorNegate (binormal, dec->planes[3].normal);
+	dec->planes[3].dist = -(height * 0.5 + d);
+
 	d = DotProduct (center, normal);
-	VectorCopy (normal, backPlane.normal);
-	backPlane.dist = -(depth - d);
-	VectorNegate (normal, normal);
-	VectorCopy (normal, frontPlane.normal);
-	VectorNegate (normal, normal);
-	frontPlane.dist = -(depth + d);
+	VectorCopy (normal, dec->planes[4].normal);
+	dec->planes[4].dist = -(depth - d);
+	VectorNegate (normal, dec->planes[5].normal);
+	dec->planes[5].dist = -(depth + d);
 
 	// Begin with empty mesh
 	dec->vertexCount = 0;
 	dec->triangleCount = 0;
-
-	// Clip decal to bsp
-	DecalWalkBsp_R (dec, cl.worldmodel->nodes);
-
-	// This happens when a decal is too far from any surface or the surface is too steeply sloped
-	if (dec->triangleCount == 0)
-	{	// deallocate decal
-		active_decals = dec->next;
-		dec->next = free_decals;
-		free_decals = dec;	
-		return;
-	}
-
-	// Assign texture mapping coordinates
-	one_over_w = 1.0F / width;
-	one_over_h = 1.0F / height;
-	for (a = 0 ; a < dec->vertexCount ; a++)
-	{
-		float	s, t;
-		vec3_t	v;
-
-		VectorSubtract (dec->vertexArray[a], center, v);
-		s = DotProduct (v, tangent) * one_over_w + 0.5F;
-		t = DotProduct (v, binormal) * one_over_h + 0.5F;
-		dec->texcoordArray[a][0] = s;
-		dec->texcoordArray[a][1] = t;
-	}
 }
 
 void R_SpawnDecalStatic (vec3_t org, int tex, int size)
@@ -533,34 +595,34 @@ void DecalClipLeaf (decal_t *dec, mleaf_t *leaf)
 		// avoid backfacing and ortogonal facing faces to recieve decal parts
 		if (DotProduct(dec->normal, t3) > decalEpsilon)
 		{
-			count = DecalClipPolygon (poly->numverts, newVertex, newVertex);
+			count = DecalClipPolygon (dec, poly->numverts, newVertex, newVertex);
 			if (count != 0 && !DecalAddPolygon(dec, count, newVertex))
 				break;
 		}
 	}
 }
 
-int DecalClipPolygon (int vertexCount, vec3_t *vertices, vec3_t *newVertex)
+int DecalClipPolygon (decal_t *dec, int vertexCount, vec3_t *vertices, vec3_t *newVertex)
 {
 	vec3_t	tempVertex[64];
 
 	// Clip against all six planes
-	int count = DecalClipPolygonAgainstPlane (&leftPlane, vertexCount, vertices, tempVertex);
+	int count = DecalClipPolygonAgainstPlane (&dec->planes[0], vertexCount, vertices, tempVertex);
 	if (count != 0)
 	{
-		count = DecalClipPolygonAgainstPlane (&rightPlane, count, tempVertex, newVertex);
+		count = DecalClipPolygonAgainstPlane (&dec->planes[1], count, tempVertex, newVertex);
 		if (count != 0)
 		{
-			count = DecalClipPolygonAgainstPlane (&bottomPlane, count, newVertex, tempVertex);
+			count = DecalClipPolygonAgainstPlane (&dec->planes[2], count, newVertex, tempVertex);
 			if (count != 0)
 			{
-				count = DecalClipPolygonAgainstPlane (&topPlane, count, tempVertex, newVertex);
+				count = DecalClipPolygonAgainstPlane (&dec->planes[3], count, tempVertex, newVertex);
 				if (count != 0)
 				{
-					count = DecalClipPolygonAgainstPlane (&backPlane, count, newVertex, tempVertex);
+					count = DecalClipPolygonAgainstPlane (&dec->planes[4], count, newVertex, tempVertex);
 					if (count != 0)
 					{
-						count = DecalClipPolygonAgainstPlane (&frontPlane, count, tempVertex, newVertex);
+						count = DecalClipPolygonAgainstPlane (&dec->planes[5], count, tempVertex, newVertex);
 					}
 				}
 			}
@@ -643,6 +705,254 @@ int DecalClipPolygonAgainstPlane (plane_t *plane, int vertexCount, vec3_t *verte
 	return count;
 }
 
+/*
+===============
+R_ClipDecalsTask
+
+Fits the decals on clipping_decals to the world and maps the texture onto
+them. Only reads the world and writes to the decals it was handed
+===============
+*/
+static void R_ClipDecalsTask (void *unused)
+{
+	int		a;
+	float	one_over_w, one_over_h;
+	vec3_t	v;
+	decal_t	*dec;
+
+	if (decals_discard)
+		return;
+
+	for (dec = clipping_decals ; dec ; dec = dec->next)
+	{
+		// Clip decal to bsp
+		DecalWalkBsp_R (dec, decals_worldmodel->nodes);
+
+		// Assign texture mapping coordinates
+		one_over_w = 1.0F / dec->width;
+		one_over_h = 1.0F / dec->height;
+		for (a = 0 ; a < dec->vertexCount ; a++)
+		{
+			VectorSubtract (dec->vertexArray[a], dec->origin, v);
+			dec->texcoordArray[a][0] = DotProduct (v, dec->tangent) * one_over_w + 0.5F;
+			dec->texcoordArray[a][1] = DotProduct (v, dec->binormal) * one_over_h + 0.5F;
+		}
+	}
+}
+
+/*
+===============
+R_DecalRingForTexture
+===============
+*/
+static decalring_t *R_DecalRingForTexture (int texture)
+{
+	int			i;
+	decalring_t	*ring;
+
+	for (i = 0, ring = decalrings ; i < num_decalrings ; i++, ring++)
+	{
+		if (ring->texture == texture)
+			return ring;
+	}
+
+	if (num_decalrings == MAX_DECAL_RINGS)
+		return NULL;
+
+	ring = &decalrings[num_decalrings++];
+	ring->texture = texture;
+	ring->head = ring->end = 0;
+	ring->verts = Q_malloc (DECAL_RING_VERTICES * sizeof(decalvert_t));
+	ring->colors = Q_calloc (DECAL_RING_VERTICES, sizeof(*ring->colors));
+
+	if (gl_vbo_able)
+	{
+		qglGenBuffers (1, &ring->vbo);
+		GL_BindBuffer (GL_ARRAY_BUFFER, ring->vbo);
+		qglBufferData (GL_ARRAY_BUFFER, DECAL_RING_VERTICES * sizeof(decalvert_t), NULL, GL_DYNAMIC_DRAW);
+		qglGenBuffers (1, &ring->colorvbo);
+	}
+
+	return ring;
+}
+
+/*
+===============
+R_KillRingDecals
+
+Kills the live decals with vertexes in first <= vert < last of a ring
+===============
+*/
+static void R_KillRingDecals (int ringnum, int first, int last)
+{
+	decal_t	*dec;
+
+	for (dec = active_decals ; dec ; dec = dec->next)
+	{
+		if (dec->ring == ringnum && dec->firstvert < last && dec->firstvert + dec->numverts > first)
+			dec->die = 0;
+	}
+}
+
+/*
+===============
+R_AddDecalToRing
+
+Expands the triangles of a clipped decal into the ring of its texture
+===============
+*/
+static qboolean R_AddDecalToRing (decal_t *dec)
+{
+	int			i, j, k, ringnum, numverts;
+	decalring_t	*ring;
+	decalvert_t	*v;
+
+	if (!(ring = R_DecalRingForTexture(dec->texture)))
+		return false;
+	ringnum = ring - decalrings;
+	numverts = dec->triangleCount * 3;
+
+	// anything live ahead of the head is older than the new decal
+	if (ring->head + numverts > DECAL_RING_VERTICES)
+	{
+		if (ring->head < ring->end)
+			R_KillRingDecals (ringnum, ring->head, ring->end);
+		ring->end = ring->head;
+		ring->head = 0;
+	}
+	if (ring->head < ring->end)
+		R_KillRingDecals (ringnum, ring->head, ring->head + numverts);
+
+	dec->ring = ringnum;
+	dec->firstvert = ring->head;
+	dec->numverts = numverts;
+
+	v = ring->verts + dec->firstvert;
+	for (i = 0 ; i < dec->triangleCount ; i++)
+	{
+		for (j = 0 ; j < 3 ; j++, v++)
+		{
+			k = dec->triangleArray[i][j];
+			VectorCopy (dec->vertexArray[k], v->xyz);
+			v->st[0] = dec->texcoordArray[k][0];
+			v->st[1] = dec->texcoordArray[k][1];
+		}
+	}
+
+	if (ring->vbo)
+	{
+		GL_BindBuffer (GL_ARRAY_BUFFER, ring->vbo);
+		qglBufferSubData (GL_ARRAY_BUFFER, dec->firstvert * sizeof(decalvert_t), numverts * sizeof(decalvert_t), ring->verts + dec->firstvert);
+	}
+
+	ring->head += numverts;
+	ring->end = max(ring->end, ring->head);
+
+	return true;
+}
+
+/*
+===============
+R_FinishClippedDecals
+
+Waits for the clipping task and moves what it clipped into the rings
+===============
+*/
+static void R_FinishClippedDecals (void)
+{
+	decal_t	*dec, *next;
+
+	R_WaitDecalsTask ();
+
+	for (dec = clipping_decals ; dec ; dec = next)
+	{
+		next = dec->next;
+
+		// This happens when a decal is too far from any surface or the surface is too steeply sloped
+		if (dec->triangleCount == 0 || !R_AddDecalToRing(dec))
+		{	// deallocate decal
+			dec->next = free_decals;
+			free_decals = dec;
+			continue;
+		}
+
+		dec->next = active_decals;
+		active_decals = dec;
+	}
+	clipping_decals = NULL;
+
+	if (gl_vbo_able)
+		GL_BindBuffer (GL_ARRAY_BUFFER, 0);
+}
+
+/*
+===============
+R_ClipQueuedDecals
+
+Hands the decals spawned since the last call to a worker, they show up
+once the next frame has finished them
+===============
+*/
+static void R_ClipQueuedDecals (void)
+{
+	if (!queued_decals)
+		return;
+
+	clipping_decals = queued_decals;
+	queued_decals = NULL;
+	decals_worldmodel = cl.worldmodel;
+	decals_task = Task_Submit (R_ClipDecalsTask, NULL);
+}
+
+/*
+===============
+R_DrawDecalRing
+===============
+*/
+static void R_DrawDecalRing (decalring_t *ring)
+{
+	byte	*base;
+
+	if (ring->texture == decal_q3blood)
+	{
+		glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	}
+	else
+	{
+		glBlendFunc (GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+	}
+	GL_Bind (ring->texture);
+
+	if (ring->vbo)
+	{
+		GL_BindBuffer (GL_ARRAY_BUFFER, ring->colorvbo);
+		// respecify the whole buffer so the driver doesn't wait on the last frame
+		qglBufferData (GL_ARRAY_BUFFER, ring->end * sizeof(*ring->colors), ring->colors, GL_STREAM_DRAW);
+		glColorPointer (4, GL_UNSIGNED_BYTE, 0, NULL);
+		GL_BindBuffer (GL_ARRAY_BUFFER, ring->vbo);
+		base = NULL;
+	}
+	else
+	{
+		glColorPointer (4, GL_UNSIGNED_BYTE, 0, ring->colors);
+		base = (byte *)ring->verts;
+	}
+	glVertexPointer (3, GL_FLOAT, sizeof(decalvert_t), base + offsetof(decalvert_t, xyz));
+	glTexCoordPointer (2, GL_FLOAT, sizeof(decalvert_t), base + offsetof(decalvert_t, st));
+
+	if (ring->tail < ring->head)
+	{
+		glDrawArrays (GL_TRIANGLES, ring->tail, ring->head - ring->tail);
+	}
+	else
+	{
+		// the live span wraps around the end of the ring
+		glDrawArrays (GL_TRIANGLES, ring->tail, ring->end - ring->tail);
+		if (ring->head)
+			glDrawArrays (GL_TRIANGLES, 0, ring->head);
+	}
+}
+
 /*
 ===============
 R_DrawDecals
@@ -650,100 +960,101 @@ R_DrawDecals
 */
 void R_DrawDecals (void)
 {
-	int			i;
+	int			i, age, tailage;
 	float		dcolor, scale;
+	byte		color[4], (*c)[4];
 	vec3_t		decaldist;
-	decal_t		*p, *kill;
+	decal_t		*p, **prev;
+	decalring_t	*ring;
 
 	if (!qmb_initialized)
 		return;
 
-	glEnable (GL_BLEND);
-	glEnable (GL_ALPHA_TEST);
-	glAlphaFunc (GL_GREATER, 0.000);
-	glEnable (GL_POLYGON_OFFSET_FILL);
-	glPolygonOffset (-1, -1);
-	glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-	glDepthMask (GL_FALSE);
-	glShadeModel (GL_SMOOTH);
+	R_FinishClippedDecals ();
+	R_ClipQueuedDecals ();
 
-	for ( ; ; )
+	// kill the expired ones, their vertexes are skipped from now on
+	for (prev = &active_decals ; (p = *prev) ; )
 	{
-		kill = active_decals;
-
-		if (kill && kill->die < cl.time)
+		if (p->die < cl.time)
 		{
-			active_decals = kill->next;
-			kill->next = free_decals;
-			free_decals = kill;
+			memset (decalrings[p->ring].colors + p->firstvert, 0, p->numverts * sizeof(*decalrings[0].colors));
+			*prev = p->next;
+			p->next = free_decals;
+			free_decals = p;
 			continue;
 		}
-		break;
+		prev = &p->next;
+	}
+
+	for (i = 0, ring = decalrings ; i < num_decalrings ; i++, ring++)
+	{
+		ring->tail = -1;
+		ring->visible = false;
 	}
 
 	for (p = active_decals ; p ; p = p->next)
 	{
-		for ( ; ; )
-		{
-			kill = p->next;
+		ring = &decalrings[p->ring];
 
-			if (kill && (kill->die < cl.time))
-			{
-				p->next = kill->next;
-				kill->next = free_decals;
-				free_decals = kill;
-				continue;
-			}
-			break;
-		}
+		// the live span of the ring starts at the oldest decal
+		age = (p->firstvert - ring->head + DECAL_RING_VERTICES) % DECAL_RING_VERTICES;
+		tailage = (ring->tail - ring->head + DECAL_RING_VERTICES) % DECAL_RING_VERTICES;
+		if (ring->tail < 0 || age < tailage)
+			ring->tail = p->firstvert;
 
 		VectorSubtract (r_refdef.vieworg, p->origin, decaldist);
 
-		if (VectorLength(decaldist) > gl_decal_viewdistance.value)
-			continue;
-
-		if (p->texture == decal_q3blood)
-		{
-			glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		}
-		else
-		{
-			glBlendFunc (GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
-		}
-		GL_Bind (p->texture);
-		
 		dcolor = (1 - (VectorLength(decaldist) / gl_decal_viewdistance.value));
 		scale = (p->die - cl.time) < 0.5 ? 2 * (p->die - cl.time) : 1;
-		if (p->texture == decal_q3blood)
+		if (dcolor <= 0)
 		{
-			glColor4f (0.5 * dcolor * scale, 0.1, 0.1, dcolor * scale);
+			// out of view distance, a zero color leaves the framebuffer alone
+			memset (color, 0, sizeof(color));
 		}
-		else
+		else if (p->texture == decal_q3blood)
 		{
-			glColor4f (dcolor * scale, dcolor * scale, dcolor * scale, dcolor * scale);
+			color[0] = 0.5 * dcolor * scale * 255;
+			color[1] = color[2] = 0.1 * 255;
+			color[3] = dcolor * scale * 255;
+			ring->visible = true;
 		}
-
-		for (i = 0 ; i < p->triangleCount ; i++)
+		else
 		{
-			int	i1, i2, i3;
+			color[0] = color[1] = color[2] = color[3] = dcolor * scale * 255;
+			ring->visible = true;
+		}
 
-			i1 = p->triangleArray[i][0];
-			i2 = p->triangleArray[i][1];
-			i3 = p->triangleArray[i][2];
+		for (i = 0, c = ring->colors + p->firstvert ; i < p->numverts ; i++, c++)
+			memcpy (*c, color, sizeof(color));
+	}
 
-			glBegin (GL_TRIANGLES);
-			glTexCoord2fv (&p->texcoordArray[i1][0]);
-			glVertex3fv (&p->vertexArray[i1][0]);
+	glEnable (GL_BLEND);
+	glEnable (GL_ALPHA_TEST);
+	glAlphaFunc (GL_GREATER, 0.000);
+	glEnable (GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset (-1, -1);
+	glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glDepthMask (GL_FALSE);
+	glShadeModel (GL_SMOOTH);
 
-			glTexCoord2fv (&p->texcoordArray[i2][0]);
-			glVertex3fv (&p->vertexArray[i2][0]);
+	glEnableClientState (GL_VERTEX_ARRAY);
+	glEnableClientState (GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState (GL_COLOR_ARRAY);
 
-			glTexCoord2fv (&p->texcoordArray[i3][0]);
-			glVertex3fv (&p->vertexArray[i3][0]);
-			glEnd ();
-		}				
+	for (i = 0, ring = decalrings ; i < num_decalrings ; i++, ring++)
+	{
+		if (ring->visible)
+			R_DrawDecalRing (ring);
 	}
 
+	glDisableClientState (GL_VERTEX_ARRAY);
+	glDisableClientState (GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState (GL_COLOR_ARRAY);
+	if (gl_vbo_able)
+		GL_BindBuffer (GL_ARRAY_BUFFER, 0);
+	glColor3f (1, 1, 1);
+
 	glDisable (GL_BLEND);
 	glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glDisable (GL_ALPHA_TEST);
@@ -20,6 +20,16 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // gl_draw.c -- this is the only file outside the refresh that touches the vid buffer
 
 #include "quakedef.h"
+#include "winquake.h"
+
+// the texture cache's directory listing and LRU
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <glob.h>
+#include <utime.h>
+#include <sys/stat.h>
+#endif
 
 int		texture_extension_number = 1;
 
@@ -43,6 +53,9 @@ cvar_t	gl_texture_anisotropy = { "gl_texture_anisotropy", "1", 0, OnChange_gl_te
 cvar_t	gl_externaltextures_world = {"gl_externaltextures_world", "0"};
 cvar_t	gl_externaltextures_bmodels = {"gl_externaltextures_bmodels", "0"};
 cvar_t	gl_externaltextures_models = {"gl_externaltextures_models", "0"};
+cvar_t	gl_texturecache = {"gl_texturecache", "1"};
+cvar_t	gl_texturecache_size = {"gl_texturecache_size", "256"};	// megabytes, 0 is unlimited
+cvar_t	gl_compressedtextures = {"gl_compressedtextures", "1"};
 extern qboolean OnChange_gl_externaltextures_gfx(cvar_t *var, char *string);
 cvar_t	gl_externaltextures_gfx = { "gl_externaltextures_gfx", "0", 0, OnChange_gl_externaltextures_gfx };
 
@@ -74,6 +87,7 @@ static qboolean	crosshairimage_loaded = false;
 int GL_LoadPicTexture (char *name, mpic_t *pic, byte *data);
 void Draw_InitConback(void);
 void Draw_InitCharset(void);
+static void TexCache_Clear_f (void);
 
 mpic_t	conback_data;
 mpic_t	*conback = &conback_data;
@@ -167,12 +181,15 @@ typedef struct
 	int		texmode;
 	unsigned crc;
 	int		bpp;
+	qboolean	pending;	// reserved by an image batch, not uploaded yet
 } gltexture_t;
 
 gltexture_t	gltextures[MAX_GLTEXTURES];
 int		numgltextures;
 
 int		currenttexture = -1;		// to avoid unnecessary texture sets
+
+static void GL_FlushImageJobs (void);
 
 canvastype currentcanvas = CANVAS_NONE; //johnfitz -- for GL_SetCanvas
 
@@ -779,6 +796,7 @@ void Draw_Init (void)
 	int	i;
 
 	Cmd_AddCommand ("loadcharset", Draw_LoadCharset_f);
+	Cmd_AddCommand ("texcache_clear", TexCache_Clear_f);
 
 	Cvar_Register (&gl_max_size);
 	Cvar_Register (&gl_picmip);
@@ -794,8 +812,13 @@ void Draw_Init (void)
 	Cvar_Register (&gl_externaltextures_world);
 	Cvar_Register (&gl_externaltextures_bmodels);
 	Cvar_Register (&gl_externaltextures_models);
+	Cvar_Register (&gl_texturecache);
+	Cvar_Register (&gl_texturecache_size);
+	Cvar_Register (&gl_compressedtextures);
 	Cvar_Register (&gl_externaltextures_gfx);
 
+	TexKernels_Init ();
+
 	glGetIntegerv (GL_MAX_TEXTURE_SIZE, &gl_max_size_default);
 	Cvar_SetDefault (&gl_max_size, gl_max_size_default);
 
@@ -827,6 +850,270 @@ void Draw_Init (void)
 	Draw_LoadPics();
 }
 
+/*
+=============================================================================
+
+  2D BATCHING
+
+Quads are collected with their colors and drawn when the canvas changes,
+at the end of the 2D pass, or before anything that draws on its own. A
+quad joins the most recent batch with the same texture and state unless
+something added since then overlaps it, so the result looks the same as
+drawing everything in order.
+
+=============================================================================
+*/
+
+#define	MAX_DRAW_QUADS		4096
+#define	MAX_DRAW_BATCHES	256
+#define	DRAW_LOOKBACK		16	// batches searched for a matching state
+
+#define	DRAW_BLEND		1	// blended instead of alpha tested
+#define	DRAW_HUDFILTER	2	// takes the gl_texturemode_hud filter
+
+typedef struct
+{
+	float	xy[2];
+	float	st[2];
+	byte	color[4];
+} drawvert_t;
+
+typedef struct
+{
+	int		texnum;		// 0 is untextured
+	int		flags;
+	float	mins[2], maxs[2];
+	int		firstquad, numquads;
+} drawbatch_t;
+
+static	drawvert_t	draw_verts[MAX_DRAW_QUADS*4];
+static	byte		draw_quadbatch[MAX_DRAW_QUADS];
+static	unsigned short	draw_indexes[MAX_DRAW_QUADS*6];
+static	int			draw_numquads;
+
+static	drawbatch_t	draw_batches[MAX_DRAW_BATCHES];
+static	int			draw_numbatches;
+
+static	GLuint		draw_vbo;
+
+/*
+================
+Draw_Flush
+
+Draws the queued quads, one call per batch
+================
+*/
+void Draw_Flush (void)
+{
+	int				i, j, flags, texnum;
+	unsigned short	*index;
+	byte			*base;
+	drawbatch_t		*b;
+
+	if (!draw_numquads)
+		return;
+
+	// bucket the quads by batch, keeping the order they were added in
+	for (i = 0, j = 0, b = draw_batches ; i < draw_numbatches ; i++, b++)
+	{
+		b->firstquad = j;
+		j += b->numquads;
+		b->numquads = 0;
+	}
+	for (i = 0 ; i < draw_numquads ; i++)
+	{
+		b = &draw_batches[draw_quadbatch[i]];
+		index = &draw_indexes[(b->firstquad + b->numquads++) * 6];
+		index[0] = i * 4;
+		index[1] = i * 4 + 1;
+		index[2] = i * 4 + 2;
+		index[3] = i * 4;
+		index[4] = i * 4 + 2;
+		index[5] = i * 4 + 3;
+	}
+
+	if (gl_vbo_able)
+	{
+		if (!draw_vbo)
+			qglGenBuffers (1, &draw_vbo);
+		GL_BindBuffer (GL_ARRAY_BUFFER, draw_vbo);
+		GL_BindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+		// respecify the whole buffer so the driver doesn't wait on the last batch
+		qglBufferData (GL_ARRAY_BUFFER, draw_numquads * 4 * sizeof(drawvert_t), draw_verts, GL_STREAM_DRAW);
+		base = NULL;
+	}
+	else
+	{
+		base = (byte *)draw_verts;
+	}
+
+	glEnableClientState (GL_VERTEX_ARRAY);
+	glVertexPointer (2, GL_FLOAT, sizeof(drawvert_t), base + offsetof(drawvert_t, xy));
+	glEnableClientState (GL_TEXTURE_COORD_ARRAY);
+	glTexCoordPointer (2, GL_FLOAT, sizeof(drawvert_t), base + offsetof(drawvert_t, st));
+	glEnableClientState (GL_COLOR_ARRAY);
+	glColorPointer (4, GL_UNSIGNED_BYTE, sizeof(drawvert_t), base + offsetof(drawvert_t, color));
+
+	glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// the 2D defaults, textured and alpha tested
+	texnum = -1;
+	flags = 0;
+	for (i = 0, b = draw_batches ; i < draw_numbatches ; i++, b++)
+	{
+		if (b->texnum != texnum)
+		{
+			if (!b->texnum)
+				glDisable (GL_TEXTURE_2D);
+			else if (!texnum)
+				glEnable (GL_TEXTURE_2D);
+			texnum = b->texnum;
+		}
+		if (texnum)
+		{
+			GL_Bind (texnum);
+			if (b->flags & DRAW_HUDFILTER)
+			{
+				glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter_minmax_hud);
+				glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter_minmax_hud);
+			}
+		}
+
+		if ((b->flags ^ flags) & DRAW_BLEND)
+		{
+			if (b->flags & DRAW_BLEND)
+			{
+				glDisable (GL_ALPHA_TEST);
+				glEnable (GL_BLEND);
+			}
+			else
+			{
+				glDisable (GL_BLEND);
+				glEnable (GL_ALPHA_TEST);
+			}
+		}
+		flags = b->flags;
+
+		glDrawElements (GL_TRIANGLES, b->numquads * 6, GL_UNSIGNED_SHORT, draw_indexes + b->firstquad * 6);
+	}
+
+	if (!texnum)
+		glEnable (GL_TEXTURE_2D);
+	if (flags & DRAW_BLEND)
+	{
+		glDisable (GL_BLEND);
+		glEnable (GL_ALPHA_TEST);
+	}
+	glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+	glDisableClientState (GL_VERTEX_ARRAY);
+	glDisableClientState (GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState (GL_COLOR_ARRAY);
+	glColor3ubv (color_white);
+
+	if (gl_vbo_able)
+		GL_BindBuffer (GL_ARRAY_BUFFER, 0);
+
+	draw_numquads = 0;
+	draw_numbatches = 0;
+}
+
+// color_white has no alpha, which the alpha test would throw away
+static const byte draw_opaque[4] = {255, 255, 255, 255};
+
+/*
+================
+Draw_AddQuad
+
+Queues the quad from x, y to x + w, y + h with the texture coords sl, tl
+to sh, th. color is RGBA
+================
+*/
+static void Draw_AddQuad (int texnum, int flags, float x, float y, float w, float h, float sl, float tl, float sh, float th, const byte *color)
+{
+	int			i, k;
+	float		mins[2], maxs[2];
+	drawbatch_t	*b;
+	drawvert_t	*v;
+
+	if (draw_numquads == MAX_DRAW_QUADS)
+		Draw_Flush ();
+
+	mins[0] = min(x, x + w);
+	maxs[0] = max(x, x + w);
+	mins[1] = min(y, y + h);
+	maxs[1] = max(y, y + h);
+
+	b = NULL;
+	for (i = draw_numbatches - 1 ; i >= max(0, draw_numbatches - DRAW_LOOKBACK) ; i--)
+	{
+		if (draw_batches[i].texnum == texnum && draw_batches[i].flags == flags)
+		{
+			b = &draw_batches[i];
+			break;
+		}
+
+		// the quad can't be moved under something drawn after it
+		if (mins[0] < draw_batches[i].maxs[0] && maxs[0] > draw_batches[i].mins[0] &&
+		    mins[1] < draw_batches[i].maxs[1] && maxs[1] > draw_batches[i].mins[1])
+			break;
+	}
+
+	if (b)
+	{
+		b->mins[0] = min(b->mins[0], mins[0]);
+		b->maxs[0] = max(b->maxs[0], maxs[0]);
+		b->mins[1] = min(b->mins[1], mins[1]);
+		b->maxs[1] = max(b->maxs[1], maxs[1]);
+	}
+	else
+	{
+		if (draw_numbatches == MAX_DRAW_BATCHES)
+			Draw_Flush ();
+
+		b = &draw_batches[draw_numbatches++];
+		b->texnum = texnum;
+		b->flags = flags;
+		b->mins[0] = mins[0];
+		b->maxs[0] = maxs[0];
+		b->mins[1] = mins[1];
+		b->maxs[1] = maxs[1];
+		b->numquads = 0;
+	}
+
+	b->numquads++;
+	draw_quadbatch[draw_numquads] = b - draw_batches;
+
+	v = &draw_verts[draw_numquads*4];
+	v[0].xy[0] = x;			v[0].xy[1] = y;
+	v[0].st[0] = sl;		v[0].st[1] = tl;
+	v[1].xy[0] = x + w;		v[1].xy[1] = y;
+	v[1].st[0] = sh;		v[1].st[1] = tl;
+	v[2].xy[0] = x + w;		v[2].xy[1] = y + h;
+	v[2].st[0] = sh;		v[2].st[1] = th;
+	v[3].xy[0] = x;			v[3].xy[1] = y + h;
+	v[3].st[0] = sl;		v[3].st[1] = th;
+	for (k = 0 ; k < 4 ; k++)
+		memcpy (v[k].color, color, 4);
+
+	draw_numquads++;
+}
+
+/*
+================
+Draw_CharQuad
+================
+*/
+static void Draw_CharQuad (int x, int y, int num, int size)
+{
+	float	frow, fcol;
+
+	frow = (num >> 4) * 0.0625;
+	fcol = (num & 15) * 0.0625;
+	Draw_AddQuad (char_texture, 0, x, y, size, size, fcol, frow, fcol + 0.0625, frow + 0.03125, draw_opaque);
+}
+
 /*
 ================
 Draw_Character
@@ -838,9 +1125,6 @@ smoothly scrolled off.
 */
 void Draw_Character (int x, int y, int num, qboolean scale)
 {
-	int	row, col, size;
-	float	frow, fcol;
-
 	if (y <= -8)
 		return;		// totally off screen
 
@@ -848,27 +1132,8 @@ void Draw_Character (int x, int y, int num, qboolean scale)
 		return;		// space
 
 	num &= 255;
-	
-	row = num >> 4;
-	col = num & 15;
 
-	frow = row * 0.0625;
-	fcol = col * 0.0625;
-
-	size = scale ? Sbar_GetScaledCharacterSize() : 8;
-
-	GL_Bind (char_texture);
-
-	glBegin (GL_QUADS);
-	glTexCoord2f (fcol, frow);
-	glVertex2f (x, y);
-	glTexCoord2f (fcol + 0.0625, frow);
-	glVertex2f (x + size, y);
-	glTexCoord2f (fcol + 0.0625, frow + 0.03125);
-	glVertex2f (x + size, y + size);
-	glTexCoord2f (fcol, frow + 0.03125);
-	glVertex2f (x, y + size);
-	glEnd ();
+	Draw_CharQuad (x, y, num, scale ? Sbar_GetScaledCharacterSize() : 8);
 }
 
 /*
@@ -878,7 +1143,6 @@ Draw_String
 */
 void Draw_String (int x, int y, char *str, qboolean scale)
 {
-	float	frow, fcol;
 	int	num, size;
 
 	if (y <= -8)
@@ -889,29 +1153,12 @@ void Draw_String (int x, int y, char *str, qboolean scale)
 
 	size = scale ? Sbar_GetScaledCharacterSize() : 8;
 
-	GL_Bind (char_texture);
-
-	glBegin (GL_QUADS);
-
 	while (*str)		// stop rendering when out of characters
 	{
 		if ((num = *str++) != 32)	// skip spaces
-		{
-			frow = (float)(num >> 4) * 0.0625;
-			fcol = (float)(num & 15) * 0.0625;
-			glTexCoord2f (fcol, frow);
-			glVertex2f (x, y);
-			glTexCoord2f (fcol + 0.0625, frow);
-			glVertex2f (x + size, y);
-			glTexCoord2f (fcol + 0.0625, frow + 0.03125);
-			glVertex2f (x + size, y + size);
-			glTexCoord2f (fcol, frow + 0.03125);
-			glVertex2f (x, y + size);
-		}
+			Draw_CharQuad (x, y, num, size);
 		x += size;
 	}
-
-	glEnd ();
 }
 
 /*
@@ -921,7 +1168,6 @@ Draw_Alt_String
 */
 void Draw_Alt_String (int x, int y, char *str, qboolean scale)
 {
-	float	frow, fcol;
 	int	num, size;
 
 	if (y <= -8)
@@ -932,29 +1178,12 @@ void Draw_Alt_String (int x, int y, char *str, qboolean scale)
 
 	size = scale ? Sbar_GetScaledCharacterSize() : 8;
 
-	GL_Bind (char_texture);
-
-	glBegin (GL_QUADS);
-
 	while (*str)		// stop rendering when out of characters
 	{
 		if ((num = *str++|0x80) != (32|0x80))	// skip spaces
-		{
-			frow = (float)(num >> 4) * 0.0625;
-			fcol = (float)(num & 15) * 0.0625;
-			glTexCoord2f (fcol, frow);
-			glVertex2f (x, y);
-			glTexCoord2f (fcol + 0.0625, frow);
-			glVertex2f (x + size, y);
-			glTexCoord2f (fcol + 0.0625, frow + 0.03125);
-			glVertex2f (x + size, y + size);
-			glTexCoord2f (fcol, frow + 0.03125);
-			glVertex2f (x, y + size);
-		}
+			Draw_CharQuad (x, y, num, size);
 		x += size;
 	}
-
-	glEnd ();
 }
 
 byte *StringToRGB (char *s)
@@ -988,6 +1217,7 @@ Draw_Crosshair		-- joe, from FuhQuake
 */
 void Draw_Crosshair (qboolean draw_menu)
 {
+	int			texnum;
 	float		x, y, ofs1, ofs2, sh, th, sl, tl, frac;
 	byte		*col;
 	extern vrect_t	scr_vrect;
@@ -1010,25 +1240,12 @@ void Draw_Crosshair (qboolean draw_menu)
 		if (!gl_crosshairalpha.value)
 			return;
 
-		glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-
 		col = StringToRGB (crosshaircolor.string);
-
-		if (gl_crosshairalpha.value)
-		{
-			glDisable (GL_ALPHA_TEST);
-			glEnable (GL_BLEND);
-			col[3] = bound(0, gl_crosshairalpha.value, 1) * 255;
-			glColor4ubv (col);
-		}
-		else
-		{
-			glColor3ubv (col);
-		}
+		col[3] = bound(0, gl_crosshairalpha.value, 1) * 255;
 
 		if (crosshairimage_loaded)
 		{
-			GL_Bind (crosshairpic.texnum);
+			texnum = crosshairpic.texnum;
 			ofs1 = crosshairpic.width / 8.0;
 			ofs2 = crosshairpic.width / 8.0;
 			sh = crosshairpic.sh;
@@ -1038,7 +1255,7 @@ void Draw_Crosshair (qboolean draw_menu)
 		}
 		else
 		{
-			GL_Bind (crosshairtextures[(int)crosshair.value-2]);
+			texnum = crosshairtextures[(int)crosshair.value-2];
 			ofs1 = 3.5;
 			ofs2 = 4.5;
 			tl = sl = 0;
@@ -1052,25 +1269,7 @@ void Draw_Crosshair (qboolean draw_menu)
 		ofs1 *= frac;
 		ofs2 *= frac;
 
-		glBegin (GL_QUADS);
-		glTexCoord2f (sl, tl);
-		glVertex2f (x - ofs1, y - ofs1);
-		glTexCoord2f (sh, tl);
-		glVertex2f (x + ofs2, y - ofs1);
-		glTexCoord2f (sh, th);
-		glVertex2f (x + ofs2, y + ofs2);
-		glTexCoord2f (sl, th);
-		glVertex2f (x - ofs1, y + ofs2);
-		glEnd ();
-
-		if (gl_crosshairalpha.value)
-		{
-			glDisable (GL_BLEND);
-			glEnable (GL_ALPHA_TEST);
-		}
-
-		glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-		glColor3ubv (color_white);
+		Draw_AddQuad (texnum, DRAW_BLEND, x - ofs1, y - ofs1, ofs1 + ofs2, ofs1 + ofs2, sl, tl, sh, th, col);
 	}
 	else if (crosshair.value)
 	{
@@ -1159,28 +1358,13 @@ Draw_AlphaPic
 */
 void Draw_AlphaPic (int x, int y, mpic_t *pic, float alpha)
 {
+	byte	color[4] = {255, 255, 255, 255};
+
 	if (scrap_dirty)
 		Scrap_Upload ();
-	
-	glDisable (GL_ALPHA_TEST);
-	glEnable (GL_BLEND);
-	glColor4f (1, 1, 1, alpha);
-	GL_Bind (pic->texnum);
-	glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter_minmax_hud);
-	glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter_minmax_hud);
-	glBegin (GL_QUADS);
-	glTexCoord2f (pic->sl, pic->tl);
-	glVertex2f (x, y);
-	glTexCoord2f (pic->sh, pic->tl);
-	glVertex2f (x+pic->width, y);
-	glTexCoord2f (pic->sh, pic->th);
-	glVertex2f (x+pic->width, y+pic->height);
-	glTexCoord2f (pic->sl, pic->th);
-	glVertex2f (x, y+pic->height);
-	glEnd ();
-	glColor3ubv (color_white);
-	glEnable (GL_ALPHA_TEST);
-	glDisable (GL_BLEND);
+
+	color[3] = bound(0, alpha, 1) * 255;
+	Draw_AddQuad (pic->texnum, DRAW_BLEND | DRAW_HUDFILTER, x, y, pic->width, pic->height, pic->sl, pic->tl, pic->sh, pic->th, color);
 }
 
 /*
@@ -1197,19 +1381,8 @@ void Draw_Pic (int x, int y, mpic_t *pic, qboolean scale)
 
 	sbar_scale = scale ? Sbar_GetScaleAmount() : 1.0;
 
-	GL_Bind (pic->texnum);
-	glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter_minmax_hud);
-	glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter_minmax_hud);
-	glBegin (GL_QUADS);
-	glTexCoord2f (pic->sl, pic->tl);
-	glVertex2f (x, y);
-	glTexCoord2f (pic->sh, pic->tl);
-	glVertex2f (x + (int)(pic->width * sbar_scale), y);
-	glTexCoord2f (pic->sh, pic->th);
-	glVertex2f (x + (int)(pic->width * sbar_scale), y + (int)(pic->height * sbar_scale));
-	glTexCoord2f (pic->sl, pic->th);
-	glVertex2f (x, y + (int)(pic->height * sbar_scale));
-	glEnd ();
+	Draw_AddQuad (pic->texnum, DRAW_HUDFILTER, x, y, (int)(pic->width * sbar_scale), (int)(pic->height * sbar_scale),
+		pic->sl, pic->tl, pic->sh, pic->th, draw_opaque);
 }
 
 void Draw_SubPic (int x, int y, mpic_t *pic, int srcx, int srcy, int width, int height)
@@ -1230,19 +1403,8 @@ void Draw_SubPic (int x, int y, mpic_t *pic, int srcx, int srcy, int width, int
 	
 	scale = Sbar_GetScaleAmount();
 
-	GL_Bind (pic->texnum);
-	glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter_minmax_hud);
-	glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter_minmax_hud);
-	glBegin (GL_QUADS);
-	glTexCoord2f (newsl, newtl);
-	glVertex2f (x, y);
-	glTexCoord2f (newsh, newtl);
-	glVertex2f (x + (int)(width * scale), y);
-	glTexCoord2f (newsh, newth);
-	glVertex2f (x + (int)(width * scale), y + (int)(height * scale));
-	glTexCoord2f (newsl, newth);
-	glVertex2f (x, y + (int)(height * scale));
-	glEnd ();
+	Draw_AddQuad (pic->texnum, DRAW_HUDFILTER, x, y, (int)(width * scale), (int)(height * scale),
+		newsl, newtl, newsh, newth, draw_opaque);
 }
 
 /*
@@ -1271,6 +1433,9 @@ void Draw_TransPicTranslate (int x, int y, mpic_t *pic, byte *translation)
 	unsigned	trans[64*64], *dest;
 	byte		*src;
 
+	// queued quads may still be showing the last translation
+	Draw_Flush ();
+
 	GL_Bind (translate_texture);
 
 	c = pic->width * pic->height;
@@ -1291,24 +1456,17 @@ void Draw_TransPicTranslate (int x, int y, mpic_t *pic, byte *translation)
 	glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter_minmax_hud);
 	glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter_minmax_hud);
 
-	glBegin (GL_QUADS);
-	glTexCoord2f (0, 0);
-	glVertex2f (x, y);
-	glTexCoord2f (1, 0);
-	glVertex2f (x+pic->width, y);
-	glTexCoord2f (1, 1);
-	glVertex2f (x+pic->width, y+pic->height);
-	glTexCoord2f (0, 1);
-	glVertex2f (x, y+pic->height);
-	glEnd ();
+	Draw_AddQuad (translate_texture, 0, x, y, pic->width, pic->height, 0, 0, 1, 1, draw_opaque);
 }
 
 float overall_alpha = 1.0;
 
 void Draw_SAlphaSubPic2(int x, int y, mpic_t *pic, int src_x, int src_y, int src_width, int src_height, float scale_x, float scale_y, float alpha)
 {
+	int flags;
 	float newsl, newtl, newsh, newth;
 	float oldglwidth, oldglheight;
+	byte color[4] = {255, 255, 255, 255};
 
 	if (scrap_dirty)
 		Scrap_Upload();
@@ -1322,45 +1480,18 @@ void Draw_SAlphaSubPic2(int x, int y, mpic_t *pic, int src_x, int src_y, int src
 	newtl = pic->tl + (src_y * oldglheight) / (float)pic->height;
 	newth = newtl + (src_height * oldglheight) / (float)pic->height;
 
-	alpha *= overall_alpha; 
+	alpha *= overall_alpha;
 	if (alpha < 1.0)
 	{
-		glDisable(GL_ALPHA_TEST);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-		glColor4f(1, 1, 1, alpha);
-	}
-
-	GL_Bind(pic->texnum);
-
-	glBegin(GL_QUADS);
-	{
-		// Upper left corner.
-		glTexCoord2f(newsl, newtl);
-		glVertex2f(x, y);
-
-		// Upper right corner.
-		glTexCoord2f(newsh, newtl);
-		glVertex2f(x + (scale_x * src_width), y);
-
-		// Bottom right corner.
-		glTexCoord2f(newsh, newth);
-		glVertex2f(x + (scale_x * src_width), y + (scale_y * src_height));
-
-		// Bottom left corner.
-		glTexCoord2f(newsl, newth);
-		glVertex2f(x, y + (scale_y * src_height));
+		color[3] = max(alpha, 0) * 255;
+		flags = DRAW_BLEND;
+	}
+	else
+	{
+		flags = 0;
 	}
-	glEnd();
 
-	if (alpha < 1.0) 
-	{
-		glEnable(GL_ALPHA_TEST);
-		glDisable(GL_BLEND);
-		glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-		glColor4f(1, 1, 1, 1);
-	}
+	Draw_AddQuad (pic->texnum, flags, x, y, scale_x * src_width, scale_y * src_height, newsl, newtl, newsh, newth, color);
 }
 
 void Draw_SAlphaSubPic(int x, int y, mpic_t *pic, int src_x, int src_y, int src_width, int src_height, float scale, float alpha)
@@ -1376,6 +1507,9 @@ void Draw_SAlphaPic(int x, int y, mpic_t *gl, float alpha, float scale)
 void Draw_AlphaLineRGB(int x_start, int y_start, int x_end, int y_end, float thickness, color_t color)
 {
 	byte bytecolor[4];
+
+	Draw_Flush();
+
 	glDisable(GL_TEXTURE_2D);
 
 	glEnable(GL_BLEND);
@@ -1432,17 +1566,7 @@ refresh window.
 */
 void Draw_TileClear (int x, int y, int w, int h)
 {
-	GL_Bind (draw_backtile->texnum);
-	glBegin (GL_QUADS);
-	glTexCoord2f (x/64.0, y/64.0);
-	glVertex2f (x, y);
-	glTexCoord2f ((x+w)/64.0, y/64.0);
-	glVertex2f (x + w, y);
-	glTexCoord2f ((x+w)/64.0, (y+h)/64.0);
-	glVertex2f (x + w, y + h);
-	glTexCoord2f (x/64.0, (y+h)/64.0);
-	glVertex2f (x, y + h);
-	glEnd ();
+	Draw_AddQuad (draw_backtile->texnum, 0, x, y, w, h, x/64.0, y/64.0, (x+w)/64.0, (y+h)/64.0, draw_opaque);
 }
 
 /*
@@ -1456,25 +1580,16 @@ void Draw_AlphaFill(int x, int y, int w, int h, int c, float alpha)
 {
 	float	sbar_scale;
 	byte*	pal = (byte*)d_8to24table; //johnfitz -- use d_8to24table instead of host_basepal
+	byte	color[4];
 
 	sbar_scale = Sbar_GetScaleAmount();
 
-	glDisable(GL_TEXTURE_2D);
-	glEnable(GL_BLEND); //johnfitz -- for alpha
-	glDisable(GL_ALPHA_TEST); //johnfitz -- for alpha
-	glColor4f(pal[c * 4] / 255.0, pal[c * 4 + 1] / 255.0, pal[c * 4 + 2] / 255.0, alpha); //johnfitz -- added alpha
-
-	glBegin(GL_QUADS);
-	glVertex2f(x, y);
-	glVertex2f(x + (int)(w * sbar_scale), y);
-	glVertex2f(x + (int)(w * sbar_scale), y + (int)(h * sbar_scale));
-	glVertex2f(x, y + (int)(h * sbar_scale));
-	glEnd();
+	color[0] = pal[c * 4];
+	color[1] = pal[c * 4 + 1];
+	color[2] = pal[c * 4 + 2];
+	color[3] = bound(0, alpha, 1) * 255; //johnfitz -- added alpha
 
-	glDisable(GL_BLEND); //johnfitz -- for alpha
-	glEnable(GL_ALPHA_TEST); //johnfitz -- for alpha
-	glEnable(GL_TEXTURE_2D);
-	glColor3ubv(color_white);
+	Draw_AddQuad(0, DRAW_BLEND, x, y, (int)(w * sbar_scale), (int)(h * sbar_scale), 0, 0, 0, 0, color);
 }
 
 /*
@@ -1487,25 +1602,16 @@ Fills a box of pixels with a transparent color
 void Draw_AlphaFillRGB(int x, int y, int w, int h, int c, float alpha)
 {
 	float	sbar_scale;
+	byte	color[4];
 
 	sbar_scale = Sbar_GetScaleAmount();
 
-	glDisable(GL_TEXTURE_2D);
-	glEnable(GL_BLEND); //johnfitz -- for alpha
-	glDisable(GL_ALPHA_TEST); //johnfitz -- for alpha
-	glColor4f((c & 0xFF) / 255.0 , (c>>8 & 0xFF) / 255.0, (c>>16 & 0xFF) / 255.0, alpha); //johnfitz -- added alpha
-
-	glBegin(GL_QUADS);
-	glVertex2f(x, y);
-	glVertex2f(x + (int)(w * sbar_scale), y);
-	glVertex2f(x + (int)(w * sbar_scale), y + (int)(h * sbar_scale));
-	glVertex2f(x, y + (int)(h * sbar_scale));
-	glEnd();
-
-	glDisable(GL_BLEND); //johnfitz -- for alpha
-	glEnable(GL_ALPHA_TEST); //johnfitz -- for alpha
-	glEnable(GL_TEXTURE_2D);
-	glColor3ubv(color_white);
+	color[0] = c & 0xFF;
+	color[1] = c >> 8 & 0xFF;
+	color[2] = c >> 16 & 0xFF;
+	color[3] = bound(0, alpha, 1) * 255; //johnfitz -- added alpha
+
+	Draw_AddQuad(0, DRAW_BLEND, x, y, (int)(w * sbar_scale), (int)(h * sbar_scale), 0, 0, 0, 0, color);
 }
 
 /*
@@ -1545,20 +1651,9 @@ Draw_FadeScreen
 */
 void Draw_FadeScreen (void)
 {
-	glEnable (GL_BLEND);
-	glDisable (GL_TEXTURE_2D);
-	glColor4f (0, 0, 0, 0.7);
+	byte	color[4] = {0, 0, 0, 0.7 * 255};
 
-	glBegin (GL_QUADS);
-	glVertex2f (0,0);
-	glVertex2f (vid.width, 0);
-	glVertex2f (vid.width, vid.height);
-	glVertex2f (0, vid.height);
-	glEnd ();
-
-	glColor3ubv (color_white);
-	glEnable (GL_TEXTURE_2D);
-	glDisable (GL_BLEND);
+	Draw_AddQuad (0, DRAW_BLEND, 0, 0, vid.width, vid.height, 0, 0, 0, 0, color);
 
 	Sbar_Changed ();
 }
@@ -1582,8 +1677,10 @@ void Draw_BeginDisc (void)
 
 	scale = Sbar_GetScaleAmount();
 
+	Draw_Flush ();
 	glDrawBuffer  (GL_FRONT);
 	Draw_Pic (vid.width - (int)(24 * scale), 0, draw_disc, true);
+	Draw_Flush ();
 	glDrawBuffer  (GL_BACK);
 }
 
@@ -1608,6 +1705,8 @@ void GL_SetCanvas(canvastype newcanvas)
 {
 	if (newcanvas == currentcanvas)
 		return;
+
+	Draw_Flush ();
 
 	currentcanvas = newcanvas;
 
@@ -1653,42 +1752,6 @@ void GL_Set2D (void)
 
 //=============================================================================
 
-/*
-================
-ResampleTextureLerpLine
-================
-*/
-void ResampleTextureLerpLine (byte *in, byte *out, int inwidth, int outwidth)
-{
-	int	j, xi, oldx = 0, f, fstep, endx = (inwidth - 1), lerp;
-
-	fstep = (inwidth << 16) / outwidth;
-	for (j = 0, f = 0 ; j < outwidth ; j++, f += fstep)
-	{
-		xi = f >> 16;
-		if (xi != oldx)
-		{
-			in += (xi - oldx) * 4;
-			oldx = xi;
-		}
-		if (xi < endx)
-		{
-			lerp = f & 0xFFFF;
-			*out++ = (byte)((((in[4] - in[0]) * lerp) >> 16) + in[0]);
-			*out++ = (byte)((((in[5] - in[1]) * lerp) >> 16) + in[1]);
-			*out++ = (byte)((((in[6] - in[2]) * lerp) >> 16) + in[2]);
-			*out++ = (byte)((((in[7] - in[3]) * lerp) >> 16) + in[3]);
-		}
-		else	// last pixel of the line has no pixel to lerp to
-		{
-			*out++ = in[0];
-			*out++ = in[1];
-			*out++ = in[2];
-			*out++ = in[3];
-		}
-	}
-}
-
 /*
 ================
 ResampleTexture
@@ -1698,7 +1761,7 @@ void ResampleTexture (unsigned *indata, int inwidth, int inheight, unsigned *out
 {
 	if (quality)
 	{
-		int		i, j, yi, oldy, f, fstep, endy = (inheight - 1), lerp;
+		int		i, yi, oldy, f, fstep, endy = (inheight - 1), lerp;
 		int		inwidth4 = inwidth * 4, outwidth4 = outwidth * 4;
 		byte	*inrow, *out, *row1, *row2, *memalloc;
 
@@ -1710,8 +1773,8 @@ void ResampleTexture (unsigned *indata, int inwidth, int inheight, unsigned *out
 		row2 = memalloc + outwidth4;
 		inrow = (byte *)indata;
 		oldy = 0;
-		ResampleTextureLerpLine (inrow, row1, inwidth, outwidth);
-		ResampleTextureLerpLine (inrow + inwidth4, row2, inwidth, outwidth);
+		texkernels->lerpline (inrow, row1, inwidth, outwidth);
+		texkernels->lerpline (inrow + inwidth4, row2, inwidth, outwidth);
 		for (i = 0, f = 0 ; i < outheight ; i++, f += fstep)
 		{
 			yi = f >> 16;
@@ -1724,22 +1787,12 @@ void ResampleTexture (unsigned *indata, int inwidth, int inheight, unsigned *out
 					if (yi == oldy + 1)
 						memcpy (row1, row2, outwidth4);
 					else
-						ResampleTextureLerpLine (inrow, row1, inwidth, outwidth);
-					ResampleTextureLerpLine (inrow + inwidth4, row2, inwidth, outwidth);
+						texkernels->lerpline (inrow, row1, inwidth, outwidth);
+					texkernels->lerpline (inrow + inwidth4, row2, inwidth, outwidth);
 					oldy = yi;
 				}
-				for (j = outwidth ; j ; j--)
-				{
-					out[0] = (byte)((((row2[0] - row1[0]) * lerp) >> 16) + row1[0]);
-					out[1] = (byte)((((row2[1] - row1[1]) * lerp) >> 16) + row1[1]);
-					out[2] = (byte)((((row2[2] - row1[2]) * lerp) >> 16) + row1[2]);
-					out[3] = (byte)((((row2[3] - row1[3]) * lerp) >> 16) + row1[3]);
-					out += 4;
-					row1 += 4;
-					row2 += 4;
-				}
-				row1 -= outwidth4;
-				row2 -= outwidth4;
+				texkernels->lerprows (out, row1, row2, outwidth4, lerp);
+				out += outwidth4;
 			}
 			else
 			{
@@ -1749,7 +1802,7 @@ void ResampleTexture (unsigned *indata, int inwidth, int inheight, unsigned *out
 					if (yi == oldy + 1)
 						memcpy(row1, row2, outwidth4);
 					else
-						ResampleTextureLerpLine (inrow, row1, inwidth, outwidth);
+						texkernels->lerpline (inrow, row1, inwidth, outwidth);
 					oldy = yi;
 				}
 				memcpy (out, row1, outwidth4);
@@ -1815,16 +1868,7 @@ void MipMap (byte *in, int *width, int *height)
 		if (*height > 1)
 		{
 			*height >>= 1;
-			for (i = 0 ; i < *height ; i++, in += nextrow)
-			{
-				for (j = 0 ; j < *width ; j++, out += 4, in += 8)
-				{
-					out[0] = (in[0] + in[4] + in[nextrow+0] + in[nextrow+4]) >> 2;
-					out[1] = (in[1] + in[5] + in[nextrow+1] + in[nextrow+5]) >> 2;
-					out[2] = (in[2] + in[6] + in[nextrow+2] + in[nextrow+6]) >> 2;
-					out[3] = (in[3] + in[7] + in[nextrow+3] + in[nextrow+7]) >> 2;
-				}
-			}
+			texkernels->mipmap2d (in, nextrow, *width, *height);
 		}
 		else
 		{
@@ -1856,68 +1900,156 @@ void MipMap (byte *in, int *width, int *height)
 	}
 }
 
-static void ScaleDimensions (int width, int height, int *scaled_width, int *scaled_height, int mode)
+// the upload settings a texture is scaled with, captured up front so that
+// task workers never read the cvars
+typedef struct
+{
+	int			picmip;
+	int			maxsize;
+	qboolean	lerp;
+} scaleparms_t;
+
+static void GL_GetScaleParms (scaleparms_t *parms, int mode)
 {
-	int	maxsize;
+	parms->picmip = (mode & TEX_MIPMAP) ? (int)gl_picmip.value : 0;
+	parms->maxsize = (mode & TEX_MIPMAP) ? gl_max_size.value : gl_max_size_default;
+	parms->lerp = !!gl_lerptextures.value;
+}
 
+static void ScaleDimensionsParms (int width, int height, int *scaled_width, int *scaled_height, scaleparms_t *parms)
+{
 	Q_ROUND_POWER2(width, *scaled_width);
 	Q_ROUND_POWER2(height, *scaled_height);
 
-	if (mode & TEX_MIPMAP)
-	{
-		*scaled_width >>= (int)gl_picmip.value;
-		*scaled_height >>= (int)gl_picmip.value;
-	}
+	*scaled_width >>= parms->picmip;
+	*scaled_height >>= parms->picmip;
+
+	*scaled_width = bound(1, *scaled_width, parms->maxsize);
+	*scaled_height = bound(1, *scaled_height, parms->maxsize);
+}
 
-	maxsize = (mode & TEX_MIPMAP) ? gl_max_size.value : gl_max_size_default;
+static void ScaleDimensions (int width, int height, int *scaled_width, int *scaled_height, int mode)
+{
+	scaleparms_t	parms;
 
-	*scaled_width = bound(1, *scaled_width, maxsize);
-	*scaled_height = bound(1, *scaled_height, maxsize);
+	GL_GetScaleParms (&parms, mode);
+	ScaleDimensionsParms (width, height, scaled_width, scaled_height, &parms);
 }
 
 /*
 ===============
-GL_Upload32
+GL_ScaleImage
+
+Resamples to a power of two and mips down to the upload size.  Touches no
+GL or cvar state, so it is safe to run on a task worker.
 ===============
 */
-void GL_Upload32 (unsigned *data, int width, int height, int mode)
+static unsigned *GL_ScaleImage (unsigned *data, int *width, int *height, scaleparms_t *parms)
 {
-	int		internal_format, scaled_width, scaled_height, miplevel;
+	int		scaled_width, scaled_height;
 	unsigned int *scaled;
 
-	Q_ROUND_POWER2(width, scaled_width);
-	Q_ROUND_POWER2(height, scaled_height);
+	Q_ROUND_POWER2(*width, scaled_width);
+	Q_ROUND_POWER2(*height, scaled_height);
 
 	scaled = Q_malloc (scaled_width * scaled_height * 4);
-	if (width < scaled_width || height < scaled_height)
+	if (*width < scaled_width || *height < scaled_height)
 	{
-		ResampleTexture (data, width, height, scaled, scaled_width, scaled_height, !!gl_lerptextures.value);
-		width = scaled_width;
-		height = scaled_height;
+		ResampleTexture (data, *width, *height, scaled, scaled_width, scaled_height, parms->lerp);
+		*width = scaled_width;
+		*height = scaled_height;
 	}
 	else
 	{
-		memcpy (scaled, data, width * height * 4);
+		memcpy (scaled, data, *width * *height * 4);
 	}
 
-	ScaleDimensions (width, height, &scaled_width, &scaled_height, mode);
+	ScaleDimensionsParms (*width, *height, &scaled_width, &scaled_height, parms);
+
+	while (*width > scaled_width || *height > scaled_height)
+		MipMap ((byte *)scaled, width, height);
+
+	return scaled;
+}
+
+static int MipChainSize (int width, int height, int mode, int *numlevels)
+{
+	int	size = 0;
+
+	*numlevels = 0;
+	while (1)
+	{
+		size += width * height * 4;
+		(*numlevels)++;
+		if (!(mode & TEX_MIPMAP) || (width == 1 && height == 1))
+			break;
+		width = max(1, width >> 1);
+		height = max(1, height >> 1);
+	}
+
+	return size;
+}
+
+/*
+===============
+GL_BuildMipChain
+
+Scales the image for upload and appends the mip levels.  Like
+GL_ScaleImage, this is safe to run on a task worker.
+===============
+*/
+static void GL_BuildMipChain (unsigned *data, int width, int height, int mode, scaleparms_t *parms, mipchain_t *chain)
+{
+	int		i;
+	byte	*in, *out;
+
+	chain->data = (byte *)GL_ScaleImage (data, &width, &height, parms);
+	chain->format = 0;
+	chain->width = width;
+	chain->height = height;
+	chain->size = MipChainSize (width, height, mode, &chain->numlevels);
+	chain->data = Q_realloc (chain->data, chain->size);
+
+	for (i = 1, in = chain->data ; i < chain->numlevels ; i++, in = out)
+	{
+		out = in + width * height * 4;
+		memcpy (out, in, width * height * 4);
+		MipMap (out, &width, &height);
+	}
+}
 
-	while (width > scaled_width || height > scaled_height)
-		MipMap ((byte *)scaled, &width, &height);
+/*
+===============
+GL_UploadMipChain
+===============
+*/
+static void GL_UploadMipChain (mipchain_t *chain, int mode)
+{
+	int		i, internal_format, width, height, size;
+	byte	*level;
 
 	internal_format = (mode & TEX_ALPHA) ? gl_alpha_format : gl_solid_format;
 
-	miplevel = 0;
-	glTexImage2D (GL_TEXTURE_2D, 0, internal_format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, scaled);
-	if (mode & TEX_MIPMAP)
+	width = chain->width;
+	height = chain->height;
+	for (i = 0, level = chain->data ; i < chain->numlevels ; i++)
 	{
-		while (width > 1 || height > 1)
-		{
-			MipMap ((byte *)scaled, &width, &height);
-			miplevel++;
-			glTexImage2D (GL_TEXTURE_2D, miplevel, internal_format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, scaled);
-		}
+		size = Image_MipLevelSize (chain->format, width, height);
+		if (chain->format)
+			qglCompressedTexImage2D (GL_TEXTURE_2D, i, chain->format, width, height, 0, size, level);
+		else
+			glTexImage2D (GL_TEXTURE_2D, i, internal_format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level);
+		level += size;
+		width = max(1, width >> 1);
+		height = max(1, height >> 1);
+	}
 
+	// precompressed files may stop short of 1x1, the default is put back
+	// for whatever reuses the texture next
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, chain->format ? chain->numlevels - 1 : 1000);
+
+	if (mode & TEX_MIPMAP)
+	{
 		glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter_min);
 		glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter_max);
 		glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, gl_texture_anisotropy.value);
@@ -1933,21 +2065,364 @@ void GL_Upload32 (unsigned *data, int width, int height, int mode)
 		glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter_max);
 		glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter_max);
 	}
-
-	free (scaled);
+}
+
+/*
+=========================================================
+
+			Texture cache
+
+Mip chains are kept in joequake/texcache, keyed by a hash of the source
+data and of everything else that affects the result.  A hit skips
+decoding, gamma and resampling.  The files are native endian, anything
+that doesn't check out counts as a miss and gets rewritten.  A hit also
+touches the file, and on every map load the least recently used files
+are removed until the cache fits in gl_texturecache_size megabytes.
+
+=========================================================
+*/
+
+#define	TEXCACHE_IDENT		(('C'<<24)+('T'<<16)+('Q'<<8)+'J')
+#define	TEXCACHE_VERSION	1
+
+typedef struct
+{
+	int			width, height;		// of the source image
+	int			mode;				// the chain is uploaded with
+	unsigned	crc;				// of the source data, for gltexture_t
+	mipchain_t	chain;
+} teximage_t;
+
+typedef struct
+{
+	int			ident;
+	int			version;
+	uint64_t	key;
+	int			width, height;
+	int			mode;
+	unsigned	crc;
+	int			chainwidth, chainheight;
+	int			numlevels;
+	int			chainsize;
+} texcacheheader_t;
+
+// FNV-1a
+static uint64_t TexCache_Hash (uint64_t hash, const void *data, int size)
+{
+	const byte	*p = (const byte *)data;
+
+	while (size-- > 0)
+	{
+		hash ^= *p++;
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+// hashes the upload settings and tables the result depends on, which
+// only the main thread may read; 0 means the cache is off
+static uint64_t TexCache_ParmHash (int mode, qboolean gamma, int bpp)
+{
+	int				parmbuf[6];
+	uint64_t		hash;
+	scaleparms_t	parms;
+
+	if (!gl_texturecache.value)
+		return 0;
+
+	GL_GetScaleParms (&parms, mode);
+	parmbuf[0] = TEXCACHE_VERSION;
+	parmbuf[1] = mode & ~TEX_COMPLAIN;
+	parmbuf[2] = parms.picmip;
+	parmbuf[3] = parms.maxsize;
+	parmbuf[4] = parms.lerp;
+	parmbuf[5] = bpp;
+
+	hash = TexCache_Hash (0xcbf29ce484222325ULL, parmbuf, sizeof(parmbuf));
+	if (gamma)
+		hash = TexCache_Hash (hash, vid_gamma_table, sizeof(vid_gamma_table));
+	if (bpp == 1)
+		hash = TexCache_Hash (hash, d_8to24table, sizeof(d_8to24table));
+
+	return hash ? hash : 1;
+}
+
+static void TexCache_Path (uint64_t key, char *path, int size)
+{
+	Q_snprintfz (path, size, "%s/joequake/texcache/%08x%08x.tex", com_basedir, (unsigned)(key >> 32), (unsigned)key);
+}
+
+static qboolean TexCache_Read (uint64_t key, teximage_t *img)
+{
+	char				path[MAX_OSPATH];
+	int					numlevels;
+	FILE				*f;
+	texcacheheader_t	header;
+
+	TexCache_Path (key, path, sizeof(path));
+	if (!(f = fopen(path, "rb")))
+		return false;
+
+	if (fread(&header, 1, sizeof(header), f) != sizeof(header) ||
+	    header.ident != TEXCACHE_IDENT || header.version != TEXCACHE_VERSION || header.key != key ||
+	    header.chainwidth < 1 || header.chainwidth > 8192 || header.chainheight < 1 || header.chainheight > 8192 ||
+	    header.chainsize != MipChainSize(header.chainwidth, header.chainheight, header.mode, &numlevels) ||
+	    header.numlevels != numlevels)
+	{
+		fclose (f);
+		return false;
+	}
+
+	img->chain.data = Q_malloc (header.chainsize);
+	if (fread(img->chain.data, 1, header.chainsize, f) != header.chainsize)
+	{
+		free (img->chain.data);
+		img->chain.data = NULL;
+		fclose (f);
+		return false;
+	}
+	fclose (f);
+
+	// keeps it from being pruned
+	utime (path, NULL);
+
+	img->width = header.width;
+	img->height = header.height;
+	img->mode = header.mode;
+	img->crc = header.crc;
+	img->chain.format = 0;
+	img->chain.width = header.chainwidth;
+	img->chain.height = header.chainheight;
+	img->chain.numlevels = header.numlevels;
+	img->chain.size = header.chainsize;
+
+	return true;
+}
+
+// writes to a file of the thread's own and renames it into place, so
+// nothing ever sees a partly written entry
+static void TexCache_Write (uint64_t key, teximage_t *img)
+{
+	char				path[MAX_OSPATH], temppath[MAX_OSPATH];
+	qboolean			ok;
+	FILE				*f;
+	texcacheheader_t	header;
+
+	TexCache_Path (key, path, sizeof(path));
+	Q_snprintfz (temppath, sizeof(temppath), "%s.%lu.tmp", path, Sys_ThreadID());
+	if (!(f = fopen(temppath, "wb")))
+	{
+		COM_CreatePath (temppath);
+		if (!(f = fopen(temppath, "wb")))
+			return;
+	}
+
+	memset (&header, 0, sizeof(header));
+	header.ident = TEXCACHE_IDENT;
+	header.version = TEXCACHE_VERSION;
+	header.key = key;
+	header.width = img->width;
+	header.height = img->height;
+	header.mode = img->mode;
+	header.crc = img->crc;
+	header.chainwidth = img->chain.width;
+	header.chainheight = img->chain.height;
+	header.numlevels = img->chain.numlevels;
+	header.chainsize = img->chain.size;
+
+	ok = fwrite(&header, 1, sizeof(header), f) == sizeof(header) &&
+		fwrite(img->chain.data, 1, img->chain.size, f) == img->chain.size;
+	if (fclose(f))
+		ok = false;
+
+	if (ok)
+	{
+#ifdef _WIN32
+		// Windows doesn't rename over an existing file
+		remove (path);
+#endif
+		ok = !rename(temppath, path);
+	}
+	if (!ok)
+		remove (temppath);
+}
+
+typedef struct
+{
+	char		name[MAX_OSPATH];
+	int			size;
+	uint64_t	time;
+} texcachefile_t;
+
+static int TexCache_CompareFiles (const void *a, const void *b)
+{
+	uint64_t	ta = ((const texcachefile_t *)a)->time, tb = ((const texcachefile_t *)b)->time;
+
+	// oldest first
+	return (ta > tb) - (ta < tb);
+}
+
+// lists the cache files, which the caller frees
+static int TexCache_ListFiles (texcachefile_t **files)
+{
+	int				count = 0, max = 0;
+	char			path[MAX_OSPATH];
+	texcachefile_t	*file;
+#ifdef _WIN32
+	HANDLE			h;
+	WIN32_FIND_DATA	fd;
+#else
+	int				i;
+	glob_t			fd;
+	struct	stat	fileinfo;
+#endif
+
+	*files = NULL;
+	Q_snprintfz (path, sizeof(path), "%s/joequake/texcache", com_basedir);
+
+#ifdef _WIN32
+	if ((h = FindFirstFile(va("%s/*.tex", path), &fd)) == INVALID_HANDLE_VALUE)
+		return 0;
+
+	do {
+		if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			continue;
+
+		if (count == max)
+		{
+			max = max(max * 2, 256);
+			*files = Q_realloc (*files, max * sizeof(texcachefile_t));
+		}
+		file = &(*files)[count++];
+		Q_snprintfz (file->name, sizeof(file->name), "%s/%s", path, fd.cFileName);
+		file->size = fd.nFileSizeLow;
+		file->time = ((uint64_t)fd.ftLastWriteTime.dwHighDateTime << 32) | fd.ftLastWriteTime.dwLowDateTime;
+	} while (FindNextFile(h, &fd));
+	FindClose (h);
+#else
+	if (glob(va("%s/*.tex", path), 0, NULL, &fd))
+		return 0;
+
+	for (i = 0 ; i < fd.gl_pathc ; i++)
+	{
+		if (stat(fd.gl_pathv[i], &fileinfo) || S_ISDIR(fileinfo.st_mode))
+			continue;
+
+		if (count == max)
+		{
+			max = max(max * 2, 256);
+			*files = Q_realloc (*files, max * sizeof(texcachefile_t));
+		}
+		file = &(*files)[count++];
+		Q_strncpyz (file->name, fd.gl_pathv[i], sizeof(file->name));
+		file->size = fileinfo.st_size;
+		file->time = fileinfo.st_mtime;
+	}
+	globfree (&fd);
+#endif
+
+	return count;
+}
+
+// removes the least recently used files until the rest fit in limit bytes
+static void TexCache_Prune (double limit)
+{
+	int				i, count;
+	double			total = 0;
+	texcachefile_t	*files;
+
+	// the workers may still be writing
+	GL_FlushImageJobs ();
+
+	count = TexCache_ListFiles (&files);
+	for (i = 0 ; i < count ; i++)
+		total += files[i].size;
+
+	if (total > limit)
+	{
+		qsort (files, count, sizeof(texcachefile_t), TexCache_CompareFiles);
+		for (i = 0 ; i < count && total > limit ; i++)
+		{
+			if (!remove(files[i].name))
+				total -= files[i].size;
+		}
+	}
+
+	free (files);
+}
+
+/*
+================
+GL_PruneTextureCache
+================
+*/
+void GL_PruneTextureCache (void)
+{
+	if (gl_texturecache_size.value > 0)
+		TexCache_Prune (gl_texturecache_size.value * 1024 * 1024);
+}
+
+static void TexCache_Clear_f (void)
+{
+	TexCache_Prune (0);
+}
+
+// uploads the cached chain for key, if there is one
+static qboolean GL_UploadCached (uint64_t key)
+{
+	teximage_t	img;
+
+	if (!TexCache_Read(key, &img))
+		return false;
+
+	GL_UploadMipChain (&img.chain, img.mode);
+	free (img.chain.data);
+
+	return true;
+}
+
+// GL_Upload32 that stores the result in the texture cache unless key is 0
+static void GL_Upload32Key (unsigned *data, int width, int height, int mode, uint64_t key)
+{
+	teximage_t		img;
+	scaleparms_t	parms;
+
+	GL_GetScaleParms (&parms, mode);
+	GL_BuildMipChain (data, width, height, mode, &parms, &img.chain);
+	GL_UploadMipChain (&img.chain, mode);
+
+	if (key)
+	{
+		img.width = width;
+		img.height = height;
+		img.mode = mode;
+		img.crc = 0;
+		TexCache_Write (key, &img);
+	}
+
+	free (img.chain.data);
 }
 
 /*
 ===============
-GL_Upload8
+GL_Upload32
 ===============
 */
-void GL_Upload8 (byte *data, int width, int height, int mode)
+void GL_Upload32 (unsigned *data, int width, int height, int mode)
+{
+	GL_Upload32Key (data, width, height, mode, 0);
+}
+
+static void GL_Upload8Key (byte *data, int width, int height, int mode, uint64_t key)
 {
 	int		i, size, p;
 	unsigned	*table;
 	static unsigned	trans[2048*2048*4];	// joe: raised value from 960*480
 
+	if (key && GL_UploadCached(key))
+		return;
+
 	table = d_8to24table;
 	size = width * height;
 
@@ -1986,40 +2461,55 @@ void GL_Upload8 (byte *data, int width, int height, int mode)
 			trans[i] = table[data[i]];
 	}
 
-	GL_Upload32 (trans, width, height, mode);
+	GL_Upload32Key (trans, width, height, mode, key);
+}
+
+/*
+===============
+GL_Upload8
+===============
+*/
+void GL_Upload8 (byte *data, int width, int height, int mode)
+{
+	GL_Upload8Key (data, width, height, mode, 0);
 }
 
 /*
 ================
-GL_LoadTexture
+GL_AllocTextureSlot
+
+Returns the slot holding identifier, to be reloaded if the image differs,
+or a new one.  Sets *cached if the slot already holds this exact image.
 ================
 */
-int GL_LoadTexture (char *identifier, int width, int height, byte *data, int mode, int bpp)
+static gltexture_t *GL_AllocTextureSlot (char *identifier, int width, int height, int scaled_width, int scaled_height, unsigned crc, int mode, int bpp, qboolean *cached)
 {
-	int		i, scaled_width, scaled_height, crc = 0;
+	int		i;
 	gltexture_t	*glt;
 
-	ScaleDimensions (width, height, &scaled_width, &scaled_height, mode);
+	*cached = false;
 
 	// see if the texture is already present
 	if (identifier[0])
 	{
-		crc = CRC_Block (data, width * height * bpp);
 		for (i = 0, glt = gltextures ; i < numgltextures ; i++, glt++)
 		{
 			if (!strncmp(identifier, glt->identifier, sizeof(glt->identifier)-1))
 			{
+				if (glt->pending)
+					GL_FlushImageJobs ();
+
 				if (width == glt->width && height == glt->height && 
 				    scaled_width == glt->scaled_width && scaled_height == glt->scaled_height && 
 				    crc == glt->crc && bpp == glt->bpp && 
 				    (mode & ~TEX_COMPLAIN) == (glt->texmode & ~TEX_COMPLAIN))
 				{
-					GL_Bind (gltextures[i].texnum);
-					return gltextures[i].texnum;	// texture cached
+					*cached = true;
+					return glt;		// texture cached
 				}
 				else
 				{
-					goto GL_LoadTexture_setup;	// reload the texture into the same slot
+					goto GL_AllocTextureSlot_setup;	// reload the texture into the same slot
 				}
 			}
 		}
@@ -2035,7 +2525,7 @@ int GL_LoadTexture (char *identifier, int width, int height, byte *data, int mod
 	glt->texnum = texture_extension_number;
 	texture_extension_number++;
 
-GL_LoadTexture_setup:
+GL_AllocTextureSlot_setup:
 	glt->width = width;
 	glt->height = height;
 	glt->scaled_width = scaled_width;
@@ -2052,12 +2542,45 @@ GL_LoadTexture_setup:
 	if (bpp == 4 && com_netpath[0])
 		glt->pathname = CopyString (com_netpath);
 
+	return glt;
+}
+
+/*
+================
+GL_LoadTexture
+================
+*/
+int GL_LoadTexture (char *identifier, int width, int height, byte *data, int mode, int bpp)
+{
+	int			scaled_width, scaled_height;
+	unsigned	crc = 0;
+	uint64_t	key = 0;
+	qboolean	cached;
+	gltexture_t	*glt;
+
+	ScaleDimensions (width, height, &scaled_width, &scaled_height, mode);
+
+	if (identifier[0])
+		crc = CRC_Block (data, width * height * bpp);
+
+	glt = GL_AllocTextureSlot (identifier, width, height, scaled_width, scaled_height, crc, mode, bpp, &cached);
+
 	GL_Bind (glt->texnum);
 
+	if (cached)
+		return glt->texnum;
+
 	switch (bpp)
 	{
 	case 1:
-		GL_Upload8 (data, width, height, mode);
+		// world textures and skins, most of what a map load uploads
+		if ((mode & TEX_MIPMAP) && (key = TexCache_ParmHash(mode, false, 1)))
+		{
+			key = TexCache_Hash (key, &width, sizeof(width));
+			key = TexCache_Hash (key, &height, sizeof(height));
+			key = TexCache_Hash (key, data, width * height);
+		}
+		GL_Upload8Key (data, width, height, mode, key);
 		break;
 
 	case 4:
@@ -2133,7 +2656,11 @@ gltexture_t *GL_FindTexture (char *identifier)
 	for (i = 0 ; i < numgltextures ; i++)
 	{
 		if (!strcmp(identifier, gltextures[i].identifier))
+		{
+			if (gltextures[i].pending)
+				GL_FlushImageJobs ();
 			return &gltextures[i];
+		}
 	}
 
 	return NULL;
@@ -2165,10 +2692,30 @@ static qboolean CheckTextureLoaded (int mode)
 	return false;
 }
 
-byte *GL_LoadImagePixels (char *filename, int matchwidth, int matchheight, int mode)
+static qboolean GL_CompressedFormatSupported (int format)
 {
-	char	basename[256], name[256];
-	byte	*c, *data;
+	switch (format)
+	{
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		return gl_texture_s3tc_able;
+
+	case GL_COMPRESSED_RGBA_BPTC_UNORM_ARB:
+		return gl_texture_bptc_able;
+	}
+
+	return false;
+}
+
+// COM_FOpenFile falls back from .tga to .png and .jpg, com_filetype tells
+// which one was found.  With compressed set, .dds and .ktx files are tried
+// first and skipped if the card can't take their format.
+static FILE *GL_OpenImageFile (char *filename, char *name, int namesize, qboolean compressed)
+{
+	char	basename[256], *c;
+	int		found;
 	FILE	*f;
 
 	COM_StripExtension (filename, basename);
@@ -2176,8 +2723,30 @@ byte *GL_LoadImagePixels (char *filename, int matchwidth, int matchheight, int m
 		if (*c == '*')
 			*c = '#';
 
-	Q_snprintfz (name, sizeof(name), "%s.tga", basename);
-	if (COM_FOpenFile(name, &f) != -1)
+	Q_snprintfz (name, namesize, "%s.tga", basename);
+	com_compressedimages = compressed && gl_compressedtextures.value && (gl_texture_s3tc_able || gl_texture_bptc_able);
+	found = COM_FOpenFile (name, &f);
+	com_compressedimages = false;
+	if (found == -1)
+		return NULL;
+
+	if ((com_filetype == image_DDS || com_filetype == image_KTX) && !GL_CompressedFormatSupported(Image_CompressedFormat(f, com_filetype)))
+	{
+		Con_DPrintf ("%s has an unsupported compression format\n", COM_SkipPath(com_netpath));
+		fclose (f);
+		return GL_OpenImageFile (filename, name, namesize, false);
+	}
+
+	return f;
+}
+
+byte *GL_LoadImagePixels (char *filename, int matchwidth, int matchheight, int mode)
+{
+	char	name[256];
+	byte	*data;
+	FILE	*f;
+
+	if ((f = GL_OpenImageFile(filename, name, sizeof(name), false)))
 	{
 		CHECK_TEXTURE_ALREADY_LOADED;
 
@@ -2192,6 +2761,10 @@ byte *GL_LoadImagePixels (char *filename, int matchwidth, int matchheight, int m
 		case image_JPG:
 			data = Image_LoadJPEG(f, name, matchwidth, matchheight);
 			break;
+		default:	// compressed images aren't asked for here
+			fclose (f);
+			data = NULL;
+			break;
 		}
 
 		if (data)
@@ -2209,13 +2782,13 @@ byte *GL_LoadImagePixels (char *filename, int matchwidth, int matchheight, int m
 	return NULL;
 }
 
-int GL_LoadTexturePixels (byte *data, char *identifier, int width, int height, int mode)
+// drops TEX_ALPHA from fully opaque images and applies the hardware gamma
+// table, returns the adjusted mode
+static int GL_PrepareImagePixels (byte *data, int width, int height, int mode, qboolean gamma)
 {
 	int		i, j, image_size;
-	qboolean	gamma;
 
 	image_size = width * height;
-	gamma = (vid_gamma != 1);
 
 	if (mode & TEX_LUMA)
 	{
@@ -2244,9 +2817,428 @@ int GL_LoadTexturePixels (byte *data, char *identifier, int width, int height, i
 		}
 	}
 
+	return mode;
+}
+
+int GL_LoadTexturePixels (byte *data, char *identifier, int width, int height, int mode)
+{
+	mode = GL_PrepareImagePixels (data, width, height, mode, vid_gamma != 1);
+
 	return GL_LoadTexture (identifier, width, height, data, mode, 4);
 }
 
+/*
+=========================================================
+
+			External images
+
+GL_LoadTextureImage hashes the file against the texture cache, and decodes,
+applies gamma and resamples it on a miss.  Between GL_BeginImageBatch and
+GL_EndImageBatch that work runs on the task workers: the file is opened on
+the main thread, the texture slot and number are handed out right away and
+the uploads happen in order whenever the queue fills up, when a pending
+texture is looked up, and at the end of the batch.
+
+=========================================================
+*/
+
+#define	MAX_IMAGEJOBS	32	// bounds the open files and decoded images
+
+typedef struct
+{
+	FILE		*f;
+	int			filesize;
+	char		name[256];
+	int			filetype;
+	int			mode;
+	qboolean	gamma;
+	scaleparms_t	parms;
+	uint64_t	parmhash;
+	teximage_t	img;		// img.chain.data is NULL if the image could not be loaded
+} imageload_t;
+
+// what the caller does to load the texture again if the image can't be decoded
+typedef struct
+{
+	imageretry_t	func;
+	void		*data;
+} imagefallback_t;
+
+typedef struct
+{
+	task_t		*task;
+	gltexture_t	*glt;
+	imageload_t	load;
+	imagefallback_t	fallback;
+} imagejob_t;
+
+static	qboolean	imagebatch_active;
+static	imagejob_t	imagejobs[MAX_IMAGEJOBS];
+static	int			imagejobs_head, imagejobs_count;
+static	imagefallback_t	imagebatch_fallback;
+static	imagefallback_t	*imageretries;		// run at the end of the batch
+static	int			imageretries_count, imageretries_size;
+
+// captures everything GL_LoadImageFile needs from the main thread
+static void GL_SetupImageLoad (imageload_t *load, FILE *f, char *name, int mode)
+{
+	load->f = f;
+	load->filesize = com_filesize;
+	Q_strncpyz (load->name, name, sizeof(load->name));
+	load->filetype = com_filetype;
+	load->mode = mode;
+	load->gamma = (vid_gamma != 1 && !(mode & TEX_LUMA));
+	GL_GetScaleParms (&load->parms, mode);
+	load->parmhash = TexCache_ParmHash (mode, load->gamma, 4);
+	load->img.chain.data = NULL;
+}
+
+static uint64_t GL_HashImageFile (imageload_t *load)
+{
+	byte		buf[16384];
+	int			len, remaining;
+	long		start;
+	uint64_t	key;
+
+	start = ftell (load->f);
+	key = load->parmhash;
+	for (remaining = load->filesize ; remaining > 0 ; remaining -= len)
+	{
+		if ((len = fread(buf, 1, min(remaining, sizeof(buf)), load->f)) <= 0)
+			break;
+		key = TexCache_Hash (key, buf, len);
+	}
+	fseek (load->f, start, SEEK_SET);
+
+	return key;
+}
+
+// drops the levels of a precompressed chain that are above the upload size,
+// and all but the top one when the texture isn't mipmapped.  Returns false
+// if it runs out of levels before getting down to that size
+static qboolean GL_TrimMipChain (mipchain_t *chain, int mode, scaleparms_t *parms)
+{
+	int		i, skip;
+
+	for (i = skip = 0 ; ; i++)
+	{
+		if (i >= parms->picmip && chain->width <= parms->maxsize && chain->height <= parms->maxsize)
+			break;
+		if (chain->numlevels == 1)
+			return false;
+		skip += Image_MipLevelSize (chain->format, chain->width, chain->height);
+		chain->width = max(1, chain->width >> 1);
+		chain->height = max(1, chain->height >> 1);
+		chain->numlevels--;
+	}
+
+	if (!(mode & TEX_MIPMAP))
+		chain->numlevels = 1;
+
+	chain->size = 0;
+	for (i = 0 ; i < chain->numlevels ; i++)
+		chain->size += Image_MipLevelSize (chain->format, max(1, chain->width >> i), max(1, chain->height >> i));
+	memmove (chain->data, chain->data + skip, chain->size);
+
+	return true;
+}
+
+// precompressed images are uploaded as they are, they skip the texture cache
+// and the gamma table
+static void GL_LoadCompressedImageFile (imageload_t *load)
+{
+	qboolean	loaded;
+
+	if (load->filetype == image_DDS)
+		loaded = Image_LoadDDS (load->f, load->name, &load->img.chain);
+	else
+		loaded = Image_LoadKTX (load->f, load->name, &load->img.chain);
+
+	if (!loaded)
+		return;
+
+	// DDS can't tell DXT1 with 1 bit alpha from DXT1 without
+	if (load->img.chain.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT && (load->mode & TEX_ALPHA))
+		load->img.chain.format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+
+	load->img.width = image_width;
+	load->img.height = image_height;
+	load->img.mode = load->mode;
+	load->img.crc = CRC_Block (load->img.chain.data, Image_MipLevelSize(load->img.chain.format, image_width, image_height));
+	if (!GL_TrimMipChain(&load->img.chain, load->mode, &load->parms))
+	{
+		// compressed levels can't be resampled
+		Con_DPrintf ("%s doesn't have the mip levels for gl_picmip and gl_max_size\n", COM_SkipPath(load->name));
+		free (load->img.chain.data);
+		load->img.chain.data = NULL;
+	}
+}
+
+// runs on a task worker inside an image batch, closes the file
+static void GL_LoadImageFile (imageload_t *load)
+{
+	byte		*pixels = NULL;
+	uint64_t	key = 0;
+
+	if (load->filetype == image_DDS || load->filetype == image_KTX)
+	{
+		GL_LoadCompressedImageFile (load);
+		return;
+	}
+
+	if (load->parmhash)
+	{
+		key = GL_HashImageFile (load);
+		if (TexCache_Read(key, &load->img))
+		{
+			fclose (load->f);
+			return;
+		}
+	}
+
+	switch (load->filetype)
+	{
+	case image_TGA:
+		pixels = Image_LoadTGA (load->f, load->name, 0, 0);
+		break;
+	case image_PNG:
+		pixels = Image_LoadPNG (load->f, load->name, 0, 0);
+		break;
+	case image_JPG:
+		pixels = Image_LoadJPEG (load->f, load->name, 0, 0);
+		break;
+	}
+
+	if (!pixels)
+		return;
+
+	load->img.width = image_width;
+	load->img.height = image_height;
+	load->img.mode = GL_PrepareImagePixels (pixels, image_width, image_height, load->mode, load->gamma);
+	load->img.crc = CRC_Block (pixels, image_width * image_height * 4);
+	GL_BuildMipChain ((unsigned *)pixels, image_width, image_height, load->img.mode, &load->parms, &load->img.chain);
+	free (pixels);
+
+	if (key)
+		TexCache_Write (key, &load->img);
+}
+
+static void GL_ImageJob (void *data)
+{
+	GL_LoadImageFile (&((imagejob_t *)data)->load);
+}
+
+static void GL_FinishImageJob (void)
+{
+	imagejob_t	*job = &imagejobs[imagejobs_head];
+	gltexture_t	*glt = job->glt;
+	teximage_t	*img = &job->load.img;
+	static	unsigned	checker[4] = {0xFFFF00FF, 0xFF000000, 0xFF000000, 0xFFFF00FF};
+	static	unsigned	transparent[4] = {0, 0, 0, 0};
+
+	Task_Wait (job->task);
+	imagejobs_head = (imagejobs_head + 1) % MAX_IMAGEJOBS;
+	imagejobs_count--;
+
+	glt->pending = false;
+	GL_Bind (glt->texnum);
+
+	if (!img->chain.data)
+	{
+		Con_Printf ("\x02" "Couldn't load %s image\n", COM_SkipPath(job->load.name));
+		Z_Free (glt->pathname);
+		glt->pathname = NULL;
+		glt->texmode = job->load.mode;
+
+		// the texture number is out already, so something goes into it until
+		// the caller has had a go at the other images; a luma layer that
+		// can't be loaded just adds nothing
+		glt->width = glt->height = glt->scaled_width = glt->scaled_height = 2;
+		glt->crc = 0;
+		if (glt->texmode & TEX_LUMA)
+		{
+			glt->texmode |= TEX_ALPHA;
+			GL_Upload32 (transparent, 2, 2, glt->texmode);
+		}
+		else
+		{
+			glt->texmode &= ~TEX_ALPHA;
+			GL_Upload32 (checker, 2, 2, glt->texmode);
+		}
+
+		if (job->fallback.func)
+		{
+			if (imageretries_count == imageretries_size)
+			{
+				imageretries_size = max(16, imageretries_size * 2);
+				imageretries = Q_realloc (imageretries, imageretries_size * sizeof(*imageretries));
+			}
+			imageretries[imageretries_count++] = job->fallback;
+		}
+		return;
+	}
+
+	glt->width = img->width;
+	glt->height = img->height;
+	glt->scaled_width = img->chain.width;
+	glt->scaled_height = img->chain.height;
+	glt->texmode = img->mode;
+	glt->crc = img->crc;
+	GL_UploadMipChain (&img->chain, img->mode);
+
+	free (img->chain.data);
+}
+
+static void GL_FlushImageJobs (void)
+{
+	while (imagejobs_count)
+		GL_FinishImageJob ();
+}
+
+// the loads are synchronous from here, so the retries can't fail into
+// the list they are taken from
+static void GL_RunImageRetries (void)
+{
+	int		i;
+
+	imagebatch_active = false;
+	for (i = 0 ; i < imageretries_count ; i++)
+		imageretries[i].func (imageretries[i].data);
+	imageretries_count = 0;
+}
+
+static int GL_QueueImageLoad (gltexture_t *glt, char *identifier, FILE *f, char *name, int mode)
+{
+	imagejob_t	*job;
+
+	if (imagejobs_count == MAX_IMAGEJOBS)
+		GL_FinishImageJob ();
+
+	if (!glt)
+	{
+		if (numgltextures == MAX_GLTEXTURES)
+			Sys_Error ("GL_LoadTexture: numgltextures == MAX_GLTEXTURES");
+
+		glt = &gltextures[numgltextures];
+		numgltextures++;
+
+		Q_strncpyz (glt->identifier, identifier, sizeof(glt->identifier));
+		glt->texnum = texture_extension_number;
+		texture_extension_number++;
+	}
+
+	glt->bpp = 4;
+	glt->pending = true;
+	if (glt->pathname)
+		Z_Free (glt->pathname);
+	glt->pathname = CopyString (com_netpath);
+
+	job = &imagejobs[(imagejobs_head + imagejobs_count) % MAX_IMAGEJOBS];
+	imagejobs_count++;
+
+	job->glt = glt;
+	job->fallback = imagebatch_fallback;
+	imagebatch_fallback.func = NULL;
+	GL_SetupImageLoad (&job->load, f, name, mode);
+	job->task = Task_Submit (GL_ImageJob, job);
+
+	return glt->texnum;
+}
+
+// sets image_width and image_height like GL_LoadImagePixels, except when
+// the load is queued in a batch
+static int GL_LoadTextureFile (char *filename, char *identifier, int mode)
+{
+	char		name[256];
+	qboolean	cached;
+	FILE		*f;
+	gltexture_t	*glt;
+	imageload_t	load;
+
+	current_texture = glt = GL_FindTexture (identifier);
+
+	if (!(f = GL_OpenImageFile(filename, name, sizeof(name), true)))
+		goto GL_LoadTextureFile_fail;
+
+	if (CheckTextureLoaded(mode))
+	{
+		image_width = glt->width;
+		image_height = glt->height;
+		current_texture = NULL;
+		fclose (f);
+		return glt->texnum;
+	}
+	current_texture = NULL;
+
+	if (imagebatch_active)
+		return GL_QueueImageLoad (glt, identifier, f, name, mode);
+
+	GL_SetupImageLoad (&load, f, name, mode);
+	GL_LoadImageFile (&load);
+	if (!load.img.chain.data)
+		goto GL_LoadTextureFile_fail;
+
+	image_width = load.img.width;
+	image_height = load.img.height;
+
+	glt = GL_AllocTextureSlot (identifier, load.img.width, load.img.height, load.img.chain.width, load.img.chain.height, load.img.crc, load.img.mode, 4, &cached);
+	GL_Bind (glt->texnum);
+	if (!cached)
+		GL_UploadMipChain (&load.img.chain, load.img.mode);
+	free (load.img.chain.data);
+
+	return glt->texnum;
+
+GL_LoadTextureFile_fail:
+	if (mode & TEX_COMPLAIN)
+		Con_Printf ("\x02" "Couldn't load %s image\n", COM_SkipPath(filename));
+	current_texture = NULL;
+	return 0;
+}
+
+/*
+================
+GL_BeginImageBatch
+
+Batches do not nest; a batch left open by an error is flushed by the next
+one, without its retries.  Returns false when there are no workers to hand
+the images to.
+================
+*/
+qboolean GL_BeginImageBatch (void)
+{
+	GL_FlushImageJobs ();
+	imageretries_count = 0;
+	imagebatch_fallback.func = NULL;
+	imagebatch_active = !!Tasks_NumWorkers ();
+
+	return imagebatch_active;
+}
+
+void GL_EndImageBatch (void)
+{
+	GL_FlushImageJobs ();
+	imagebatch_fallback.func = NULL;
+	GL_RunImageRetries ();
+}
+
+/*
+================
+GL_SetImageRetry
+
+If the next image queued in the batch can't be decoded, func is called
+with data once the batch has been flushed, with the loads back to being
+synchronous, so the caller can go through its other images and its 8 bit
+texture again.  data has to stay around until the batch ends.  Pass NULL
+once the image has been asked for.
+================
+*/
+void GL_SetImageRetry (imageretry_t func, void *data)
+{
+	imagebatch_fallback.func = func;
+	imagebatch_fallback.data = data;
+}
+
 int GL_LoadTextureImage (char *filename, char *identifier, int matchwidth, int matchheight, int mode)
 {
 	int texnum;
@@ -2259,6 +3251,9 @@ int GL_LoadTextureImage (char *filename, char *identifier, int matchwidth, int m
 	if (!identifier)
 		identifier = filename;
 
+	if (!matchwidth && !matchheight)
+		return GL_LoadTextureFile (filename, identifier, mode);
+
 	gltexture = current_texture = GL_FindTexture (identifier);
 
 	if (!(data = GL_LoadImagePixels(filename, matchwidth, matchheight, mode)))
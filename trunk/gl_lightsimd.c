@@ -0,0 +1,525 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// gl_lightsimd.c -- SSE2/AVX2 versions of the lightmap building kernels
+//
+// Like the texture kernels, these must produce exactly what the scalar ones
+// do, lightbench checks that.  blocklights is RGB interleaved, so the
+// vector kernels work on 4 or 8 texels and spread each result over 3 lanes.
+
+#include "quakedef.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define	LIGHTSIMD_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define	TARGET_SSE2
+#define	TARGET_AVX2
+#else
+#define	TARGET_SSE2	__attribute__((target("sse2")))
+#define	TARGET_AVX2	__attribute__((target("avx2")))
+#endif
+#endif
+
+qboolean OnChange_gl_lightsimd (cvar_t *var, char *string);
+cvar_t	gl_lightsimd = {"gl_lightsimd", "1", 0, OnChange_gl_lightsimd};
+
+/*
+=========================================================
+
+			Scalar
+
+=========================================================
+*/
+
+static void AddLightmap_Scalar (unsigned *bl, byte *lightmap, unsigned scale, int count)
+{
+	int	i;
+
+	for (i = 0 ; i < count ; i++)
+		bl[i] += lightmap[i] * scale;
+}
+
+// the texels of a row from s on
+static void AddDlightRow_Scalar (unsigned *dest, int s, int smax, int sd0, int td, int irad, int iminlight, int *color)
+{
+	int	sd, idist, tmp;
+
+	for (sd0 -= s * 16, dest += s * 3 ; s < smax ; s++, sd0 -= 16, dest += 3)
+	{
+		sd = sd0 < 0 ? -sd0 : sd0;
+		idist = (sd > td) ? (sd << 8) + (td << 7) : (td << 8) + (sd << 7);
+		if (idist < iminlight)
+		{
+			tmp = (irad - idist) >> 7;
+			dest[0] += tmp * color[0];
+			dest[1] += tmp * color[1];
+			dest[2] += tmp * color[2];
+		}
+	}
+}
+
+static void AddDlight_Scalar (unsigned *dest, int smax, int tmax, int sd0, int td0, int irad, int iminlight, int *color)
+{
+	int	t;
+
+	for (t = 0 ; t < tmax ; t++, td0 -= 16, dest += smax * 3)
+		AddDlightRow_Scalar (dest, 0, smax, sd0, td0 < 0 ? -td0 : td0, irad, iminlight, color);
+}
+
+// the texels of a row from s on
+static void PackRow_Scalar (byte *dest, unsigned *bl, int s, int smax, int shift, int maxvalue, qboolean bgra, qboolean packed)
+{
+	int	r, g, b;
+
+	for (dest += s * 4, bl += s * 3 ; s < smax ; s++, dest += 4, bl += 3)
+	{
+		r = bl[0] >> shift;
+		g = bl[1] >> shift;
+		b = bl[2] >> shift;
+		r = min(r, maxvalue);
+		g = min(g, maxvalue);
+		b = min(b, maxvalue);
+
+		if (bgra)
+		{
+			r ^= b;
+			b ^= r;
+			r ^= b;
+		}
+
+		if (packed)
+		{
+			*(unsigned *)dest = (r << 22) | (g << 12) | (b << 2) | 3;
+		}
+		else
+		{
+			dest[0] = r;
+			dest[1] = g;
+			dest[2] = b;
+			dest[3] = 255;
+		}
+	}
+}
+
+static void PackLightmap_Scalar (byte *dest, int stride, unsigned *bl, int smax, int tmax, int shift, int maxvalue, qboolean bgra, qboolean packed)
+{
+	int	t;
+
+	for (t = 0 ; t < tmax ; t++, dest += stride, bl += smax * 3)
+		PackRow_Scalar (dest, bl, 0, smax, shift, maxvalue, bgra, packed);
+}
+
+#ifdef LIGHTSIMD_X86
+/*
+=========================================================
+
+			SSE2
+
+=========================================================
+*/
+
+TARGET_SSE2 static void AddLightmap_SSE2 (unsigned *bl, byte *lightmap, unsigned scale, int count)
+{
+	int		i;
+	__m128i	zero = _mm_setzero_si128(), s, x, lo, hi, l;
+
+	// the products are split into 16 bit halves, which takes a scale that
+	// fits 16 bits; lightstyles stay well below that
+	if (scale > 0xFFFF)
+	{
+		AddLightmap_Scalar (bl, lightmap, scale, count);
+		return;
+	}
+
+	s = _mm_set1_epi16 ((short)scale);
+	for (i = 0 ; i + 16 <= count ; i += 16)
+	{
+		x = _mm_loadu_si128 ((__m128i *)(lightmap + i));
+
+		l = _mm_unpacklo_epi8 (x, zero);
+		lo = _mm_mullo_epi16 (l, s);
+		hi = _mm_mulhi_epu16 (l, s);
+		_mm_storeu_si128 ((__m128i *)(bl + i), _mm_add_epi32(_mm_loadu_si128((__m128i *)(bl + i)), _mm_unpacklo_epi16(lo, hi)));
+		_mm_storeu_si128 ((__m128i *)(bl + i + 4), _mm_add_epi32(_mm_loadu_si128((__m128i *)(bl + i + 4)), _mm_unpackhi_epi16(lo, hi)));
+
+		l = _mm_unpackhi_epi8 (x, zero);
+		lo = _mm_mullo_epi16 (l, s);
+		hi = _mm_mulhi_epu16 (l, s);
+		_mm_storeu_si128 ((__m128i *)(bl + i + 8), _mm_add_epi32(_mm_loadu_si128((__m128i *)(bl + i + 8)), _mm_unpacklo_epi16(lo, hi)));
+		_mm_storeu_si128 ((__m128i *)(bl + i + 12), _mm_add_epi32(_mm_loadu_si128((__m128i *)(bl + i + 12)), _mm_unpackhi_epi16(lo, hi)));
+	}
+
+	AddLightmap_Scalar (bl + i, lightmap + i, scale, count - i);
+}
+
+// low 32 bits of the products, which SSE2 only has for even lanes
+TARGET_SSE2 static __m128i MulLo32_SSE2 (__m128i a, __m128i b)
+{
+	__m128i	even, odd;
+
+	even = _mm_mul_epu32 (a, b);
+	odd = _mm_mul_epu32 (_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+	return _mm_unpacklo_epi32 (_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+TARGET_SSE2 static void AddDlight_SSE2 (unsigned *dest, int smax, int tmax, int sd0, int td0, int irad, int iminlight, int *color)
+{
+	int		s, t, td;
+	__m128i	sd, sign, tdv, gt, mx, mn, idist, tmp, step, minlight, rad;
+	__m128i	c0, c1, c2;
+	unsigned	*row;
+
+	// lane colors for texels 0 0 0 1, 1 1 2 2, 2 3 3 3
+	c0 = _mm_setr_epi32 (color[0], color[1], color[2], color[0]);
+	c1 = _mm_setr_epi32 (color[1], color[2], color[0], color[1]);
+	c2 = _mm_setr_epi32 (color[2], color[0], color[1], color[2]);
+	step = _mm_set1_epi32 (64);
+	minlight = _mm_set1_epi32 (iminlight);
+	rad = _mm_set1_epi32 (irad);
+
+	for (t = 0 ; t < tmax ; t++, td0 -= 16, dest += smax * 3)
+	{
+		td = td0 < 0 ? -td0 : td0;
+		tdv = _mm_set1_epi32 (td);
+		sd = _mm_setr_epi32 (sd0, sd0 - 16, sd0 - 32, sd0 - 48);
+
+		for (s = 0, row = dest ; s + 4 <= smax ; s += 4, row += 12, sd = _mm_sub_epi32(sd, step))
+		{
+			sign = _mm_srai_epi32 (sd, 31);
+			mx = _mm_sub_epi32 (_mm_xor_si128(sd, sign), sign);	// |sd|
+			gt = _mm_cmpgt_epi32 (mx, tdv);
+			mn = _mm_or_si128 (_mm_and_si128(gt, tdv), _mm_andnot_si128(gt, mx));
+			mx = _mm_or_si128 (_mm_and_si128(gt, mx), _mm_andnot_si128(gt, tdv));
+			idist = _mm_add_epi32 (_mm_slli_epi32(mx, 8), _mm_slli_epi32(mn, 7));
+
+			gt = _mm_cmpgt_epi32 (minlight, idist);
+			if (!_mm_movemask_epi8(gt))
+				continue;
+			tmp = _mm_and_si128 (gt, _mm_srai_epi32(_mm_sub_epi32(rad, idist), 7));
+
+			_mm_storeu_si128 ((__m128i *)row, _mm_add_epi32(_mm_loadu_si128((__m128i *)row),
+				MulLo32_SSE2(_mm_shuffle_epi32(tmp, _MM_SHUFFLE(1, 0, 0, 0)), c0)));
+			_mm_storeu_si128 ((__m128i *)(row + 4), _mm_add_epi32(_mm_loadu_si128((__m128i *)(row + 4)),
+				MulLo32_SSE2(_mm_shuffle_epi32(tmp, _MM_SHUFFLE(2, 2, 1, 1)), c1)));
+			_mm_storeu_si128 ((__m128i *)(row + 8), _mm_add_epi32(_mm_loadu_si128((__m128i *)(row + 8)),
+				MulLo32_SSE2(_mm_shuffle_epi32(tmp, _MM_SHUFFLE(3, 3, 3, 2)), c2)));
+		}
+
+		AddDlightRow_Scalar (dest, s, smax, sd0, td, irad, iminlight, color);
+	}
+}
+
+// shifts and clamps 4 values of one channel
+TARGET_SSE2 static __m128i PackChannel_SSE2 (__m128i x, __m128i shift, __m128i maxvalue)
+{
+	__m128i	gt;
+
+	x = _mm_srl_epi32 (x, shift);
+	gt = _mm_cmpgt_epi32 (x, maxvalue);
+
+	return _mm_or_si128 (_mm_and_si128(gt, maxvalue), _mm_andnot_si128(gt, x));
+}
+
+TARGET_SSE2 static void PackLightmap_SSE2 (byte *dest, int stride, unsigned *bl, int smax, int tmax, int shift, int maxvalue, qboolean bgra, qboolean packed)
+{
+	int		s, t;
+	__m128i	r, g, b, sh, mv, alpha;
+	unsigned	*in;
+
+	sh = _mm_cvtsi32_si128 (shift);
+	mv = _mm_set1_epi32 (maxvalue);
+	alpha = packed ? _mm_set1_epi32 (3) : _mm_set1_epi32 ((int)0xFF000000);
+
+	for (t = 0 ; t < tmax ; t++, dest += stride, bl += smax * 3)
+	{
+		for (s = 0, in = bl ; s + 4 <= smax ; s += 4, in += 12)
+		{
+			r = PackChannel_SSE2 (_mm_setr_epi32(in[0], in[3], in[6], in[9]), sh, mv);
+			g = PackChannel_SSE2 (_mm_setr_epi32(in[1], in[4], in[7], in[10]), sh, mv);
+			b = PackChannel_SSE2 (_mm_setr_epi32(in[2], in[5], in[8], in[11]), sh, mv);
+			if (bgra)
+			{
+				r = _mm_xor_si128 (r, b);
+				b = _mm_xor_si128 (b, r);
+				r = _mm_xor_si128 (r, b);
+			}
+
+			if (packed)
+				r = _mm_or_si128 (_mm_or_si128(_mm_slli_epi32(r, 22), _mm_slli_epi32(g, 12)), _mm_or_si128(_mm_slli_epi32(b, 2), alpha));
+			else
+				r = _mm_or_si128 (_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), alpha));
+			_mm_storeu_si128 ((__m128i *)(dest + s * 4), r);
+		}
+
+		PackRow_Scalar (dest, bl, s, smax, shift, maxvalue, bgra, packed);
+	}
+}
+
+/*
+=========================================================
+
+			AVX2
+
+=========================================================
+*/
+
+TARGET_AVX2 static void AddLightmap_AVX2 (unsigned *bl, byte *lightmap, unsigned scale, int count)
+{
+	int		i;
+	__m256i	s;
+
+	s = _mm256_set1_epi32 ((int)scale);
+	for (i = 0 ; i + 8 <= count ; i += 8)
+	{
+		__m256i	x = _mm256_cvtepu8_epi32 (_mm_loadl_epi64((__m128i *)(lightmap + i)));
+
+		_mm256_storeu_si256 ((__m256i *)(bl + i), _mm256_add_epi32(_mm256_loadu_si256((__m256i *)(bl + i)), _mm256_mullo_epi32(x, s)));
+	}
+
+	AddLightmap_Scalar (bl + i, lightmap + i, scale, count - i);
+}
+
+TARGET_AVX2 static void AddDlight_AVX2 (unsigned *dest, int smax, int tmax, int sd0, int td0, int irad, int iminlight, int *color)
+{
+	int		s, t, td;
+	__m256i	sd, tdv, mx, mn, idist, mask, tmp, step, minlight, rad;
+	__m256i	c0, c1, c2, i0, i1, i2;
+	unsigned	*row;
+
+	// texels 0 0 0 1 1 1 2 2, 2 3 3 3 4 4 4 5, 5 5 6 6 6 7 7 7
+	i0 = _mm256_setr_epi32 (0, 0, 0, 1, 1, 1, 2, 2);
+	i1 = _mm256_setr_epi32 (2, 3, 3, 3, 4, 4, 4, 5);
+	i2 = _mm256_setr_epi32 (5, 5, 6, 6, 6, 7, 7, 7);
+	c0 = _mm256_setr_epi32 (color[0], color[1], color[2], color[0], color[1], color[2], color[0], color[1]);
+	c1 = _mm256_setr_epi32 (color[2], color[0], color[1], color[2], color[0], color[1], color[2], color[0]);
+	c2 = _mm256_setr_epi32 (color[1], color[2], color[0], color[1], color[2], color[0], color[1], color[2]);
+	step = _mm256_set1_epi32 (128);
+	minlight = _mm256_set1_epi32 (iminlight);
+	rad = _mm256_set1_epi32 (irad);
+
+	for (t = 0 ; t < tmax ; t++, td0 -= 16, dest += smax * 3)
+	{
+		td = td0 < 0 ? -td0 : td0;
+		tdv = _mm256_set1_epi32 (td);
+		sd = _mm256_setr_epi32 (sd0, sd0 - 16, sd0 - 32, sd0 - 48, sd0 - 64, sd0 - 80, sd0 - 96, sd0 - 112);
+
+		for (s = 0, row = dest ; s + 8 <= smax ; s += 8, row += 24, sd = _mm256_sub_epi32(sd, step))
+		{
+			mx = _mm256_abs_epi32 (sd);
+			mn = _mm256_min_epi32 (mx, tdv);
+			mx = _mm256_max_epi32 (mx, tdv);
+			idist = _mm256_add_epi32 (_mm256_slli_epi32(mx, 8), _mm256_slli_epi32(mn, 7));
+
+			mask = _mm256_cmpgt_epi32 (minlight, idist);
+			if (_mm256_testz_si256(mask, mask))
+				continue;
+			tmp = _mm256_and_si256 (mask, _mm256_srai_epi32(_mm256_sub_epi32(rad, idist), 7));
+
+			_mm256_storeu_si256 ((__m256i *)row, _mm256_add_epi32(_mm256_loadu_si256((__m256i *)row),
+				_mm256_mullo_epi32(_mm256_permutevar8x32_epi32(tmp, i0), c0)));
+			_mm256_storeu_si256 ((__m256i *)(row + 8), _mm256_add_epi32(_mm256_loadu_si256((__m256i *)(row + 8)),
+				_mm256_mullo_epi32(_mm256_permutevar8x32_epi32(tmp, i1), c1)));
+			_mm256_storeu_si256 ((__m256i *)(row + 16), _mm256_add_epi32(_mm256_loadu_si256((__m256i *)(row + 16)),
+				_mm256_mullo_epi32(_mm256_permutevar8x32_epi32(tmp, i2), c2)));
+		}
+
+		AddDlightRow_Scalar (dest, s, smax, sd0, td, irad, iminlight, color);
+	}
+}
+
+TARGET_AVX2 static void PackLightmap_AVX2 (byte *dest, int stride, unsigned *bl, int smax, int tmax, int shift, int maxvalue, qboolean bgra, qboolean packed)
+{
+	int		s, t;
+	__m256i	r, g, b, mv, alpha, idx, tmp;
+	__m128i	sh;
+	unsigned	*in;
+
+	idx = _mm256_setr_epi32 (0, 3, 6, 9, 12, 15, 18, 21);
+	sh = _mm_cvtsi32_si128 (shift);
+	mv = _mm256_set1_epi32 (maxvalue);
+	alpha = packed ? _mm256_set1_epi32 (3) : _mm256_set1_epi32 ((int)0xFF000000);
+
+	for (t = 0 ; t < tmax ; t++, dest += stride, bl += smax * 3)
+	{
+		for (s = 0, in = bl ; s + 8 <= smax ; s += 8, in += 24)
+		{
+			r = _mm256_min_epi32 (_mm256_srl_epi32(_mm256_i32gather_epi32((int *)in, idx, 4), sh), mv);
+			g = _mm256_min_epi32 (_mm256_srl_epi32(_mm256_i32gather_epi32((int *)in + 1, idx, 4), sh), mv);
+			b = _mm256_min_epi32 (_mm256_srl_epi32(_mm256_i32gather_epi32((int *)in + 2, idx, 4), sh), mv);
+			if (bgra)
+			{
+				tmp = r;
+				r = b;
+				b = tmp;
+			}
+
+			if (packed)
+				r = _mm256_or_si256 (_mm256_or_si256(_mm256_slli_epi32(r, 22), _mm256_slli_epi32(g, 12)), _mm256_or_si256(_mm256_slli_epi32(b, 2), alpha));
+			else
+				r = _mm256_or_si256 (_mm256_or_si256(r, _mm256_slli_epi32(g, 8)), _mm256_or_si256(_mm256_slli_epi32(b, 16), alpha));
+			_mm256_storeu_si256 ((__m256i *)(dest + s * 4), r);
+		}
+
+		PackRow_Scalar (dest, bl, s, smax, shift, maxvalue, bgra, packed);
+	}
+}
+#endif	// LIGHTSIMD_X86
+
+/*
+=========================================================
+
+			Selection
+
+=========================================================
+*/
+
+static lightkernels_t	lightkernels_list[] =
+{
+	{"scalar", AddLightmap_Scalar, AddDlight_Scalar, PackLightmap_Scalar},
+#ifdef LIGHTSIMD_X86
+	{"SSE2", AddLightmap_SSE2, AddDlight_SSE2, PackLightmap_SSE2},
+	{"AVX2", AddLightmap_AVX2, AddDlight_AVX2, PackLightmap_AVX2},
+#endif
+};
+
+#define	NUM_LIGHTKERNELS	(sizeof(lightkernels_list) / sizeof(lightkernels_list[0]))
+
+lightkernels_t	*lightkernels = &lightkernels_list[0];
+
+static qboolean LightKernels_Supported (lightkernels_t *k)
+{
+#ifdef LIGHTSIMD_X86
+	if (!strcmp(k->name, "SSE2"))
+		return CPU_HasSSE2 ();
+	if (!strcmp(k->name, "AVX2"))
+		return CPU_HasAVX2 ();
+#endif
+	return true;
+}
+
+// picks the last supported entry, they're in order of preference
+static lightkernels_t *LightKernels_Best (void)
+{
+	int	i;
+
+	for (i = NUM_LIGHTKERNELS - 1 ; i > 0 ; i--)
+		if (LightKernels_Supported(&lightkernels_list[i]))
+			return &lightkernels_list[i];
+
+	return &lightkernels_list[0];
+}
+
+qboolean OnChange_gl_lightsimd (cvar_t *var, char *string)
+{
+	lightkernels = Q_atof(string) ? LightKernels_Best () : &lightkernels_list[0];
+
+	return false;
+}
+
+/*
+====================
+LightBench_f
+
+Builds a synthetic surface with every kernel set, four styles and a pile
+of dlights, packed every way there is, and checks the output matches the
+scalar one byte for byte
+====================
+*/
+#define	BENCH_SMAX		61		// odd sizes, so the tails get their share
+#define	BENCH_TMAX		37
+#define	BENCH_SIZE		(BENCH_SMAX * BENCH_TMAX)
+#define	BENCH_STYLES	4
+#define	BENCH_DLIGHTS	8
+#define	BENCH_RUNS		2000
+#define	BENCH_OUT		(BENCH_SIZE * 4 * 4)
+
+// leaves the four packings of the surface in out
+static double LightBench_Run (lightkernels_t *k, byte *samples, unsigned *bl, byte *out)
+{
+	int		i, j, color[3] = {100, 50, 10};
+	double	start;
+
+	start = Sys_DoubleTime ();
+	for (i = 0 ; i < BENCH_RUNS ; i++)
+	{
+		memset (bl, 0, BENCH_SIZE * 3 * sizeof(unsigned));
+		for (j = 0 ; j < BENCH_STYLES ; j++)
+			k->addlightmap (bl, samples + j * BENCH_SIZE * 3, 22 * (j * 7 + 3), BENCH_SIZE * 3);
+		for (j = 0 ; j < BENCH_DLIGHTS ; j++)
+			k->adddlight (bl, BENCH_SMAX, BENCH_TMAX, j * 131 - 200, j * 97 - 150, 350 * 256, 350 * 256 - 8 * 256, color);
+
+		k->packlightmap (out, BENCH_SMAX * 4, bl, BENCH_SMAX, BENCH_TMAX, 7, 255, false, false);
+		k->packlightmap (out + BENCH_SIZE * 4, BENCH_SMAX * 4, bl, BENCH_SMAX, BENCH_TMAX, 8, 255, true, false);
+		k->packlightmap (out + BENCH_SIZE * 8, BENCH_SMAX * 4, bl, BENCH_SMAX, BENCH_TMAX, 8, 1023, false, true);
+		k->packlightmap (out + BENCH_SIZE * 12, BENCH_SMAX * 4, bl, BENCH_SMAX, BENCH_TMAX, 7, 255, true, true);
+	}
+
+	return (Sys_DoubleTime() - start) * 1000000 / BENCH_RUNS;
+}
+
+static void LightBench_f (void)
+{
+	int			i;
+	byte		*samples, *ref, *dst;
+	unsigned	*bl, seed = 1;
+	double		us;
+
+	samples = Q_malloc (BENCH_SIZE * 3 * BENCH_STYLES);
+	bl = Q_malloc (BENCH_SIZE * 3 * sizeof(unsigned));
+	ref = Q_malloc (BENCH_OUT);
+	dst = Q_malloc (BENCH_OUT);
+
+	for (i = 0 ; i < BENCH_SIZE * 3 * BENCH_STYLES ; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		samples[i] = (byte)(seed >> 16);
+	}
+
+	Con_Printf ("%dx%d surface, %d styles, %d dlights, 4 packings, %d runs:\n",
+		BENCH_SMAX, BENCH_TMAX, BENCH_STYLES, BENCH_DLIGHTS, BENCH_RUNS);
+	for (i = 0 ; i < NUM_LIGHTKERNELS ; i++)
+	{
+		if (!LightKernels_Supported(&lightkernels_list[i]))
+		{
+			Con_Printf ("%-8s not supported by this CPU\n", lightkernels_list[i].name);
+			continue;
+		}
+
+		us = LightBench_Run (&lightkernels_list[i], samples, bl, i ? dst : ref);
+		Con_Printf ("%-8s %8.2f us  %s\n", lightkernels_list[i].name, us,
+			!i ? "reference" : memcmp(ref, dst, BENCH_OUT) ? "MISMATCH" : "identical");
+	}
+	Con_Printf ("in use: %s\n", lightkernels->name);
+
+	free (samples);
+	free (bl);
+	free (ref);
+	free (dst);
+}
+
+void LightKernels_Init (void)
+{
+	Cvar_Register (&gl_lightsimd);
+	Cmd_AddCommand ("lightbench", LightBench_f);
+
+	lightkernels = gl_lightsimd.value ? LightKernels_Best () : &lightkernels_list[0];
+}
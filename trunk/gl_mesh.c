@@ -623,3 +623,99 @@ static void GLMesh_LoadVertexBuffer(model_t *m, const aliashdr_t *hdr)
 	// invalidate the cached bindings
 	GL_ClearBufferBindings();
 }
+
+/*
+================
+GLMesh_LoadQ3VertexBuffer
+
+Upload the given MD3 model's surfaces to a VBO. Each surface gets its
+numframes*numverts md3vbovert_t followed by its numverts meshst_t, and
+numtris*3 unsigned shorts in the index buffer, in surface order (see
+GLMD3_GetSurfaceOffsets in gl_rmain.c)
+================
+*/
+void GLMesh_LoadQ3VertexBuffer (model_t *m, const md3header_t *hdr)
+{
+	int			i, j, totalvbosize, totalindexes, xyzofs, indexofs;
+	byte		*vbodata;
+	unsigned short *indexes;
+	const md3surface_t *surf;
+
+	if (!gl_glsl_alias_able)
+		return;
+
+	m->vboindexofs = m->vboxyzofs = m->vbostofs = 0;
+
+	// count the sizes we need
+	totalvbosize = totalindexes = 0;
+	surf = (md3surface_t *)((byte *)hdr + hdr->ofssurfs);
+	for (i = 0 ; i < hdr->numsurfs ; i++)
+	{
+		totalvbosize += surf->numframes * surf->numverts * sizeof(md3vbovert_t);
+		totalvbosize += surf->numverts * sizeof(meshst_t);
+		totalindexes += surf->numtris * 3;
+		surf = (md3surface_t *)((byte *)surf + surf->ofsend);
+	}
+
+	if (!totalvbosize || !totalindexes)
+		return;
+
+	vbodata = (byte *)Q_malloc(totalvbosize);
+	indexes = (unsigned short *)Q_malloc(totalindexes * sizeof(unsigned short));
+
+	xyzofs = indexofs = 0;
+	surf = (md3surface_t *)((byte *)hdr + hdr->ofssurfs);
+	for (i = 0 ; i < hdr->numsurfs ; i++)
+	{
+		const md3vert_mem_t	*verts = (md3vert_mem_t *)((byte *)hdr + surf->ofsverts);
+		const md3tc_t		*tc = (md3tc_t *)((byte *)surf + surf->ofstc);
+		const unsigned int	*tris = (unsigned int *)((byte *)surf + surf->ofstris);
+		md3vbovert_t		*xyz = (md3vbovert_t *)(vbodata + xyzofs);
+		meshst_t			*st;
+
+		for (j = 0 ; j < surf->numframes * surf->numverts ; j++)
+		{
+			VectorCopy(verts[j].vec, xyz[j].xyz);
+			xyz[j].normal[0] = 127 * verts[j].normal[0];
+			xyz[j].normal[1] = 127 * verts[j].normal[1];
+			xyz[j].normal[2] = 127 * verts[j].normal[2];
+			xyz[j].normal[3] = 0;
+			xyz[j].anorm[0] = verts[j].anorm_pitch;
+			xyz[j].anorm[1] = verts[j].anorm_yaw;
+			xyz[j].anorm[2] = xyz[j].anorm[3] = 0;
+		}
+		xyzofs += surf->numframes * surf->numverts * sizeof(md3vbovert_t);
+
+		// the teleport effect stretches its texture vertically
+		st = (meshst_t *)(vbodata + xyzofs);
+		for (j = 0 ; j < surf->numverts ; j++)
+		{
+			st[j].st[0] = tc[j].s;
+			st[j].st[1] = (m->modhint == MOD_Q3TELEPORT) ? tc[j].t * 4 : tc[j].t;
+		}
+		xyzofs += surf->numverts * sizeof(meshst_t);
+
+		for (j = 0 ; j < surf->numtris * 3 ; j++)
+			indexes[indexofs++] = tris[j];
+
+		surf = (md3surface_t *)((byte *)surf + surf->ofsend);
+	}
+
+	// upload indices buffer
+	qglDeleteBuffers(1, &m->meshindexesvbo);
+	qglGenBuffers(1, &m->meshindexesvbo);
+	qglBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m->meshindexesvbo);
+	qglBufferData(GL_ELEMENT_ARRAY_BUFFER, totalindexes * sizeof(unsigned short), indexes, GL_STATIC_DRAW);
+
+	// upload vertexes buffer
+	qglDeleteBuffers(1, &m->meshvbo);
+	qglGenBuffers(1, &m->meshvbo);
+	qglBindBuffer(GL_ARRAY_BUFFER, m->meshvbo);
+	qglBufferData(GL_ARRAY_BUFFER, totalvbosize, vbodata, GL_STATIC_DRAW);
+
+	free(indexes);
+	free(vbodata);
+
+	// invalidate the cached bindings
+	GL_ClearBufferBindings();
+}
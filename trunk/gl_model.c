@@ -39,6 +39,27 @@ static int	mod_novis_capacity;
 static byte	*mod_decompressed;
 static int	mod_decompressed_capacity;
 
+// LRU cache of decompressed PVS rows, see Mod_CachedLeafPVS
+typedef struct pvsslot_s
+{
+	int		leafnum;
+	int		prev, next;		// slot indices, -1 at either end
+} pvsslot_t;
+
+static struct
+{
+	mleaf_t		*leafs;			// leaf array the cache was built for
+	int			numleafs;
+	int			rowbytes;		// row size rounded up to a multiple of four
+	int			numslots;		// 0 if the budget can't hold two rows
+	qboolean	full;			// every row expanded, no LRU bookkeeping
+	int			used;
+	int			head, tail;		// most / least recently used slot
+	byte		*rows;
+	pvsslot_t	*slots;
+	int			*leafslot;		// leafnum -> slot, -1 if not cached
+} pvscache;
+
 #define	MAX_MOD_KNOWN	2048 //johnfitz -- was 512
 model_t	mod_known[MAX_MOD_KNOWN];
 int	mod_numknown;
@@ -46,6 +67,17 @@ int	mod_numknown;
 cvar_t	gl_subdivide_size = {"gl_subdivide_size", "128", CVAR_ARCHIVE};
 cvar_t	external_ents = { "external_ents", "1", CVAR_ARCHIVE };
 
+void Mod_FlushPVSCache (void);
+
+qboolean OnChange_gl_pvscache (cvar_t *var, char *string)
+{
+	Mod_FlushPVSCache ();	// rebuilt with the new settings on the next lookup
+	return false;
+}
+
+cvar_t	gl_pvscache_size = {"gl_pvscache_size", "2048", CVAR_ARCHIVE, OnChange_gl_pvscache};	// in kilobytes, 0 disables
+cvar_t	gl_pvscache_full = {"gl_pvscache_full", "1", CVAR_ARCHIVE, OnChange_gl_pvscache};
+
 qboolean OnChange_gl_picmip (cvar_t *var, char *string)
 {
 	int		i;
@@ -93,6 +125,8 @@ void Mod_Init (void)
 {
 	Cvar_Register (&gl_subdivide_size);
 	Cvar_Register (&external_ents);
+	Cvar_Register (&gl_pvscache_size);
+	Cvar_Register (&gl_pvscache_full);
 }
 
 /*
@@ -146,40 +180,21 @@ mleaf_t *Mod_PointInLeaf (vec3_t p, model_t *model)
 
 /*
 ===================
-Mod_DecompressVis
+Mod_DecompressVisRow
 ===================
 */
-byte *Mod_DecompressVis (byte *in, model_t *model)
+static void Mod_DecompressVisRow (byte *in, byte *out, int row)
 {
-	int		c, row;
-	byte	*out, *outend;
+	int		c;
+	byte	*outstart, *outend;
 
-	row = (model->numleafs + 7) >> 3;
-	if (mod_decompressed == NULL || row > mod_decompressed_capacity)
-	{
-		// Sphere -- we have to allocate in multiples of four bytes, because in
-		// R_MarkLeaves, the result of this function will be iterated over in
-		// increments of sizeof(unsigned) which is 4 on the platforms that
-		// are targeted.
-		mod_decompressed_capacity = NextMultipleOfFour(row);
-		mod_decompressed = (byte *)Q_realloc(mod_decompressed, mod_decompressed_capacity);
-		if (!mod_decompressed)
-			Sys_Error("Mod_DecompressVis: realloc() failed on %d bytes", mod_decompressed_capacity);
-	}
-	out = mod_decompressed;
-	outend = mod_decompressed + row;
+	outstart = out;
+	outend = out + row;
 
-#if 0
-	memcpy (out, in, row);
-#else
 	if (!in)
 	{	// no vis info, so make all visible
-		while (row)
-		{
-			*out++ = 0xff;
-			row--;
-		}
-		return mod_decompressed;
+		memset (out, 0xff, row);
+		return;
 	}
 
 	do
@@ -195,22 +210,205 @@ byte *Mod_DecompressVis (byte *in, model_t *model)
 		while (c)
 		{
 			if (out == outend)
-				return mod_decompressed;
+				return;
 
 			*out++ = 0;
 			c--;
 		}
-	} while (out - mod_decompressed < row);
-#endif
-	
+	} while (out - outstart < row);
+}
+
+/*
+===================
+Mod_DecompressVis
+===================
+*/
+byte *Mod_DecompressVis (byte *in, model_t *model)
+{
+	int		row;
+
+	row = (model->numleafs + 7) >> 3;
+	if (mod_decompressed == NULL || row > mod_decompressed_capacity)
+	{
+		// Sphere -- we have to allocate in multiples of four bytes, because in
+		// R_MarkLeaves, the result of this function will be iterated over in
+		// increments of sizeof(unsigned) which is 4 on the platforms that
+		// are targeted.
+		mod_decompressed_capacity = NextMultipleOfFour(row);
+		mod_decompressed = (byte *)Q_realloc(mod_decompressed, mod_decompressed_capacity);
+		if (!mod_decompressed)
+			Sys_Error("Mod_DecompressVis: realloc() failed on %d bytes", mod_decompressed_capacity);
+	}
+
+	Mod_DecompressVisRow (in, mod_decompressed, row);
+
 	return mod_decompressed;
 }
 
+/*
+===================
+Mod_FlushPVSCache
+===================
+*/
+void Mod_FlushPVSCache (void)
+{
+	free (pvscache.rows);
+	free (pvscache.slots);
+	free (pvscache.leafslot);
+	memset (&pvscache, 0, sizeof(pvscache));
+}
+
+/*
+===================
+Mod_InitPVSCache
+
+Sizes the cache for the given model from gl_pvscache_size.  If every row
+fits in the budget and gl_pvscache_full is set, the whole PVS is expanded
+right away so that lookups are a plain array index.
+===================
+*/
+static void Mod_InitPVSCache (model_t *model)
+{
+	int		i, row, numslots;
+	size_t	budget;
+
+	Mod_FlushPVSCache ();
+
+	pvscache.leafs = model->leafs;
+	pvscache.numleafs = model->numleafs;
+	pvscache.head = pvscache.tail = -1;
+
+	row = (model->numleafs + 7) >> 3;
+	pvscache.rowbytes = NextMultipleOfFour(row);
+
+	budget = (size_t)gl_pvscache_size.value * 1024;
+	numslots = (int)min(budget / pvscache.rowbytes, (size_t)model->numleafs);
+	if (numslots < 2)
+		return;		// too small to be worth it, leave numslots at 0
+
+	pvscache.numslots = numslots;
+	pvscache.rows = (byte *)Q_malloc ((size_t)numslots * pvscache.rowbytes);
+
+	if (gl_pvscache_full.value && numslots == model->numleafs)
+	{
+		pvscache.full = true;
+		for (i = 0 ; i < model->numleafs ; i++)
+		{
+			// leaf 0 is the solid leaf and is never cached, so row i belongs to leaf i + 1
+			memset (pvscache.rows + i * pvscache.rowbytes, 0, pvscache.rowbytes);
+			Mod_DecompressVisRow (model->leafs[i+1].compressed_vis, pvscache.rows + i * pvscache.rowbytes, row);
+		}
+		return;
+	}
+
+	pvscache.slots = (pvsslot_t *)Q_malloc (numslots * sizeof(pvsslot_t));
+	pvscache.leafslot = (int *)Q_malloc ((model->numleafs + 1) * sizeof(int));
+	for (i = 0 ; i <= model->numleafs ; i++)
+		pvscache.leafslot[i] = -1;
+}
+
+static void Mod_UnlinkPVSSlot (int slot)
+{
+	pvsslot_t	*s = &pvscache.slots[slot];
+
+	if (s->prev != -1)
+		pvscache.slots[s->prev].next = s->next;
+	else
+		pvscache.head = s->next;
+
+	if (s->next != -1)
+		pvscache.slots[s->next].prev = s->prev;
+	else
+		pvscache.tail = s->prev;
+}
+
+static void Mod_LinkPVSSlot (int slot)
+{
+	pvsslot_t	*s = &pvscache.slots[slot];
+
+	s->prev = -1;
+	s->next = pvscache.head;
+	if (pvscache.head != -1)
+		pvscache.slots[pvscache.head].prev = slot;
+	pvscache.head = slot;
+	if (pvscache.tail == -1)
+		pvscache.tail = slot;
+}
+
+/*
+===================
+Mod_CachedLeafPVS
+
+Returns the decompressed PVS row of a leaf from the cache, decompressing it
+into the least recently used slot on a miss.  The pointer stays valid until
+the row is evicted, which is never sooner than the next call, so callers see
+the same lifetime as with the single mod_decompressed buffer.
+Returns NULL if the cache is disabled or can't handle this leaf.
+===================
+*/
+static byte *Mod_CachedLeafPVS (mleaf_t *leaf, model_t *model)
+{
+	int		leafnum, slot;
+	byte	*out;
+
+	if (gl_pvscache_size.value <= 0)
+		return NULL;
+
+	if (pvscache.leafs != model->leafs || pvscache.numleafs != model->numleafs)
+		Mod_InitPVSCache (model);
+
+	if (!pvscache.numslots)
+		return NULL;
+
+	leafnum = leaf - model->leafs;
+	if (leafnum < 1 || leafnum > model->numleafs)
+		return NULL;	// not a visleaf of this model
+
+	if (pvscache.full)
+		return pvscache.rows + (leafnum - 1) * pvscache.rowbytes;
+
+	if ((slot = pvscache.leafslot[leafnum]) != -1)
+	{
+		if (slot != pvscache.head)
+		{
+			Mod_UnlinkPVSSlot (slot);
+			Mod_LinkPVSSlot (slot);
+		}
+		return pvscache.rows + slot * pvscache.rowbytes;
+	}
+
+	if (pvscache.used < pvscache.numslots)
+	{
+		slot = pvscache.used++;
+	}
+	else
+	{
+		slot = pvscache.tail;
+		pvscache.leafslot[pvscache.slots[slot].leafnum] = -1;
+		Mod_UnlinkPVSSlot (slot);
+	}
+
+	out = pvscache.rows + slot * pvscache.rowbytes;
+	memset (out, 0, pvscache.rowbytes);
+	Mod_DecompressVisRow (leaf->compressed_vis, out, (model->numleafs + 7) >> 3);
+
+	pvscache.slots[slot].leafnum = leafnum;
+	pvscache.leafslot[leafnum] = slot;
+	Mod_LinkPVSSlot (slot);
+
+	return out;
+}
+
 byte *Mod_LeafPVS (mleaf_t *leaf, model_t *model)
 {
+	byte	*row;
+
 	if (leaf == model->leafs)
 		return Mod_NoVisPVS(model);
 
+	if ((row = Mod_CachedLeafPVS(leaf, model)))
+		return row;
+
 	return Mod_DecompressVis (leaf->compressed_vis, model);
 }
 
@@ -241,6 +439,8 @@ void Mod_ClearAll (void)
 	int		i;
 	model_t	*mod;
 
+	Mod_FlushPVSCache ();
+
 	for (i = 0, mod = mod_known ; i < mod_numknown ; i++, mod++)
 	{
 		if (mod->type != mod_alias && mod->type != mod_md3)
@@ -462,6 +662,35 @@ int Mod_LoadBrushModelTexture (texture_t *tx, int flags)
 	return tx->gl_texturenum;
 }
 
+static void Mod_LoadBrushModel8bitTexture (texture_t *tx, texture_t *tx2, byte *data, int flags)
+{
+	char	bspname[64];
+
+	COM_FileBase(loadmodel->name, bspname, sizeof(bspname));
+
+	tx->gl_texturenum = GL_LoadTexture(va("%s:%s", bspname, tx2->name), tx2->width, tx2->height, data, flags, 1);
+	if (!ISTURBTEX(tx->name) && Img_HasFullbrights(data, tx2->width * tx2->height))
+		tx->fb_texturenum = GL_LoadTexture(va("%s:@fb_%s", bspname, tx2->name), tx2->width, tx2->height, data, flags | TEX_FULLBRIGHT, 1);
+}
+
+typedef struct
+{
+	texture_t	*tx, *tx2;
+	byte		*data;
+	int			flags;
+} textureretry_t;
+
+// an external texture failed to decode in the image batch
+static void Mod_RetryBrushModelTexture (void *data)
+{
+	textureretry_t	*retry = (textureretry_t *)data;
+
+	retry->tx->gl_texturenum = retry->tx->fb_texturenum = 0;
+	retry->tx->isLumaTexture = false;
+	if (!Mod_LoadBrushModelTexture(retry->tx, retry->flags))
+		Mod_LoadBrushModel8bitTexture (retry->tx, retry->tx2, retry->data, retry->flags);
+}
+
 /*
 =================
 Mod_LoadTextures
@@ -475,6 +704,8 @@ void Mod_LoadTextures (lump_t *l)
 	dmiptexlump_t *m;
 	byte		*data;
 	char		bspname[64];
+	qboolean	batch, loaded;
+	textureretry_t	*retries = NULL;
 
 	//johnfitz -- don't return early if no textures; still need to create dummy texture
 	if (!l->filelen)
@@ -497,6 +728,11 @@ void Mod_LoadTextures (lump_t *l)
 
 	texture_flag = TEX_MIPMAP;
 
+	// external textures are decoded on the task workers while the rest of
+	// the lump is processed
+	if ((batch = GL_BeginImageBatch ()))
+		retries = Q_calloc (max(nummiptex, 1), sizeof(*retries));
+
 	for (i = 0 ; i < nummiptex ; i++)
 	{
 		m->dataofs[i] = LittleLong (m->dataofs[i]);
@@ -576,12 +812,19 @@ void Mod_LoadTextures (lump_t *l)
 			tx2 = r_notexture_mip;
 		}
 
-		if (!Mod_LoadBrushModelTexture(tx, texture_flag))
+		if (batch)
 		{
-			tx->gl_texturenum = GL_LoadTexture(va("%s:%s", bspname, tx2->name), tx2->width, tx2->height, data, texture_flag, 1);
-			if (!ISTURBTEX(tx->name) && Img_HasFullbrights(data, tx2->width * tx2->height))
-				tx->fb_texturenum = GL_LoadTexture(va("%s:@fb_%s", bspname, tx2->name), tx2->width, tx2->height, data, texture_flag | TEX_FULLBRIGHT, 1);
+			retries[i].tx = tx;
+			retries[i].tx2 = tx2;
+			retries[i].data = data;
+			retries[i].flags = texture_flag;
+			GL_SetImageRetry (Mod_RetryBrushModelTexture, &retries[i]);
 		}
+		loaded = Mod_LoadBrushModelTexture (tx, texture_flag);
+		GL_SetImageRetry (NULL, NULL);
+
+		if (!loaded)
+			Mod_LoadBrushModel8bitTexture (tx, tx2, data, texture_flag);
 
 		if (ISTURBTEX(tx->name))
 		{
@@ -592,6 +835,12 @@ void Mod_LoadTextures (lump_t *l)
 		}
 	}
 
+	if (batch)
+	{
+		GL_EndImageBatch ();
+		free (retries);
+	}
+
 	//johnfitz -- last 2 slots in array should be filled with dummy textures
 	loadmodel->textures[loadmodel->numtextures-2] = r_notexture_mip; //for lightmapped surfs
 	loadmodel->textures[loadmodel->numtextures-1] = r_notexture_mip2; //for SURF_DRAWTILED surfs
@@ -1950,6 +2199,9 @@ void Mod_LoadBrushModel (model_t *mod, void *buffer)
 
 	loadmodel->type = mod_brush;
 
+	// a new map's leafs may land on the hunk addresses of the previous one
+	Mod_FlushPVSCache ();
+
 	header = (dheader_t *)buffer;
 
 	i = LittleLong (header->version);
@@ -2259,9 +2511,72 @@ void Mod_LoadAliasModelTexture (char *identifier, int flags, int *gl_texnum, int
 	}
 }
 
+static void Mod_LoadAliasModel8bitTexture (char *identifier, byte *data, int flags, int *gl_texnum, int *fb_texnum)
+{
+	*gl_texnum = GL_LoadTexture (identifier, pheader->skinwidth, pheader->skinheight, data, flags, 1);
+
+	if (Img_HasFullbrights(data, pheader->skinwidth * pheader->skinheight))
+		*fb_texnum = GL_LoadTexture (va("@fb_%s", identifier), pheader->skinwidth, pheader->skinheight, data, flags | TEX_FULLBRIGHT, 1);
+}
+
+typedef struct skinretry_s
+{
+	int			skin, gl_texnum;	// the skin frames holding gl_texnum get the new textures
+	char		identifier[64];
+	byte		*data;
+	int			flags;
+	struct skinretry_s *next;
+} skinretry_t;
+
+// an external skin failed to decode in the image batch
+static void Mod_RetryAliasModelTexture (void *data)
+{
+	int			i, gl_texnum, fb_texnum;
+	qboolean	luma;
+	skinretry_t	*retry = (skinretry_t *)data;
+
+	gl_texnum = fb_texnum = 0;
+	Mod_LoadAliasModelTexture (retry->identifier, retry->flags, &gl_texnum, &fb_texnum);
+	luma = !!fb_texnum;
+	if (!gl_texnum)
+		Mod_LoadAliasModel8bitTexture (retry->identifier, retry->data, retry->flags, &gl_texnum, &fb_texnum);
+
+	for (i = 0 ; i < 4 ; i++)
+	{
+		if (pheader->gl_texturenum[retry->skin][i] != retry->gl_texnum)
+			continue;
+		pheader->gl_texturenum[retry->skin][i] = gl_texnum;
+		pheader->fb_texturenum[retry->skin][i] = fb_texnum;
+		pheader->islumaskin[retry->skin][i] = luma;
+	}
+}
+
+static skinretry_t *Mod_AddSkinRetry (skinretry_t **retries, int skin, char *identifier, byte *data, int flags)
+{
+	skinretry_t	*retry;
+
+	retry = Q_malloc (sizeof(*retry));
+	retry->skin = skin;
+	retry->gl_texnum = 0;
+	Q_strncpyz (retry->identifier, identifier, sizeof(retry->identifier));
+	retry->data = data;
+	retry->flags = flags;
+	retry->next = *retries;
+	*retries = retry;
+
+	GL_SetImageRetry (Mod_RetryAliasModelTexture, retry);
+
+	return retry;
+}
+
 int	player_32bit_skins[14] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
 qboolean player_32bit_skins_loaded = false;
 
+static void Mod_RetryPlayerSkins (void *data)
+{
+	player_32bit_skins_loaded = false;
+}
+
 /*
 ===============
 Mod_LoadAllSkins
@@ -2272,6 +2587,8 @@ void *Mod_LoadAllSkins (int numskins, daliasskintype_t *pskintype)
 	int			i, j, k, size, groupskins, gl_texnum, fb_texnum, texture_flag;
 	char		basename[64], identifier[64];
 	byte		*skin, *texels;
+	qboolean	batch;
+	skinretry_t	*retries = NULL, *retry = NULL;
 	daliasskingroup_t *pinskingroup;
 	daliasskininterval_t *pinskinintervals;
 
@@ -2288,6 +2605,8 @@ void *Mod_LoadAllSkins (int numskins, daliasskintype_t *pskintype)
 	if (loadmodel->flags & MF_HOLEY)
 		texture_flag |= TEX_ALPHA;
 
+	batch = GL_BeginImageBatch ();
+
 	for (i = 0 ; i < numskins ; i++)
 	{
 		if (pskintype->type == ALIAS_SKIN_SINGLE)
@@ -2309,7 +2628,9 @@ void *Mod_LoadAllSkins (int numskins, daliasskintype_t *pskintype)
 
 					for (c = 0; c < 14; c++)
 					{
+						GL_SetImageRetry (Mod_RetryPlayerSkins, NULL);
 						Mod_LoadAliasModelTexture (va("player_skin_%i", c), texture_flag, &player_32bit_skins[c], &fb_texnum);
+						GL_SetImageRetry (NULL, NULL);
 						if (!player_32bit_skins[c])
 						{
 							failed = true;
@@ -2324,18 +2645,18 @@ void *Mod_LoadAllSkins (int numskins, daliasskintype_t *pskintype)
 			Q_snprintfz (identifier, sizeof(identifier), "%s_%i", basename, i);
 
 			gl_texnum = fb_texnum = 0;
+			if (batch)
+				retry = Mod_AddSkinRetry (&retries, i, identifier, (byte *)(pskintype + 1), texture_flag);
 			Mod_LoadAliasModelTexture (identifier, texture_flag, &gl_texnum, &fb_texnum);
+			GL_SetImageRetry (NULL, NULL);
+			if (retry)
+				retry->gl_texnum = gl_texnum;
 			if (fb_texnum)
 				pheader->islumaskin[i][0] = pheader->islumaskin[i][1] =
 				pheader->islumaskin[i][2] = pheader->islumaskin[i][3] = true;
 
 			if (!gl_texnum)
-			{
-				gl_texnum = GL_LoadTexture (identifier, pheader->skinwidth, pheader->skinheight, (byte *)(pskintype + 1), texture_flag, 1);
-
-				if (Img_HasFullbrights((byte *)(pskintype + 1),	pheader->skinwidth * pheader->skinheight))
-					fb_texnum = GL_LoadTexture (va("@fb_%s", identifier), pheader->skinwidth, pheader->skinheight, (byte *)(pskintype + 1), texture_flag | TEX_FULLBRIGHT, 1);
-			}
+				Mod_LoadAliasModel8bitTexture (identifier, (byte *)(pskintype + 1), texture_flag, &gl_texnum, &fb_texnum);
 
 			pheader->gl_texturenum[i][0] = pheader->gl_texturenum[i][1] =
 			pheader->gl_texturenum[i][2] = pheader->gl_texturenum[i][3] = gl_texnum;
@@ -2366,17 +2687,17 @@ void *Mod_LoadAllSkins (int numskins, daliasskintype_t *pskintype)
 				Q_snprintfz (identifier, sizeof(identifier), "%s_%i_%i", basename, i, j);
 
 				gl_texnum = fb_texnum = 0;
+				if (batch)
+					retry = Mod_AddSkinRetry (&retries, i, identifier, (byte *)pskintype, texture_flag);
 				Mod_LoadAliasModelTexture (identifier, texture_flag, &gl_texnum, &fb_texnum);
+				GL_SetImageRetry (NULL, NULL);
+				if (retry)
+					retry->gl_texnum = gl_texnum;
 				if (fb_texnum)
 					pheader->islumaskin[i][j&3] = true;
 
 				if (!gl_texnum)
-				{
-					gl_texnum = GL_LoadTexture (identifier, pheader->skinwidth, pheader->skinheight, (byte *)pskintype, texture_flag, 1);
-
-					if (Img_HasFullbrights((byte *)pskintype, pheader->skinwidth * pheader->skinheight))
-						fb_texnum = GL_LoadTexture (va("@fb_%s", identifier), pheader->skinwidth, pheader->skinheight, (byte *)pskintype, texture_flag | TEX_FULLBRIGHT, 1);
-				}
+					Mod_LoadAliasModel8bitTexture (identifier, (byte *)pskintype, texture_flag, &gl_texnum, &fb_texnum);
 
 				pheader->gl_texturenum[i][j&3] = gl_texnum;
 				pheader->fb_texturenum[i][j&3] = fb_texnum;
@@ -2389,6 +2710,17 @@ void *Mod_LoadAllSkins (int numskins, daliasskintype_t *pskintype)
 		}
 	}
 
+	if (batch)
+	{
+		GL_EndImageBatch ();
+		while (retries)
+		{
+			retry = retries->next;
+			free (retries);
+			retries = retry;
+		}
+	}
+
 	return (void *)pskintype;
 }
 
@@ -3236,6 +3568,8 @@ void Mod_LoadQ3Model (model_t *mod, void *buffer)
 		surf = (md3surface_t *)((byte *)surf + surf->ofsend);
 	}
 
+	GLMesh_LoadQ3VertexBuffer (mod, header);
+
 	for (i = 0 ; i < numskinsfound ; i++)
 		free (skinsfound[i]);
 	free (skinsfound);
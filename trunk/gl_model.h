@@ -464,6 +464,14 @@ typedef struct
 	unsigned short oldnormal;	// needed for normal lighting
 } md3vert_mem_t;
 
+// vertex layout of the MD3 VBOs, see GLMesh_LoadQ3VertexBuffer
+typedef struct
+{
+	float		xyz[3];
+	signed char	normal[4];
+	byte		anorm[4];	// anorm_pitch, anorm_yaw for vertex lighting
+} md3vbovert_t;
+
 #define	MD3_XYZ_SCALE	(1.0 / 64)
 
 #define	MAXMD3FRAMES	1024
@@ -313,6 +313,61 @@ LIGHT SAMPLING
 mplane_t	*lightplane;
 vec3_t		lightspot, lightcolor;
 
+static msurface_t	*lightsurf;		// surface sampled by the last RecursiveLightPoint
+static int			lightds, lightdt;
+
+static int	lightcache_generation = 1;
+
+/*
+=============
+R_AddLightSample
+
+Adds the interpolated, lightstyle scaled lightmap value at ds/dt (relative
+to the texturemins) of the surface to color
+=============
+*/
+static void R_AddLightSample (vec3_t color, msurface_t *surf, int ds, int dt)
+{
+	// enhanced to interpolate lighting
+	byte	*lightmap;
+	int		maps, line3, dsfrac = ds & 15, dtfrac = dt & 15, r00 = 0, g00 = 0, b00 = 0, r01 = 0, g01 = 0, b01 = 0, r10 = 0, g10 = 0, b10 = 0, r11 = 0, g11 = 0, b11 = 0;
+	float	scale;
+
+	line3 = ((surf->extents[0] >> 4) + 1) * 3;
+	lightmap = surf->samples + ((dt >> 4) * ((surf->extents[0] >> 4) + 1) + (ds >> 4)) * 3;	// LordHavoc: *3 for color
+
+	for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ; maps++)
+	{
+		scale = (float)d_lightstylevalue[surf->styles[maps]] * 1.0 / 256.0;
+		r00 += (float)lightmap[0] * scale;
+		g00 += (float)lightmap[1] * scale;
+		b00 += (float)lightmap[2] * scale;
+
+		r01 += (float)lightmap[3] * scale;
+		g01 += (float)lightmap[4] * scale;
+		b01 += (float)lightmap[5] * scale;
+
+		r10 += (float)lightmap[line3+0] * scale;
+		g10 += (float)lightmap[line3+1] * scale;
+		b10 += (float)lightmap[line3+2] * scale;
+
+		r11 += (float)lightmap[line3+3] * scale;
+		g11 += (float)lightmap[line3+4] * scale;
+		b11 += (float)lightmap[line3+5] * scale;
+
+		lightmap += ((surf->extents[0] >> 4) + 1) * ((surf->extents[1] >> 4) + 1) * 3;	// LordHavoc: *3 for colored lighting
+	}
+	color[0] += (float)((int)((((((((r11 - r10) * dsfrac) >> 4) + r10) 
+		- ((((r01 - r00) * dsfrac) >> 4) + r00)) * dtfrac) >> 4) 
+		+ ((((r01 - r00) * dsfrac) >> 4) + r00)));
+	color[1] += (float)((int)((((((((g11 - g10) * dsfrac) >> 4) + g10) 
+		- ((((g01 - g00) * dsfrac) >> 4) + g00)) * dtfrac) >> 4) 
+		+ ((((g01 - g00) * dsfrac) >> 4) + g00)));
+	color[2] += (float)((int)((((((((b11 - b10) * dsfrac) >> 4) + b10) 
+		- ((((b01 - b00) * dsfrac) >> 4) + b00)) * dtfrac) >> 4) 
+		+ ((((b01 - b00) * dsfrac) >> 4) + b00)));
+}
+
 int RecursiveLightPoint(vec3_t color, mnode_t *node, vec3_t rayorg, vec3_t start, vec3_t end, float *maxdist)
 {
 	float	front, back, frac;
@@ -407,45 +462,12 @@ loc0:
 				continue;
 			}
 
-			if (dist < *maxdist) {
-				// enhanced to interpolate lighting
-				byte	*lightmap;
-				int		maps, line3, dsfrac = ds & 15, dtfrac = dt & 15, r00 = 0, g00 = 0, b00 = 0, r01 = 0, g01 = 0, b01 = 0, r10 = 0, g10 = 0, b10 = 0, r11 = 0, g11 = 0, b11 = 0;
-				float	scale;
-
-				line3 = ((surf->extents[0] >> 4) + 1) * 3;
-				lightmap = surf->samples + ((dt >> 4) * ((surf->extents[0] >> 4) + 1) + (ds >> 4)) * 3;	// LordHavoc: *3 for color
-
-				for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ; maps++)
-				{
-					scale = (float)d_lightstylevalue[surf->styles[maps]] * 1.0 / 256.0;
-					r00 += (float)lightmap[0] * scale;
-					g00 += (float)lightmap[1] * scale;
-					b00 += (float)lightmap[2] * scale;
-
-					r01 += (float)lightmap[3] * scale;
-					g01 += (float)lightmap[4] * scale;
-					b01 += (float)lightmap[5] * scale;
-
-					r10 += (float)lightmap[line3+0] * scale;
-					g10 += (float)lightmap[line3+1] * scale;
-					b10 += (float)lightmap[line3+2] * scale;
-
-					r11 += (float)lightmap[line3+3] * scale;
-					g11 += (float)lightmap[line3+4] * scale;
-					b11 += (float)lightmap[line3+5] * scale;
-
-					lightmap += ((surf->extents[0] >> 4) + 1) * ((surf->extents[1] >> 4) + 1) * 3;	// LordHavoc: *3 for colored lighting
-				}
-				color[0] += (float)((int)((((((((r11 - r10) * dsfrac) >> 4) + r10) 
-					- ((((r01 - r00) * dsfrac) >> 4) + r00)) * dtfrac) >> 4) 
-					+ ((((r01 - r00) * dsfrac) >> 4) + r00)));
-				color[1] += (float)((int)((((((((g11 - g10) * dsfrac) >> 4) + g10) 
-					- ((((g01 - g00) * dsfrac) >> 4) + g00)) * dtfrac) >> 4) 
-					+ ((((g01 - g00) * dsfrac) >> 4) + g00)));
-				color[2] += (float)((int)((((((((b11 - b10) * dsfrac) >> 4) + b10) 
-					- ((((b01 - b00) * dsfrac) >> 4) + b00)) * dtfrac) >> 4) 
-					+ ((((b01 - b00) * dsfrac) >> 4) + b00)));
+			if (dist < *maxdist)
+			{
+				R_AddLightSample (color, surf, ds, dt);
+				lightsurf = surf;
+				lightds = ds;
+				lightdt = dt;
 			}
 
 			return true;	// success
@@ -456,7 +478,27 @@ loc0:
 	}
 }
 
-int R_LightPoint (vec3_t p)
+/*
+=============
+R_ClearLightCache
+
+Invalidates every lightcache_t, as their surfaces belong to the old map
+=============
+*/
+void R_ClearLightCache (void)
+{
+	lightcache_generation++;
+}
+
+/*
+=============
+R_LightPointCached
+
+Same as R_LightPoint, but if cache holds a trace from the same point only the
+lightmap sample is redone, so lightstyle changes still come through
+=============
+*/
+int R_LightPointCached (vec3_t p, lightcache_t *cache)
 {
 	vec3_t	end;
 	float maxdist = 8192.f; //johnfitz -- was 2048
@@ -467,16 +509,44 @@ int R_LightPoint (vec3_t p)
 		return 255;
 	}
 
-	end[0] = p[0];
-	end[1] = p[1];
-	end[2] = p[2] - maxdist;
-
 	lightcolor[0] = lightcolor[1] = lightcolor[2] = max(0, r_ambient.value);
-	RecursiveLightPoint(lightcolor, cl.worldmodel->nodes, p, p, end, &maxdist);
+
+	if (cache && cache->generation == lightcache_generation && VectorCompare(p, cache->origin))
+	{
+		VectorCopy (cache->spot, lightspot);
+		lightplane = cache->plane;
+		if (cache->surf)
+			R_AddLightSample (lightcolor, cache->surf, cache->ds, cache->dt);
+	}
+	else
+	{
+		end[0] = p[0];
+		end[1] = p[1];
+		end[2] = p[2] - maxdist;
+
+		lightsurf = NULL;
+		RecursiveLightPoint(lightcolor, cl.worldmodel->nodes, p, p, end, &maxdist);
+
+		if (cache)
+		{
+			cache->generation = lightcache_generation;
+			VectorCopy (p, cache->origin);
+			cache->surf = lightsurf;
+			cache->ds = lightds;
+			cache->dt = lightdt;
+			VectorCopy (lightspot, cache->spot);
+			cache->plane = lightplane;
+		}
+	}
 
 	return ((lightcolor[0] + lightcolor[1] + lightcolor[2]) * (1.0f / 3.0f));
 }
 
+int R_LightPoint (vec3_t p)
+{
+	return R_LightPointCached (p, NULL);
+}
+
 /*
 =============================================================================
 
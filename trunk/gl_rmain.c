@@ -97,7 +97,10 @@ qboolean OnChange_r_wateralpha(cvar_t *var, char *string);
 cvar_t	r_wateralpha = {"r_wateralpha", "1", 0, OnChange_r_wateralpha };
 cvar_t	r_litwater = { "r_litwater", "1" };
 cvar_t	r_dynamic = {"r_dynamic", "1"};
+cvar_t	r_dynamic_glsl = {"r_dynamic_glsl", "0"};
 cvar_t	r_novis = {"r_novis", "0" };
+cvar_t	r_markcache = {"r_markcache", "1"};
+cvar_t	r_occlusion = {"r_occlusion", "0"};
 cvar_t	r_outline = { "r_outline", "0" };
 cvar_t	r_outline_surf = { "r_outline_surf", "0" };
 cvar_t	r_outline_players = { "r_outline_players", "0" };
@@ -417,12 +420,12 @@ void GLSLGamma_GammaCorrect(void)
 
 /*
 =================
-R_CullBox
+R_CullBoxPlanes
 
-Returns true if the box is completely outside the frustum
+Returns true if the box is completely outside the given frustum planes
 =================
 */
-qboolean R_CullBox (vec3_t emins, vec3_t emaxs)
+qboolean R_CullBoxPlanes (mplane_t *planes, vec3_t emins, vec3_t emaxs)
 {
 	int		i;
 	mplane_t *p;
@@ -431,7 +434,7 @@ qboolean R_CullBox (vec3_t emins, vec3_t emaxs)
 
 	for (i = 0; i < 4; i++)
 	{
-		p = frustum + i;
+		p = planes + i;
 		signbits = p->signbits;
 		vec[0] = ((signbits % 2)<1) ? emaxs[0] : emins[0];
 		vec[1] = ((signbits % 4)<2) ? emaxs[1] : emins[1];
@@ -442,6 +445,18 @@ qboolean R_CullBox (vec3_t emins, vec3_t emaxs)
 	return false;
 }
 
+/*
+=================
+R_CullBox
+
+Returns true if the box is completely outside the frustum
+=================
+*/
+qboolean R_CullBox (vec3_t emins, vec3_t emaxs)
+{
+	return R_CullBoxPlanes(frustum, emins, emaxs);
+}
+
 /*
 =================
 R_CullSphere
@@ -463,12 +478,11 @@ qboolean R_CullSphere (vec3_t centre, float radius)
 
 /*
 ===============
-R_CullModelForEntity -- johnfitz -- uses correct bounds based on rotation
+R_BoundsForEntity -- johnfitz -- uses correct bounds based on rotation
 ===============
 */
-qboolean R_CullModelForEntity(entity_t *e)
+static void R_BoundsForEntity(entity_t *e, vec3_t mins, vec3_t maxs)
 {
-	vec3_t	mins, maxs;
 	vec_t	scalefactor, *minbounds, *maxbounds;
 
 	if (e->angles[0] || e->angles[2]) //pitch or roll
@@ -498,6 +512,79 @@ qboolean R_CullModelForEntity(entity_t *e)
 		VectorAdd(e->origin, minbounds, mins);
 		VectorAdd(e->origin, maxbounds, maxs);
 	}
+}
+
+static task_t	*r_cullentities_task;
+static mplane_t	r_cullentities_frustum[4];
+static int		r_cullentities_num, r_cullentities_frame;
+
+static void R_CullEntitiesTask (void *data)
+{
+	int			i;
+	entity_t	*e;
+	vec3_t		mins, maxs;
+
+	for (i = 0 ; i < r_cullentities_num ; i++)
+	{
+		e = cl_visedicts[i];
+		if (!e->model)
+			continue;
+
+		R_BoundsForEntity(e, mins, maxs);
+		e->culled = R_CullBoxPlanes(r_cullentities_frustum, mins, maxs);
+		e->cullframe = r_cullentities_frame;
+	}
+}
+
+/*
+===============
+R_CullEntities
+
+Has a worker cull everything in cl_visedicts against the frustum while the
+main thread carries on with the world. R_CullModelForEntity picks up the
+results. Must be called after R_MarkSurfaces has added the static entities.
+===============
+*/
+void R_CullEntities (void)
+{
+	if (Tasks_NumWorkers() <= 0 || !cl_numvisedicts)
+		return;
+
+	memcpy (r_cullentities_frustum, frustum, sizeof(r_cullentities_frustum));
+	r_cullentities_num = cl_numvisedicts;
+	r_cullentities_frame = r_framecount;
+	r_cullentities_task = Task_Submit (R_CullEntitiesTask, NULL);
+}
+
+/*
+===============
+R_FinishCullEntities
+===============
+*/
+void R_FinishCullEntities (void)
+{
+	if (r_cullentities_task)
+	{
+		Task_Wait (r_cullentities_task);
+		r_cullentities_task = NULL;
+	}
+}
+
+/*
+===============
+R_CullModelForEntity
+===============
+*/
+qboolean R_CullModelForEntity(entity_t *e)
+{
+	vec3_t	mins, maxs;
+
+	R_FinishCullEntities ();
+
+	if (e->cullframe == r_framecount)
+		return e->culled;
+
+	R_BoundsForEntity(e, mins, maxs);
 
 	return R_CullBox(mins, maxs);
 }
@@ -801,6 +888,7 @@ static GLuint lightColorLoc;
 static GLuint useVertexLightingLoc;
 static GLuint aPitchLoc;
 static GLuint aYawLoc;
+static GLuint useAnormAttribsLoc;
 
 // uniforms used in frag shader
 static GLuint texLoc;
@@ -818,6 +906,8 @@ fog_data_t fog_data;
 #define pose2VertexAttrIndex 2
 #define pose2NormalAttrIndex 3
 #define texCoordsAttrIndex 4
+#define pose1AnormAttrIndex 5
+#define pose2AnormAttrIndex 6
 
 /*
 =============
@@ -859,7 +949,9 @@ void GLAlias_CreateShaders(void)
 		{ "Pose1Vert", pose1VertexAttrIndex },
 		{ "Pose1Normal", pose1NormalAttrIndex },
 		{ "Pose2Vert", pose2VertexAttrIndex },
-		{ "Pose2Normal", pose2NormalAttrIndex }
+		{ "Pose2Normal", pose2NormalAttrIndex },
+		{ "Pose1Anorm", pose1AnormAttrIndex },
+		{ "Pose2Anorm", pose2AnormAttrIndex }
 	};
 
 	const GLchar *vertSource = \
@@ -874,6 +966,7 @@ void GLAlias_CreateShaders(void)
 		"uniform bool UseVertexLighting;\n"
 		"uniform float APitch;\n"
 		"uniform float AYaw;\n"
+		"uniform bool UseAnormAttribs;\n"
 		"uniform VlightData\n"
 		"{\n"
 		"	int AnormPitch[NUMVERTEXNORMALS];\n"
@@ -885,6 +978,8 @@ void GLAlias_CreateShaders(void)
 		"attribute vec3 Pose1Normal;\n"
 		"attribute vec4 Pose2Vert;\n"
 		"attribute vec3 Pose2Normal;\n"
+		"attribute vec2 Pose1Anorm; // md3 only \n"
+		"attribute vec2 Pose2Anorm;\n"
 		"\n"
 		"varying float FogFragCoord;\n"
 		"\n"
@@ -941,9 +1036,17 @@ void GLAlias_CreateShaders(void)
 		"	FogFragCoord = gl_Position.w;\n"
 		"	if (UseVertexLighting)\n"
 		"	{\n"
-		"		int pose1_lni = int(Pose1Vert.w);\n"
-		"		int pose2_lni = int(Pose2Vert.w);\n"
-		"		float l = R_LerpVertexLight(AnormPitch[pose1_lni], AnormYaw[pose1_lni], AnormPitch[pose2_lni], AnormYaw[pose2_lni], Blend, APitch, AYaw);\n"
+		"		float l;\n"
+		"		if (UseAnormAttribs)\n"
+		"		{\n"
+		"			l = R_LerpVertexLight(int(Pose1Anorm.x), int(Pose1Anorm.y), int(Pose2Anorm.x), int(Pose2Anorm.y), Blend, APitch, AYaw);\n"
+		"		}\n"
+		"		else\n"
+		"		{\n"
+		"			int pose1_lni = int(Pose1Vert.w);\n"
+		"			int pose2_lni = int(Pose2Vert.w);\n"
+		"			l = R_LerpVertexLight(AnormPitch[pose1_lni], AnormYaw[pose1_lni], AnormPitch[pose2_lni], AnormYaw[pose2_lni], Blend, APitch, AYaw);\n"
+		"		}\n"
 		"		l = min(l, 1.0);\n"
 		"		gl_FrontColor = vec4(vec3(LightColor.xyz * (200.0 / 256.0) + l), LightColor.w);\n"
 		"	}\n"
@@ -1009,6 +1112,7 @@ void GLAlias_CreateShaders(void)
 		useVertexLightingLoc = GL_GetUniformLocation(&r_alias_program, "UseVertexLighting");
 		aPitchLoc = GL_GetUniformLocation(&r_alias_program, "APitch");
 		aYawLoc = GL_GetUniformLocation(&r_alias_program, "AYaw");
+		useAnormAttribsLoc = GL_GetUniformLocation(&r_alias_program, "UseAnormAttribs");
 		texLoc = GL_GetUniformLocation(&r_alias_program, "Tex");
 		fullbrightTexLoc = GL_GetUniformLocation(&r_alias_program, "FullbrightTex");
 		useFullbrightTexLoc = GL_GetUniformLocation(&r_alias_program, "UseFullbrightTex");
@@ -1080,6 +1184,7 @@ void R_DrawAliasFrame_GLSL(aliashdr_t *paliashdr, lerpdata_t lerpdata, entity_t
 	qglUniform1i(useVertexLightingLoc, (gl_vertexlights.value && !full_light) ? 1 : 0);
 	qglUniform1f(aPitchLoc, apitch);
 	qglUniform1f(aYawLoc, ayaw);
+	qglUniform1i(useAnormAttribsLoc, 0);
 	qglUniform1i(texLoc, 0);
 	qglUniform1i(fullbrightTexLoc, 1);
 	qglUniform1i(useFullbrightTexLoc, (fb_texture != 0) ? (islumaskin ? 2 : 1) : 0);
@@ -1611,7 +1716,7 @@ void R_SetupLighting (entity_t *ent)
 	// if the initial trace is completely black, try again from above
 	// this helps with models whose origin is slightly below ground level
 	// (e.g. some of the candles in the DOTM start map)
-	if (!R_LightPoint(ent->origin))
+	if (!R_LightPointCached(ent->origin, &ent->lightcache))
 	{
 		vec3_t lpos;
 		VectorCopy(ent->origin, lpos);
@@ -2684,17 +2789,14 @@ qboolean	surface_transparent;
 
 /*
 =================
-R_DrawQ3Frame
+R_LerpQ3Frame
+
+Advances the entity's pose lerp towards the given MD3 frame
 =================
 */
-void R_DrawQ3Frame (int frame, md3header_t *pmd3hdr, md3surface_t *pmd3surf, entity_t *ent, int distance)
+static void R_LerpQ3Frame (int frame, md3header_t *pmd3hdr, entity_t *ent)
 {
-	int			i, j, numtris, posenum, numposes, pose1, pose2;
-	float		l, lerpfrac;
-	vec3_t		lightvec, interpolated_verts;
-	unsigned int *tris;
-	md3tc_t		*tc;
-	md3vert_mem_t *verts, *v1, *v2;
+	int			posenum, numposes;
 	model_t		*clmodel = ent->model;
 
 	if ((frame >= pmd3hdr->numframes) || (frame < 0))
@@ -2754,13 +2856,16 @@ void R_DrawQ3Frame (int frame, md3header_t *pmd3hdr, md3surface_t *pmd3surf, ent
 		ent->previouspose = posenum;
 		ent->currentpose = posenum;
 	}
+}
 
-	verts = (md3vert_mem_t *)((byte *)pmd3hdr + pmd3surf->ofsverts);
-	tc = (md3tc_t *)((byte *)pmd3surf + pmd3surf->ofstc);
-	tris = (unsigned int *)((byte *)pmd3surf + pmd3surf->ofstris);
-	numtris = pmd3surf->numtris * 3;
-	pose1 = ent->previouspose * pmd3surf->numverts;
-	pose2 = ent->currentpose * pmd3surf->numverts;
+/*
+=================
+R_BeginQ3SurfaceBlend
+=================
+*/
+static void R_BeginQ3SurfaceBlend (entity_t *ent)
+{
+	model_t		*clmodel = ent->model;
 
 	if (surface_transparent)
 	{
@@ -2776,6 +2881,53 @@ void R_DrawQ3Frame (int frame, md3header_t *pmd3hdr, md3surface_t *pmd3surf, ent
 	{
 		glEnable (GL_BLEND);
 	}
+}
+
+/*
+=================
+R_EndQ3SurfaceBlend
+=================
+*/
+static void R_EndQ3SurfaceBlend (entity_t *ent)
+{
+	if (surface_transparent)
+	{
+		glDisable (GL_BLEND);
+		glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glDepthMask(GL_TRUE);
+		glEnable (GL_CULL_FACE);
+	}
+	else if (ISTRANSPARENT(ent))
+	{
+		glDisable (GL_BLEND);
+	}
+}
+
+/*
+=================
+R_DrawQ3Frame
+=================
+*/
+void R_DrawQ3Frame (int frame, md3header_t *pmd3hdr, md3surface_t *pmd3surf, entity_t *ent, int distance)
+{
+	int			i, j, numtris, pose1, pose2;
+	float		l, lerpfrac;
+	vec3_t		lightvec, interpolated_verts;
+	unsigned int *tris;
+	md3tc_t		*tc;
+	md3vert_mem_t *verts, *v1, *v2;
+	model_t		*clmodel = ent->model;
+
+	R_LerpQ3Frame (frame, pmd3hdr, ent);
+
+	verts = (md3vert_mem_t *)((byte *)pmd3hdr + pmd3surf->ofsverts);
+	tc = (md3tc_t *)((byte *)pmd3surf + pmd3surf->ofstc);
+	tris = (unsigned int *)((byte *)pmd3surf + pmd3surf->ofstris);
+	numtris = pmd3surf->numtris * 3;
+	pose1 = ent->previouspose * pmd3surf->numverts;
+	pose2 = ent->currentpose * pmd3surf->numverts;
+
+	R_BeginQ3SurfaceBlend (ent);
 
 	glBegin (GL_TRIANGLES);
 	for (i = 0 ; i < numtris ; i++)
@@ -2850,17 +3002,143 @@ void R_DrawQ3Frame (int frame, md3header_t *pmd3hdr, md3surface_t *pmd3surf, ent
 		glEnable (GL_TEXTURE_2D);
 	}
 
-	if (surface_transparent)
+	R_EndQ3SurfaceBlend (ent);
+}
+
+/*
+=============
+GLMD3_GetSurfaceOffsets
+
+Returns the offsets of the surface's vertexes, texture coords and indexes in
+the model's VBOs, following the layout of GLMesh_LoadQ3VertexBuffer.
+=============
+*/
+static void GLMD3_GetSurfaceOffsets (md3header_t *pmd3hdr, md3surface_t *pmd3surf, int *xyzofs, int *stofs, int *indexofs)
+{
+	int			i;
+	md3surface_t *surf;
+
+	*xyzofs = *indexofs = 0;
+	surf = (md3surface_t *)((byte *)pmd3hdr + pmd3hdr->ofssurfs);
+	for (i = 0 ; i < pmd3hdr->numsurfs && surf != pmd3surf ; i++)
 	{
-		glDisable (GL_BLEND);
-		glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glDepthMask(GL_TRUE);
-		glEnable (GL_CULL_FACE);
+		*xyzofs += surf->numframes * surf->numverts * sizeof(md3vbovert_t) + surf->numverts * sizeof(meshst_t);
+		*indexofs += surf->numtris * 3 * sizeof(unsigned short);
+		surf = (md3surface_t *)((byte *)surf + surf->ofsend);
 	}
-	else if (ISTRANSPARENT(ent))
+	*stofs = *xyzofs + pmd3surf->numframes * pmd3surf->numverts * sizeof(md3vbovert_t);
+}
+
+/*
+=============
+R_DrawQ3Frame_GLSL
+
+MD3 counterpart of R_DrawAliasFrame_GLSL. The surface is drawn from the
+model's static VBOs with one draw call, and lerping and lighting is done in
+the alias vertex shader. Tags are still resolved by the caller.
+=============
+*/
+void R_DrawQ3Frame_GLSL (int frame, md3header_t *pmd3hdr, md3surface_t *pmd3surf, entity_t *ent, int distance, int gl_texture, int fb_texture)
+{
+	extern GLuint	tbo_tex;
+	int				xyzofs, stofs, indexofs, pose1, pose2;
+	float			blend;
+	qboolean		vertexlights;
+	model_t			*clmodel = ent->model;
+
+	R_LerpQ3Frame (frame, pmd3hdr, ent);
+
+	GLMD3_GetSurfaceOffsets (pmd3hdr, pmd3surf, &xyzofs, &stofs, &indexofs);
+	pose1 = xyzofs + ent->previouspose * pmd3surf->numverts * sizeof(md3vbovert_t);
+	pose2 = xyzofs + ent->currentpose * pmd3surf->numverts * sizeof(md3vbovert_t);
+
+	blend = (ent->previouspose != ent->currentpose) ? ent->framelerp : 0;
+
+	// the rocket has a fixed color, so it takes neither shading nor vertex lights
+	vertexlights = gl_vertexlights.value && !full_light && clmodel->modhint != MOD_Q3ROCKET;
+
+	R_BeginQ3SurfaceBlend (ent);
+
+	qglUseProgram(r_alias_program);
+
+	GL_BindBuffer(GL_ARRAY_BUFFER, clmodel->meshvbo);
+	GL_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, clmodel->meshindexesvbo);
+
+	qglEnableVertexAttribArray(texCoordsAttrIndex);
+	qglEnableVertexAttribArray(pose1VertexAttrIndex);
+	qglEnableVertexAttribArray(pose2VertexAttrIndex);
+	qglEnableVertexAttribArray(pose1NormalAttrIndex);
+	qglEnableVertexAttribArray(pose2NormalAttrIndex);
+	qglEnableVertexAttribArray(pose1AnormAttrIndex);
+	qglEnableVertexAttribArray(pose2AnormAttrIndex);
+
+	qglVertexAttribPointer(texCoordsAttrIndex, 2, GL_FLOAT, GL_FALSE, 0, (void *)(intptr_t)stofs);
+	qglVertexAttribPointer(pose1VertexAttrIndex, 3, GL_FLOAT, GL_FALSE, sizeof(md3vbovert_t), (void *)(intptr_t)(pose1 + offsetof(md3vbovert_t, xyz)));
+	qglVertexAttribPointer(pose2VertexAttrIndex, 3, GL_FLOAT, GL_FALSE, sizeof(md3vbovert_t), (void *)(intptr_t)(pose2 + offsetof(md3vbovert_t, xyz)));
+	qglVertexAttribPointer(pose1NormalAttrIndex, 4, GL_BYTE, GL_TRUE, sizeof(md3vbovert_t), (void *)(intptr_t)(pose1 + offsetof(md3vbovert_t, normal)));
+	qglVertexAttribPointer(pose2NormalAttrIndex, 4, GL_BYTE, GL_TRUE, sizeof(md3vbovert_t), (void *)(intptr_t)(pose2 + offsetof(md3vbovert_t, normal)));
+	// pitch and yaw are table indexes, so they are not normalized
+	qglVertexAttribPointer(pose1AnormAttrIndex, 2, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(md3vbovert_t), (void *)(intptr_t)(pose1 + offsetof(md3vbovert_t, anorm)));
+	qglVertexAttribPointer(pose2AnormAttrIndex, 2, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(md3vbovert_t), (void *)(intptr_t)(pose2 + offsetof(md3vbovert_t, anorm)));
+
+	// set uniforms
+	qglUniform1f(blendLoc, blend);
+	qglUniform1f(lerpDistLoc, distance);
+	if (clmodel->modhint == MOD_Q3ROCKET)
 	{
-		glDisable (GL_BLEND);
+		qglUniform3f(shadevectorLoc, 0, 0, 0);
+		qglUniform4f(lightColorLoc, 0.75, 0.75, 0.75, ent->transparency);
+	}
+	else
+	{
+		qglUniform3f(shadevectorLoc, shadevector[0], shadevector[1], shadevector[2]);
+		qglUniform4f(lightColorLoc, lightcolor[0], lightcolor[1], lightcolor[2], ent->transparency);
 	}
+	qglUniform1i(useVertexLightingLoc, vertexlights ? 1 : 0);
+	qglUniform1f(aPitchLoc, apitch);
+	qglUniform1f(aYawLoc, ayaw);
+	qglUniform1i(useAnormAttribsLoc, 1);
+	qglUniform1i(texLoc, 0);
+	qglUniform1i(fullbrightTexLoc, 1);
+	qglUniform1i(useFullbrightTexLoc, fb_texture ? 2 : 0);	// md3 fullbrights are added like lumas
+	qglUniform1i(useOverbrightLoc, 0);
+	qglUniform1i(useAlphaTestLoc, 0);
+	qglUniform1i(useWaterFogLoc, fog_data.useWaterFog);
+
+	qglUniform1i(vlightTableLoc, 2);
+
+	// set textures
+	GL_SelectTexture(GL_TEXTURE0);
+	GL_Bind(gl_texture);
+
+	if (fb_texture)
+	{
+		GL_SelectTexture(GL_TEXTURE1);
+		GL_Bind(fb_texture);
+	}
+
+	if (vertexlights)
+	{
+		GL_SelectTexture(GL_TEXTURE2);
+		GL_BindTBO(tbo_tex);
+	}
+
+	// draw
+	glDrawElements(GL_TRIANGLES, pmd3surf->numtris * 3, GL_UNSIGNED_SHORT, (void *)(intptr_t)indexofs);
+
+	// clean up
+	qglDisableVertexAttribArray(texCoordsAttrIndex);
+	qglDisableVertexAttribArray(pose1VertexAttrIndex);
+	qglDisableVertexAttribArray(pose2VertexAttrIndex);
+	qglDisableVertexAttribArray(pose1NormalAttrIndex);
+	qglDisableVertexAttribArray(pose2NormalAttrIndex);
+	qglDisableVertexAttribArray(pose1AnormAttrIndex);
+	qglDisableVertexAttribArray(pose2AnormAttrIndex);
+
+	qglUseProgram(0);
+	GL_SelectTexture(GL_TEXTURE0);
+
+	R_EndQ3SurfaceBlend (ent);
 }
 
 /*
@@ -3053,7 +3331,11 @@ void R_SetupQ3Frame (entity_t *ent)
 			texture = shader[shadernum].gl_texnum;
 			fb_texture = shader[shadernum].fb_texnum;
 
-			if (fb_texture && gl_mtexable)
+			if (r_alias_program != 0 && ent->model->meshvbo)
+			{
+				R_DrawQ3Frame_GLSL(frame, pmd3hdr, pmd3surf, ent, INTERP_MAXDIST, texture, fb_texture);
+			}
+			else if (fb_texture && gl_mtexable)
 			{
 				GL_DisableMultitexture();
 				glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
@@ -3470,6 +3752,236 @@ int SetFlameModelState (void)
 	return 0;
 }
 
+/*
+=============================================================
+
+Occlusion culling
+
+Entities that are expensive to draw get their bounding box drawn with an
+occlusion query after the world. The answer is only read back on the next
+frame, and only if the GPU has it ready, so this never stalls: an entity
+whose last query found no visible samples is skipped, and one that comes
+into view again shows up a frame late.
+
+=============================================================
+*/
+
+#define OCCLUSION_MIN_SURFS	16		// brush models with fewer surfaces are always drawn
+#define OCCLUSION_NEAR		8		// don't trust boxes the view is this close to
+
+typedef struct
+{
+	GLuint		query;
+	qboolean	pending;
+	qboolean	occluded;
+	int			framecount;		// last frame the entity was tested
+} occlusion_t;
+
+static occlusion_t	*r_occlusion_ents;
+int		c_occlusion_queries, c_occluded_ents;
+
+/*
+===============
+R_ClearOcclusion
+===============
+*/
+void R_ClearOcclusion (void)
+{
+	int	i;
+
+	if (!r_occlusion_ents)
+		return;
+
+	for (i = 0 ; i < MAX_EDICTS + MAX_STATIC_ENTITIES ; i++)
+		if (r_occlusion_ents[i].query)
+			qglDeleteQueries (1, &r_occlusion_ents[i].query);
+
+	memset (r_occlusion_ents, 0, (MAX_EDICTS + MAX_STATIC_ENTITIES) * sizeof(occlusion_t));
+}
+
+/*
+===============
+R_OcclusionForEntity
+
+Returns the occlusion state of a persistent entity that is worth testing
+this frame, NULL for anything else.
+===============
+*/
+static occlusion_t *R_OcclusionForEntity (entity_t *ent)
+{
+	int	num;
+
+	if (ent >= cl_entities && ent < cl_entities + cl_max_edicts)
+		num = ent - cl_entities;
+	else if (ent >= cl_static_entities && ent < cl_static_entities + MAX_STATIC_ENTITIES)
+		num = MAX_EDICTS + (ent - cl_static_entities);
+	else
+		return NULL;	// temporary entities change every frame
+
+	switch (ent->model->type)
+	{
+	case mod_alias:
+	case mod_md3:
+		break;
+
+	case mod_brush:
+		if (ent->model->nummodelsurfaces < OCCLUSION_MIN_SURFS)
+			return NULL;
+		break;
+
+	default:
+		return NULL;
+	}
+
+	if (ISTRANSPARENT(ent) || R_CullModelForEntity(ent))
+		return NULL;
+
+	if (!r_occlusion_ents)
+		r_occlusion_ents = Q_calloc (MAX_EDICTS + MAX_STATIC_ENTITIES, sizeof(occlusion_t));
+
+	return &r_occlusion_ents[num];
+}
+
+static void R_DrawOcclusionBox (vec3_t mins, vec3_t maxs)
+{
+	glBegin (GL_QUADS);
+
+	glVertex3f (mins[0], mins[1], mins[2]);
+	glVertex3f (maxs[0], mins[1], mins[2]);
+	glVertex3f (maxs[0], maxs[1], mins[2]);
+	glVertex3f (mins[0], maxs[1], mins[2]);
+
+	glVertex3f (mins[0], mins[1], maxs[2]);
+	glVertex3f (mins[0], maxs[1], maxs[2]);
+	glVertex3f (maxs[0], maxs[1], maxs[2]);
+	glVertex3f (maxs[0], mins[1], maxs[2]);
+
+	glVertex3f (mins[0], mins[1], mins[2]);
+	glVertex3f (mins[0], mins[1], maxs[2]);
+	glVertex3f (maxs[0], mins[1], maxs[2]);
+	glVertex3f (maxs[0], mins[1], mins[2]);
+
+	glVertex3f (mins[0], maxs[1], mins[2]);
+	glVertex3f (maxs[0], maxs[1], mins[2]);
+	glVertex3f (maxs[0], maxs[1], maxs[2]);
+	glVertex3f (mins[0], maxs[1], maxs[2]);
+
+	glVertex3f (mins[0], mins[1], mins[2]);
+	glVertex3f (mins[0], maxs[1], mins[2]);
+	glVertex3f (mins[0], maxs[1], maxs[2]);
+	glVertex3f (mins[0], mins[1], maxs[2]);
+
+	glVertex3f (maxs[0], mins[1], mins[2]);
+	glVertex3f (maxs[0], mins[1], maxs[2]);
+	glVertex3f (maxs[0], maxs[1], maxs[2]);
+	glVertex3f (maxs[0], maxs[1], mins[2]);
+
+	glEnd ();
+}
+
+/*
+===============
+R_QueryOcclusion
+
+Picks up last frame's query results for the entities on the list and
+issues new queries against the depth buffer the world has just filled.
+===============
+*/
+void R_QueryOcclusion (void)
+{
+	int			i;
+	GLuint		result;
+	entity_t	*ent;
+	occlusion_t	*o;
+	vec3_t		mins, maxs;
+	qboolean	stateset = false;
+
+	if (!r_occlusion.value || !gl_occlusion_able)
+		return;
+
+	for (i = 0 ; i < cl_numvisedicts ; i++)
+	{
+		ent = cl_visedicts[i];
+		if (!(o = R_OcclusionForEntity(ent)))
+			continue;
+
+		if (o->pending)
+		{
+			qglGetQueryObjectuiv (o->query, GL_QUERY_RESULT_AVAILABLE, &result);
+			if (result)
+			{
+				qglGetQueryObjectuiv (o->query, GL_QUERY_RESULT, &result);
+				o->occluded = !result;
+				o->pending = false;
+			}
+		}
+
+		// an answer about an entity that wasn't on the list last frame is stale
+		if (o->framecount != r_framecount - 1)
+			o->occluded = false;
+		o->framecount = r_framecount;
+
+		R_BoundsForEntity (ent, mins, maxs);
+		if (r_origin[0] > mins[0] - OCCLUSION_NEAR && r_origin[0] < maxs[0] + OCCLUSION_NEAR &&
+			r_origin[1] > mins[1] - OCCLUSION_NEAR && r_origin[1] < maxs[1] + OCCLUSION_NEAR &&
+			r_origin[2] > mins[2] - OCCLUSION_NEAR && r_origin[2] < maxs[2] + OCCLUSION_NEAR)
+		{
+			// the near plane could clip the box away
+			o->occluded = false;
+			continue;
+		}
+
+		if (o->pending)
+			continue;
+
+		if (!stateset)
+		{
+			glDisable (GL_TEXTURE_2D);
+			glDisable (GL_CULL_FACE);
+			glColorMask (GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			glDepthMask (GL_FALSE);
+			stateset = true;
+		}
+
+		if (!o->query)
+			qglGenQueries (1, &o->query);
+
+		qglBeginQuery (GL_SAMPLES_PASSED, o->query);
+		R_DrawOcclusionBox (mins, maxs);
+		qglEndQuery (GL_SAMPLES_PASSED);
+		o->pending = true;
+		c_occlusion_queries++;
+	}
+
+	if (stateset)
+	{
+		glDepthMask (GL_TRUE);
+		glColorMask (GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		if (gl_cull.value)
+			glEnable (GL_CULL_FACE);
+		glEnable (GL_TEXTURE_2D);
+	}
+}
+
+/*
+===============
+R_EntityOccluded
+===============
+*/
+static qboolean R_EntityOccluded (entity_t *ent)
+{
+	occlusion_t	*o;
+
+	if (!r_occlusion.value || !gl_occlusion_able)
+		return false;
+
+	if (!(o = R_OcclusionForEntity(ent)) || o->framecount != r_framecount || !o->occluded)
+		return false;
+
+	c_occluded_ents++;
+	return true;
+}
+
 /*
 =============
 R_DrawEntitiesOnList
@@ -3485,6 +3997,8 @@ void R_DrawEntitiesOnList ()
 	cl_numtransvisedicts = 0;
 	cl_num_wallhacked_entities = 0;
 
+	R_QueryOcclusion ();
+
 	// draw sprites seperately, because of alpha blending
 	for (i = 0 ; i < cl_numvisedicts ; i++)
 	{
@@ -3502,6 +4016,9 @@ void R_DrawEntitiesOnList ()
 			continue;
 		}
 
+		if (R_EntityOccluded(currententity))
+			continue;
+
 		switch (currententity->model->type)
 		{
 		case mod_alias:
@@ -3918,6 +4435,8 @@ void R_SetupFrame (void)
 
 	R_MarkSurfaces(); //johnfitz -- create texture chains from PVS
 
+	R_CullEntities ();
+
 	R_UpdateWarpTextures(); //johnfitz -- do this before R_Clear
 
 	R_Clear();
@@ -4029,7 +4548,10 @@ void R_Init (void)
 	Cvar_Register (&r_wateralpha);
 	Cvar_Register (&r_litwater);
 	Cvar_Register (&r_dynamic);
+	Cvar_Register (&r_dynamic_glsl);
 	Cvar_Register (&r_novis);
+	Cvar_Register (&r_markcache);
+	Cvar_Register (&r_occlusion);
 	Cvar_Register (&r_speeds);
 	Cvar_Register (&r_outline);
 	Cvar_Register (&r_outline_surf);
@@ -4111,6 +4633,7 @@ void R_Init (void)
 	R_InitParticles ();
 	R_InitVertexLights ();
 	R_InitDecals ();
+	LightKernels_Init ();
 	Fog_Init(); //johnfitz 
 
 	R_InitOtherTextures ();
@@ -4305,6 +4828,7 @@ void R_RenderView (void)
 		glFinish ();
 		time1 = Sys_DoubleTime ();
 		c_brush_polys = c_alias_polys = c_md3_polys = 0;
+		c_occlusion_queries = c_occluded_ents = 0;
 	}
 
 	if (gl_finish.value)
@@ -4313,13 +4837,22 @@ void R_RenderView (void)
 	R_SetupFrame();
 
 	// render normal view
+	Prof_Begin (prof_render);
 	R_RenderScene ();
+	Prof_End (prof_render);
 
 	R_ScaleView();
 
+	// the render list for the next frame was being built meanwhile
+	R_FinishRenderList ();
+	R_FinishCullEntities ();
+
 	if (r_speeds.value)
 	{
 		time2 = Sys_DoubleTime ();
-		Con_Printf ("%3i ms  %4i wpoly %4i epoly %4i md3poly\n", (int)((time2 - time1) * 1000), c_brush_polys, c_alias_polys, c_md3_polys);
+		Con_Printf ("%3i ms  %4i wpoly %4i epoly %4i md3poly", (int)((time2 - time1) * 1000), c_brush_polys, c_alias_polys, c_md3_polys);
+		if (r_occlusion.value && gl_occlusion_able)
+			Con_Printf ("  %3i queries %3i occluded", c_occlusion_queries, c_occluded_ents);
+		Con_Printf ("\n");
 	}
 }
@@ -373,11 +373,15 @@ void R_NewMap(void)
 		cl.worldmodel->leafs[i].efrags = NULL;
 
 	r_viewleaf = NULL;
+	R_ClearRenderLists();
+	R_ClearOcclusion();
+	R_ClearLightCache();
 	R_ClearParticles();
 	R_ClearDecals();
 
 	GL_BuildLightmaps();
 	GL_BuildBModelVertexBuffer();
+	GL_PruneTextureCache();
 
 	r_framecount = 0; //johnfitz -- paranoid?
 	r_visframecount = 0; //johnfitz -- paranoid?
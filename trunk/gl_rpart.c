@@ -57,9 +57,9 @@ typedef	enum
 	pd_q3flame, pd_q3gunshot, pd_q3teleport
 } part_draw_t;
 
+// a particle as the spawners fill it in, before it's stored
 typedef struct particle_s
 {
-	struct particle_s *next;
 	vec3_t		org, endorg;
 	col_t		color;
 	float		growth;
@@ -74,9 +74,30 @@ typedef struct particle_s
 	byte		bounces;
 } particle_t;
 
+// the stored fields of a particle that the update doesn't integrate
+typedef struct partinfo_s
+{
+	vec3_t		endorg;
+	col_t		color;
+	float		rotangle;
+	float		rotspeed;
+	byte		texindex;
+	byte		bounces;
+} partinfo_t;
+
 typedef	struct particle_tree_s
 {
-	particle_t	*start;
+	// the particles of this type, packed, with an array per integrated field
+	vec3_t		*org;
+	vec3_t		*vel;
+	float		*size;
+	float		*growth;
+	float		*start;
+	float		*die;
+	byte		*hit;
+	partinfo_t	*info;
+	int			numparts;
+	int			maxparts;
 	part_type_t	id;
 	part_draw_t	drawtype;
 	int			srcblend;
@@ -100,12 +121,12 @@ typedef struct particle_texture_s
 static	float	sint[7] = {0.000000, 0.781832, 0.974928, 0.433884, -0.433884, -0.974928, -0.781832};
 static	float	cost[7] = {1.000000, 0.623490, -0.222521, -0.900969, -0.900969, -0.222521, 0.623490};
 
-static	particle_t *particles, *free_particles;
 static	particle_type_t	particle_types[num_particletypes];
 static	int		particle_type_index[num_particletypes];	
 static	particle_texture_t particle_textures[num_particletextures];
 
 static	int		r_numparticles;
+static	int		num_live_particles;
 static	vec3_t	zerodir = {22, 22, 22};
 static	int		particle_count = 0;
 static	float	particle_time;
@@ -360,8 +381,6 @@ void QMB_InitParticles (void)
 		r_numparticles = DEFAULT_NUM_PARTICLES;
 	}
 
-	particles = Hunk_AllocName (r_numparticles * sizeof(particle_t), "qmb:particles");
-
 	ADD_PARTICLE_TYPE(p_spark, pd_spark, GL_SRC_ALPHA, GL_ONE, ptex_none, 255, -32, 0, pm_bounce, 1.3);
 	ADD_PARTICLE_TYPE(p_sparkray, pd_sparkray, GL_SRC_ALPHA, GL_ONE, ptex_none, 255, -0, 0, pm_nophysics, 0);
 	ADD_PARTICLE_TYPE(p_gunblast, pd_spark, GL_SRC_ALPHA, GL_ONE, ptex_none, 255, -16, 0, pm_bounce, 1.3);
@@ -415,260 +434,648 @@ void QMB_ClearParticles (void)
 		return;
 
 	particle_count = 0;
-	memset (particles, 0, r_numparticles * sizeof(particle_t));
-	free_particles = &particles[0];
-
-	for (i = 0 ; i + 1 < r_numparticles ; i++)
-		particles[i].next = &particles[i+1];
-	particles[r_numparticles-1].next = NULL;
+	num_live_particles = 0;
 
 	for (i = 0 ; i < num_particletypes ; i++)
-		particle_types[i].start = NULL;
+		particle_types[i].numparts = 0;
+}
+
+/*
+================
+QMB_NewParticle
+
+Clears the particle the spawners fill in and hand to QMB_StoreParticle
+================
+*/
+static particle_t *QMB_NewParticle (void)
+{
+	static	particle_t	newparticle;
+
+	memset (&newparticle, 0, sizeof(newparticle));
+
+	return &newparticle;
+}
+
+static void QMB_GrowParticles (particle_type_t *pt)
+{
+	pt->maxparts = pt->maxparts ? min(pt->maxparts * 2, r_numparticles) : 64;
+	pt->org = Q_realloc (pt->org, pt->maxparts * sizeof(*pt->org));
+	pt->vel = Q_realloc (pt->vel, pt->maxparts * sizeof(*pt->vel));
+	pt->size = Q_realloc (pt->size, pt->maxparts * sizeof(*pt->size));
+	pt->growth = Q_realloc (pt->growth, pt->maxparts * sizeof(*pt->growth));
+	pt->start = Q_realloc (pt->start, pt->maxparts * sizeof(*pt->start));
+	pt->die = Q_realloc (pt->die, pt->maxparts * sizeof(*pt->die));
+	pt->hit = Q_realloc (pt->hit, pt->maxparts * sizeof(*pt->hit));
+	pt->info = Q_realloc (pt->info, pt->maxparts * sizeof(*pt->info));
+}
+
+/*
+================
+QMB_StoreParticle
+
+Appends a particle to the type's arrays, growing them as needed.
+The caller checks num_live_particles against r_numparticles
+================
+*/
+static void QMB_StoreParticle (particle_type_t *pt, particle_t *p)
+{
+	int			n;
+	partinfo_t	*info;
+
+	if (pt->numparts == pt->maxparts)
+		QMB_GrowParticles (pt);
+
+	n = pt->numparts++;
+	VectorCopy (p->org, pt->org[n]);
+	VectorCopy (p->vel, pt->vel[n]);
+	pt->size[n] = p->size;
+	pt->growth[n] = p->growth;
+	pt->start[n] = p->start;
+	pt->die[n] = p->die;
+	pt->hit[n] = p->hit;
+
+	info = &pt->info[n];
+	VectorCopy (p->endorg, info->endorg);
+	memcpy (info->color, p->color, sizeof(col_t));
+	info->rotangle = p->rotangle;
+	info->rotspeed = p->rotspeed;
+	info->texindex = p->texindex;
+	info->bounces = p->bounces;
+
+	num_live_particles++;
+}
+
+// moves the last particle of the type into slot n
+static void QMB_RemoveParticle (particle_type_t *pt, int n)
+{
+	int		last;
+
+	last = --pt->numparts;
+	VectorCopy (pt->org[last], pt->org[n]);
+	VectorCopy (pt->vel[last], pt->vel[n]);
+	pt->size[n] = pt->size[last];
+	pt->growth[n] = pt->growth[last];
+	pt->start[n] = pt->start[last];
+	pt->die[n] = pt->die[last];
+	pt->hit[n] = pt->hit[last];
+	pt->info[n] = pt->info[last];
+
+	num_live_particles--;
 }
 
 __inline static void AddParticle (part_type_t type, vec3_t org, int count, float size, float time, col_t col, vec3_t dir);
 
-static void QMB_UpdateParticles (void)
+// a particle that has started, hasn't landed and hasn't shrunk away gets moved
+#define PARTICLE_MOVES(_pt, _n) (particle_time >= (_pt)->start[_n] && !(_pt)->hit[_n] && (_pt)->size[_n] > 0)
+
+/*
+================
+QMB_IntegrateParticles
+
+Grows and accelerates the particles of a type. The loops have no
+branches, so they vectorize: a particle that hasn't started gets a zero
+time step, and one that has landed keeps its velocity
+================
+*/
+static void QMB_IntegrateParticles (particle_type_t *pt, float frametime, float grav)
 {
-	int			i;
-	float		grav, bounce, frametime;
-	vec3_t		oldorg, stop, normal;
-	particle_type_t	*pt;
-	particle_t	*p, *kill;
+	int			j, numparts;
+	float		time, vgrav, accel, dt, moves, *size, *growth, *start;
+	vec3_t		*vel;
+	byte		*hit;
+
+	// in locals, so the stores can't alias them
+	time = particle_time;
+	numparts = pt->numparts;
+	size = pt->size;
+	growth = pt->growth;
+	start = pt->start;
+	vel = pt->vel;
+	hit = pt->hit;
+
+	for (j = 0 ; j < numparts ; j++)
+	{
+		dt = (time >= start[j]) ? frametime : 0;
+		size[j] += growth[j] * dt;
+	}
 
-	particle_count = 0;
-	frametime = fabs(cl.ctime - cl.oldtime);
-	grav = sv_gravity.value / 800.0;
+	vgrav = pt->grav * grav * frametime;
+	accel = pt->accel * frametime;
+	for (j = 0 ; j < numparts ; j++)
+	{
+		moves = (float)((time >= start[j]) & !hit[j]);
+		vel[j][2] += vgrav * moves;
+		dt = 1 + accel * moves;
+		vel[j][0] *= dt;
+		vel[j][1] *= dt;
+		vel[j][2] *= dt;
+	}
+}
 
-	for (i = 0 ; i < num_particletypes ; i++)
+/*
+================
+QMB_FadeParticles
+
+Kills the started particles that have shrunk away, and fades and turns
+the others. All of the per type decisions are made before the loop
+================
+*/
+static void QMB_FadeParticles (particle_type_t *pt, float frametime)
+{
+	int			j, fade;
+	float		startalpha, *start, *die;
+	partinfo_t	*p;
+
+	startalpha = pt->startalpha;
+	start = pt->start;
+	die = pt->die;
+
+	// 0 = fade out, 1 = opaque, 2 = fade in and out again
+	switch (pt->id)
 	{
-		pt = &particle_types[i];
+	case p_q3blood:	// avoid alpha for q3blood
+		fade = 1;
+		break;
+
+	case p_q3explosion:
+	case p_q3flame:
+	case p_q3gunshot:
+		fade = 2;
+		break;
+
+	default:
+		fade = 0;
+		break;
+	}
+
+	for (j = 0, p = pt->info ; j < pt->numparts ; j++, p++)
+	{
+		if (particle_time < start[j])
+			continue;
+
+		particle_count++;
+
+		if (pt->size[j] <= 0)
+		{
+			die[j] = 0;
+			continue;
+		}
+
+		if (fade == 0)
+		{
+			p->color[3] = startalpha * ((die[j] - particle_time) / (die[j] - start[j]));
+		}
+		else if (fade == 1)
+		{
+			p->color[3] = 255;
+		}
+		else if (particle_time < (start[j] + (die[j] - start[j]) / 2.0))
+		{
+			if (pt->id == p_q3gunshot && !p->texindex)
+				p->color[3] = 255;
+			else
+				p->color[3] = startalpha * ((particle_time - start[j]) / (die[j] - start[j]) * 2);
+		}
+		else
+		{
+			p->color[3] = startalpha * ((die[j] - particle_time) / (die[j] - start[j]) * 2);
+		}
+
+		p->rotangle += p->rotspeed * frametime;
+	}
+}
+
+/*
+================
+QMB_MoveParticles
+
+Moves the particles of a type. The move type is the same for all of them,
+so only the types that can collide with the world trace anything
+================
+*/
+static void QMB_MoveParticles (particle_type_t *pt, float frametime)
+{
+	int			j;
+	float		bounce;
+	vec3_t		oldorg, stop, normal;
+	float		*org, *vel;
 
-		if (pt->start)
+	switch (pt->move)
+	{
+	case pm_static:
+		break;
+
+	case pm_nophysics:
+		for (j = 0 ; j < pt->numparts ; j++)
 		{
-			p = pt->start;
-			while (p && p->next)
+			if (PARTICLE_MOVES(pt, j))
+				VectorMA (pt->org[j], frametime, pt->vel[j], pt->org[j]);
+		}
+		break;
+
+	case pm_normal:
+		for (j = 0 ; j < pt->numparts ; j++)
+		{
+			if (!PARTICLE_MOVES(pt, j))
+				continue;
+
+			org = pt->org[j];
+			vel = pt->vel[j];
+
+			VectorCopy (org, oldorg);
+			VectorMA (org, frametime, vel, org);
+			if (CONTENTS_SOLID == TruePointContents(org))
 			{
-				kill = p->next;
-				if (kill->die <= particle_time)
-				{
-					p->next = kill->next;
-					kill->next = free_particles;
-					free_particles = kill;
-				}
-				else
+				pt->hit[j] = 1;
+				if (pt->id == p_blood3 && gl_decal_blood.value)
 				{
-					p = p->next;
+					TraceLineN (oldorg, org, stop, normal);
+					if (stop != org && VectorLength(stop) != 0)
+					{
+						vec3_t	tangent;
+
+						VectorCopy (stop, org);
+						VectorCopy (normal, vel);
+						CrossProduct (normal, vel, tangent);
+						R_SpawnDecal (org, normal, tangent, decal_blood3, 12);
+					}
 				}
-			}
-			if (pt->start->die <= particle_time)
-			{
-				kill = pt->start;
-				pt->start = kill->next;
-				kill->next = free_particles;
-				free_particles = kill;
+				VectorCopy (oldorg, org);
+				VectorClear (vel);
 			}
 		}
+		break;
 
-		for (p = pt->start ; p ; p = p->next)
+	case pm_float:
+		for (j = 0 ; j < pt->numparts ; j++)
 		{
-			if (particle_time < p->start)
+			if (!PARTICLE_MOVES(pt, j))
 				continue;
 
-			particle_count++;
+			org = pt->org[j];
+			vel = pt->vel[j];
 
-			p->size += p->growth * frametime;
+			VectorMA (org, frametime, vel, org);
+			org[2] += pt->size[j] + 1;
+			if (!ISUNDERWATER(TruePointContents(org)))
+				pt->die[j] = 0;
+			org[2] -= pt->size[j] + 1;
+		}
+		break;
 
-			if (p->size <= 0)
-			{
-				p->die = 0;
+	case pm_die:
+		for (j = 0 ; j < pt->numparts ; j++)
+		{
+			if (!PARTICLE_MOVES(pt, j))
 				continue;
-			}
 
-			switch (pt->id)
-			{
-			case p_q3blood:	// avoid alpha for q3blood
-				p->color[3] = 255;
-				break;
+			org = pt->org[j];
+			vel = pt->vel[j];
 
-			case p_q3explosion:
-			case p_q3flame:
-			case p_q3gunshot:
-				if (particle_time < (p->start + (p->die - p->start) / 2.0))
-				{
-					if (pt->id == p_q3gunshot && !p->texindex)
-						p->color[3] = 255;
-					else
-						p->color[3] = pt->startalpha * ((particle_time - p->start) / (p->die - p->start) * 2);
-				}
-				else
+			VectorCopy (org, oldorg);
+			VectorMA (org, frametime, vel, org);
+			if (CONTENTS_SOLID == TruePointContents(org))
+			{
+				TraceLineN (oldorg, org, stop, normal);
+				if (stop != org && VectorLength(stop) != 0)
 				{
-					p->color[3] = pt->startalpha * ((p->die - particle_time) / (p->die - p->start) * 2);
+					vec3_t	tangent;
+
+					VectorCopy (stop, org);
+					VectorCopy (normal, vel);
+					CrossProduct (normal, vel, tangent);
+					if ((pt->id == p_fire || pt->id == p_dpfire) && gl_decal_explosions.value)
+						R_SpawnDecal (org, normal, tangent, decal_burn, 32);
+					else if (pt->id == p_blood1 && gl_decal_blood.value)
+						R_SpawnDecal (org, normal, tangent, decal_blood1, 12);
+					else if (pt->id == p_blood2 && gl_decal_blood.value)
+						R_SpawnDecal (org, normal, tangent, decal_blood2, 12);
 				}
-				break;
-
-			default:
-				p->color[3] = pt->startalpha * ((p->die - particle_time) / (p->die - p->start));
-				break;
+				VectorCopy (oldorg, org);
+				VectorClear (vel);
+				pt->die[j] = 0;
 			}
+		}
+		break;
 
-			p->rotangle += p->rotspeed * frametime;
-
-			if (p->hit)
+	case pm_bounce:
+		for (j = 0 ; j < pt->numparts ; j++)
+		{
+			if (!PARTICLE_MOVES(pt, j))
 				continue;
 
-			p->vel[2] += pt->grav * grav * frametime;
-
-			VectorScale (p->vel, 1 + pt->accel * frametime, p->vel);
+			org = pt->org[j];
+			vel = pt->vel[j];
 
-			switch (pt->move)
+			if (!gl_bounceparticles.value || pt->info[j].bounces)
 			{
-			case pm_static:
-				break;
-
-			case pm_normal:
-				VectorCopy (p->org, oldorg);
-				VectorMA (p->org, frametime, p->vel, p->org);
-				if (CONTENTS_SOLID == TruePointContents(p->org))
+				VectorMA (org, frametime, vel, org);
+				if (CONTENTS_SOLID == TruePointContents(org))
+					pt->die[j] = 0;
+			}
+			else
+			{
+				VectorCopy (org, oldorg);
+				VectorMA (org, frametime, vel, org);
+				if (CONTENTS_SOLID == TruePointContents(org))
 				{
-					p->hit = 1;
-					if (pt->id == p_blood3 && gl_decal_blood.value)
+					if (TraceLineN(oldorg, org, stop, normal))
 					{
-						TraceLineN (oldorg, p->org, stop, normal);
-						if (stop != p->org && VectorLength(stop) != 0)
-						{
-							vec3_t	tangent;
-
-							VectorCopy (stop, p->org);
-							VectorCopy (normal, p->vel);
-							CrossProduct (normal, p->vel, tangent);
-							R_SpawnDecal (p->org, normal, tangent, decal_blood3, 12);
-						}
+						VectorCopy (stop, org);
+						bounce = -pt->custom * DotProduct(vel, normal);
+						VectorMA (vel, bounce, normal, vel);
+						pt->info[j].bounces++;
 					}
-					VectorCopy (oldorg, p->org);
-					VectorClear (p->vel);
 				}
-				break;
-
-			case pm_float:
-				VectorMA (p->org, frametime, p->vel, p->org);
-				p->org[2] += p->size + 1;
-				if (!ISUNDERWATER(TruePointContents(p->org)))
-					p->die = 0;
-				p->org[2] -= p->size + 1;
-				break;
-
-			case pm_nophysics:
-				VectorMA (p->org, frametime, p->vel, p->org);
-				break;
-
-			case pm_die:
-				VectorCopy (p->org, oldorg);
-				VectorMA (p->org, frametime, p->vel, p->org);
-				if (CONTENTS_SOLID == TruePointContents(p->org))
-				{
-					TraceLineN (oldorg, p->org, stop, normal);
-					if (stop != p->org && VectorLength(stop) != 0)
-					{
-						vec3_t	tangent;
+			}
+		}
+		break;
 
-						VectorCopy (stop, p->org);
-						VectorCopy (normal, p->vel);
-						CrossProduct (normal, p->vel, tangent);
-						if ((pt->id == p_fire || pt->id == p_dpfire) && gl_decal_explosions.value)
-							R_SpawnDecal (p->org, normal, tangent, decal_burn, 32);
-						else if (pt->id == p_blood1 && gl_decal_blood.value)
-							R_SpawnDecal (p->org, normal, tangent, decal_blood1, 12);
-						else if (pt->id == p_blood2 && gl_decal_blood.value)
-							R_SpawnDecal (p->org, normal, tangent, decal_blood2, 12);
-					}
-					VectorCopy (oldorg, p->org);
-					VectorClear (p->vel);
-					p->die = 0;
-				}
-				break;
+	// these spawn p_streaktrail particles, which live in another array
+	case pm_streak:
+		for (j = 0 ; j < pt->numparts ; j++)
+		{
+			if (!PARTICLE_MOVES(pt, j))
+				continue;
 
-			case pm_bounce:
-				if (!gl_bounceparticles.value || p->bounces)
-				{
-					VectorMA (p->org, frametime, p->vel, p->org);
-					if (CONTENTS_SOLID == TruePointContents(p->org))
-						p->die = 0;
-				}
-				else
-				{
-					VectorCopy (p->org, oldorg);
-					VectorMA (p->org, frametime, p->vel, p->org);
-					if (CONTENTS_SOLID == TruePointContents(p->org))
-					{
-						if (TraceLineN(oldorg, p->org, stop, normal))
-						{
-							VectorCopy (stop, p->org);
-							bounce = -pt->custom * DotProduct(p->vel, normal);
-							VectorMA (p->vel, bounce, normal, p->vel);
-							p->bounces++;
-						}
-					}
-				}
-				break;
+			org = pt->org[j];
+			vel = pt->vel[j];
 
-			case pm_streak:
-				VectorCopy (p->org, oldorg);
-				VectorMA (p->org, frametime, p->vel, p->org);
-				if (CONTENTS_SOLID == TruePointContents(p->org)) 
+			VectorCopy (org, oldorg);
+			VectorMA (org, frametime, vel, org);
+			if (CONTENTS_SOLID == TruePointContents(org))
+			{
+				if (TraceLineN(oldorg, org, stop, normal))
 				{
-					if (TraceLineN(oldorg, p->org, stop, normal))
-					{
-						VectorCopy (stop, p->org);
-						bounce = -pt->custom * DotProduct(p->vel, normal);
-						VectorMA (p->vel, bounce, normal, p->vel);
-					}
+					VectorCopy (stop, org);
+					bounce = -pt->custom * DotProduct(vel, normal);
+					VectorMA (vel, bounce, normal, vel);
 				}
-				AddParticle (p_streaktrail, oldorg, 1, p->size, 0.2, p->color, p->org);
-				if (!VectorLength(p->vel))
-					p->die = 0;
-				break;
-
-			case pm_streakwave:
-				VectorCopy (p->org, oldorg);
-				VectorMA (p->org, frametime, p->vel, p->org);
-				AddParticle (p_streaktrail, oldorg, 1, p->size, 0.5, p->color, p->org);
-				p->vel[0] = 19 * p->vel[0] / 20.0;
-				p->vel[1] = 19 * p->vel[1] / 20.0;
-				p->vel[2] = 19 * p->vel[2] / 20.0;
-				break;
-
-			default:
-				Host_Error ("QMB_UpdateParticles: unexpected pt->move");
-				break;
 			}
+			AddParticle (p_streaktrail, oldorg, 1, pt->size[j], 0.2, pt->info[j].color, org);
+			if (!VectorLength(vel))
+				pt->die[j] = 0;
+		}
+		break;
+
+	case pm_streakwave:
+		for (j = 0 ; j < pt->numparts ; j++)
+		{
+			if (!PARTICLE_MOVES(pt, j))
+				continue;
+
+			org = pt->org[j];
+			vel = pt->vel[j];
+
+			VectorCopy (org, oldorg);
+			VectorMA (org, frametime, vel, org);
+			AddParticle (p_streaktrail, oldorg, 1, pt->size[j], 0.5, pt->info[j].color, org);
+			vel[0] = 19 * vel[0] / 20.0;
+			vel[1] = 19 * vel[1] / 20.0;
+			vel[2] = 19 * vel[2] / 20.0;
+		}
+		break;
+
+	default:
+		Host_Error ("QMB_UpdateParticles: unexpected pt->move");
+		break;
+	}
+}
+
+static void QMB_UpdateParticles (void)
+{
+	int			i, j;
+	float		grav, frametime;
+	particle_type_t	*pt;
+
+	particle_count = 0;
+	frametime = fabs(cl.ctime - cl.oldtime);
+	grav = sv_gravity.value / 800.0;
+
+	for (i = 0 ; i < num_particletypes ; i++)
+	{
+		pt = &particle_types[i];
+
+		// remove the dead ones by moving the last particle into their slot
+		for (j = 0 ; j < pt->numparts ; )
+		{
+			if (pt->die[j] <= particle_time)
+				QMB_RemoveParticle (pt, j);
+			else
+				j++;
+		}
+
+		if (!pt->numparts)
+			continue;
+
+		QMB_IntegrateParticles (pt, frametime, grav);
+		QMB_FadeParticles (pt, frametime);
+		QMB_MoveParticles (pt, frametime);
+	}
+}
+
+typedef struct
+{
+	vec3_t	xyz;
+	float	st[2];
+	col_t	color;
+} partvert_t;
+
+static	partvert_t	*part_verts;
+static	int			part_numverts, part_maxverts;
+static	GLuint		part_vbo;
+
+// texture coords of the billboard corners, as indexes into particle_texture_t.coords
+static	int		billboard_st[4][2] = {{0, 3}, {0, 1}, {2, 1}, {2, 3}};
+
+/*
+================
+QMB_AllocVerts
+
+Returns room for count more vertexes in the particle batch
+================
+*/
+static partvert_t *QMB_AllocVerts (int count)
+{
+	partvert_t	*v;
+
+	if (part_numverts + count > part_maxverts)
+	{
+		part_maxverts = max(part_maxverts * 2, part_numverts + count);
+		part_verts = Q_realloc (part_verts, part_maxverts * sizeof(partvert_t));
+	}
+
+	v = &part_verts[part_numverts];
+	part_numverts += count;
+
+	return v;
+}
+
+/*
+================
+QMB_FlushVerts
+
+Draws the batched vertexes with a single call, streaming them through a
+buffer object where available
+================
+*/
+static void QMB_FlushVerts (GLenum mode, qboolean textured)
+{
+	byte	*base;
+
+	if (!part_numverts)
+		return;
+
+	if (gl_vbo_able)
+	{
+		if (!part_vbo)
+			qglGenBuffers (1, &part_vbo);
+		GL_BindBuffer (GL_ARRAY_BUFFER, part_vbo);
+		// respecify the whole buffer so the driver doesn't wait on the last batch
+		qglBufferData (GL_ARRAY_BUFFER, part_numverts * sizeof(partvert_t), part_verts, GL_STREAM_DRAW);
+		base = NULL;
+	}
+	else
+	{
+		base = (byte *)part_verts;
+	}
+
+	glEnableClientState (GL_VERTEX_ARRAY);
+	glVertexPointer (3, GL_FLOAT, sizeof(partvert_t), base + offsetof(partvert_t, xyz));
+	glEnableClientState (GL_COLOR_ARRAY);
+	glColorPointer (4, GL_UNSIGNED_BYTE, sizeof(partvert_t), base + offsetof(partvert_t, color));
+	if (textured)
+	{
+		glEnableClientState (GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer (2, GL_FLOAT, sizeof(partvert_t), base + offsetof(partvert_t, st));
+	}
+
+	glDrawArrays (mode, 0, part_numverts);
+
+	glDisableClientState (GL_VERTEX_ARRAY);
+	glDisableClientState (GL_COLOR_ARRAY);
+	if (textured)
+		glDisableClientState (GL_TEXTURE_COORD_ARRAY);
+
+	if (gl_vbo_able)
+		GL_BindBuffer (GL_ARRAY_BUFFER, 0);
+
+	part_numverts = 0;
+}
+
+/*
+================
+QMB_EmitQuad
+
+Adds a quad to the batch, with the texture coords of the particle's
+texture piece when ptex is given
+================
+*/
+static void QMB_EmitQuad (vec3_t verts[4], partinfo_t *p, particle_texture_t *ptex)
+{
+	int			k;
+	partvert_t	*v;
+
+	v = QMB_AllocVerts (4);
+	for (k = 0 ; k < 4 ; k++, v++)
+	{
+		VectorCopy (verts[k], v->xyz);
+		if (ptex)
+		{
+			v->st[0] = ptex->coords[p->texindex][billboard_st[k][0]];
+			v->st[1] = ptex->coords[p->texindex][billboard_st[k][1]];
+		}
+		memcpy (v->color, p->color, sizeof(col_t));
+	}
+}
+
+/*
+================
+QMB_EmitBillboard
+
+Adds a billboard to the batch, placing the corners on the CPU the way
+the translate, scale and rotate around vpn used to
+================
+*/
+static void QMB_EmitBillboard (particle_type_t *pt, int n, particle_texture_t *ptex, vec3_t coord[4])
+{
+	int		j, k;
+	float	ang, c, s, d, size, *org;
+	vec3_t	cross, verts[4];
+	partinfo_t	*p;
+
+	p = &pt->info[n];
+	org = pt->org[n];
+	size = pt->size[n];
+
+	if (p->rotspeed || pt->id == p_q3rocketsmoke || pt->id == p_q3grenadesmoke)
+	{
+		ang = DEG2RAD(p->rotangle);
+		c = cos(ang);
+		s = sin(ang);
+		for (k = 0 ; k < 4 ; k++)
+		{
+			CrossProduct (vpn, coord[k], cross);
+			d = DotProduct (vpn, coord[k]) * (1 - c);
+			for (j = 0 ; j < 3 ; j++)
+				verts[k][j] = org[j] + size * (coord[k][j] * c + cross[j] * s + vpn[j] * d);
 		}
 	}
+	else
+	{
+		for (k = 0 ; k < 4 ; k++)
+			VectorMA (org, size, coord[k], verts[k]);
+	}
+
+	QMB_EmitQuad (verts, p, ptex);
 }
 
-#define DRAW_PARTICLE_BILLBOARD(_ptex, _p, _coord)		\
-	glPushMatrix ();									\
-	glTranslatef (_p->org[0], _p->org[1], _p->org[2]);	\
-	glScalef (_p->size, _p->size, _p->size);			\
-	if (_p->rotspeed || pt->id == p_q3rocketsmoke || pt->id == p_q3grenadesmoke)\
-		glRotatef (_p->rotangle, vpn[0], vpn[1], vpn[2]);\
-														\
-	glColor4ubv (_p->color);							\
-														\
-	glBegin (GL_QUADS);									\
-	glTexCoord2f (_ptex->coords[_p->texindex][0], _ptex->coords[_p->texindex][3]); glVertex3fv(_coord[0]);\
-	glTexCoord2f (_ptex->coords[_p->texindex][0], _ptex->coords[_p->texindex][1]); glVertex3fv(_coord[1]);\
-	glTexCoord2f (_ptex->coords[_p->texindex][2], _ptex->coords[_p->texindex][1]); glVertex3fv(_coord[2]);\
-	glTexCoord2f (_ptex->coords[_p->texindex][2], _ptex->coords[_p->texindex][3]); glVertex3fv(_coord[3]);\
-	glEnd ();											\
-														\
-	glPopMatrix ();
+/*
+================
+QMB_EmitSpark
+
+Adds the fan of a spark as triangles: a center vertex in the particle's
+color and a rim that fades to half brightness and no alpha
+================
+*/
+static void QMB_EmitSpark (partinfo_t *p, float size, vec3_t center, vec3_t rimorg)
+{
+	int			j, k;
+	col_t		rimcolor;
+	vec3_t		rim[8];
+	partvert_t	*v;
+
+	for (j = 7 ; j >= 0 ; j--)
+	{
+		for (k = 0 ; k < 3 ; k++)
+			rim[7-j][k] = rimorg[k] + vright[k] * cost[j%7] * size + vup[k] * sint[j%7] * size;
+	}
+
+	rimcolor[0] = p->color[0] >> 1;
+	rimcolor[1] = p->color[1] >> 1;
+	rimcolor[2] = p->color[2] >> 1;
+	rimcolor[3] = 0;
+
+	v = QMB_AllocVerts (7 * 3);
+	for (j = 0 ; j < 7 ; j++)
+	{
+		VectorCopy (center, v->xyz);
+		memcpy (v->color, p->color, sizeof(col_t));
+		v++;
+		VectorCopy (rim[j], v->xyz);
+		memcpy (v->color, rimcolor, sizeof(col_t));
+		v++;
+		VectorCopy (rim[j+1], v->xyz);
+		memcpy (v->color, rimcolor, sizeof(col_t));
+		v++;
+	}
+}
 
 void QMB_DrawParticles (void)
 {
-	int			i, j, k;
-	vec3_t		v, up, right, billboard[4], velcoord[4], neworg;
-	particle_t	*p;
+	int			i, j, n;
+	vec3_t		up, right, billboard[4], velcoord[4], neworg, rimorg, verts[4];
+	partinfo_t	*p;
 	particle_type_t	*pt;
 	particle_texture_t *ptex;
 
@@ -690,10 +1097,11 @@ void QMB_DrawParticles (void)
 	glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 	glShadeModel (GL_SMOOTH);
 
+	// every type shares one texture and blend mode, so each one is a single batch
 	for (i = 0 ; i < num_particletypes ; i++)
 	{
 		pt = &particle_types[i];
-		if (!pt->start)
+		if (!pt->numparts)
 			continue;
 
 		glBlendFunc (pt->srcblend, pt->dstblend);
@@ -706,104 +1114,87 @@ void QMB_DrawParticles (void)
 		case pd_beam:
 			ptex = &particle_textures[pt->texture];
 			GL_Bind (ptex->texnum);
-			for (p = pt->start ; p ; p = p->next) 
+			for (n = 0, p = pt->info ; n < pt->numparts ; n++, p++)
 			{
-				float	varray_vertex[16];
+				float		varray_vertex[16];
+				partvert_t	*v;
 
-				if (particle_time < p->start || particle_time >= p->die)
+				if (particle_time < pt->start[n] || particle_time >= pt->die[n])
 					continue;
 
-				glColor4ubv (p->color);
-				R_CalcBeamVerts (varray_vertex, p->org, p->endorg, p->size / 3.0);
-				glBegin (GL_QUADS);
-				glTexCoord2f (1, 0);
-				glVertex3f (varray_vertex[0], varray_vertex[1], varray_vertex[2]);
-				glTexCoord2f (1, 1);
-				glVertex3f (varray_vertex[4], varray_vertex[5], varray_vertex[6]);
-				glTexCoord2f (0, 1);
-				glVertex3f (varray_vertex[8], varray_vertex[9], varray_vertex[10]);
-				glTexCoord2f (0, 0);
-				glVertex3f (varray_vertex[12], varray_vertex[13], varray_vertex[14]);
-				glEnd ();
+				R_CalcBeamVerts (varray_vertex, pt->org[n], p->endorg, pt->size[n] / 3.0);
+				v = QMB_AllocVerts (4);
+				for (j = 0 ; j < 4 ; j++, v++)
+				{
+					VectorCopy (&varray_vertex[j*4], v->xyz);
+					v->st[0] = (j < 2) ? 1 : 0;
+					v->st[1] = (j == 1 || j == 2) ? 1 : 0;
+					memcpy (v->color, p->color, sizeof(col_t));
+				}
 			}
+			QMB_FlushVerts (GL_QUADS, true);
 			break;
 
 		case pd_spark:
 			glDisable (GL_TEXTURE_2D);
-			for (p = pt->start ; p ; p = p->next)
+			for (n = 0, p = pt->info ; n < pt->numparts ; n++, p++)
 			{
-				if (particle_time < p->start || particle_time >= p->die)
+				if (particle_time < pt->start[n] || particle_time >= pt->die[n])
 					continue;
 
-				glBegin (GL_TRIANGLE_FAN);
-				glColor4ubv (p->color);
-				glVertex3fv (p->org);
-				glColor4ub (p->color[0] >> 1, p->color[1] >> 1, p->color[2] >> 1, 0);
-				for (j=7 ; j>=0 ; j--)
-				{
-					for (k=0 ; k<3 ; k++)
-						v[k] = p->org[k] - p->vel[k] / 8 + vright[k] * cost[j%7] * p->size + vup[k] * sint[j%7] * p->size;
-					glVertex3fv (v);
-				}
-				glEnd ();
+				VectorMA (pt->org[n], -1.0 / 8, pt->vel[n], rimorg);
+				QMB_EmitSpark (p, pt->size[n], pt->org[n], rimorg);
 			}
+			QMB_FlushVerts (GL_TRIANGLES, false);
 			glEnable (GL_TEXTURE_2D);
 			break;
 
 		case pd_sparkray:
 			glDisable (GL_TEXTURE_2D);
-			for (p = pt->start ; p ; p = p->next)
+			for (n = 0, p = pt->info ; n < pt->numparts ; n++, p++)
 			{
-				if (particle_time < p->start || particle_time >= p->die)
+				if (particle_time < pt->start[n] || particle_time >= pt->die[n])
 					continue;
 
-				if (!TraceLineN(p->endorg, p->org, neworg, NULL))
-					VectorCopy (p->org, neworg);
+				if (!TraceLineN(p->endorg, pt->org[n], neworg, NULL))
+					VectorCopy (pt->org[n], neworg);
 
-				glBegin (GL_TRIANGLE_FAN);
-				glColor4ubv (p->color);
-				glVertex3fv (p->endorg);
-				glColor4ub (p->color[0] >> 1, p->color[1] >> 1, p->color[2] >> 1, 0);
-				for (j=7 ; j>=0 ; j--)
-				{
-					for (k=0 ; k<3 ; k++)
-						v[k] = neworg[k] + vright[k] * cost[j%7] * p->size + vup[k] * sint[j%7] * p->size;
-					glVertex3fv (v);
-				}
-				glEnd ();
+				QMB_EmitSpark (p, pt->size[n], p->endorg, neworg);
 			}
+			QMB_FlushVerts (GL_TRIANGLES, false);
 			glEnable (GL_TEXTURE_2D);
 			break;
 
 		case pd_billboard:
 			ptex = &particle_textures[pt->texture];
 			GL_Bind (ptex->texnum);
-			for (p = pt->start ; p ; p = p->next)
+			for (n = 0, p = pt->info ; n < pt->numparts ; n++, p++)
 			{
-				if (particle_time < p->start || particle_time >= p->die)
+				if (particle_time < pt->start[n] || particle_time >= pt->die[n])
 					continue;
 
 				for (j = 0 ; j < cl.maxclients ; j++)
 				{
-					if (pt->custom != -1 && VectorSupCompare(p->org, cl_entities[1+j].origin, 40))
+					if (pt->custom != -1 && VectorSupCompare(pt->org[n], cl_entities[1+j].origin, 40))
 					{
-						p->die = 0;
+						pt->die[n] = 0;
 						continue;
 					}
 				}
-				DRAW_PARTICLE_BILLBOARD(ptex, p, billboard);
+				QMB_EmitBillboard (pt, n, ptex, billboard);
 			}
+			QMB_FlushVerts (GL_QUADS, true);
 			break;
 
 		case pd_billboard_vel:
 			ptex = &particle_textures[pt->texture];
 			GL_Bind (ptex->texnum);
-			for (p = pt->start ; p ; p = p->next)
+			for (n = 0, p = pt->info ; n < pt->numparts ; n++, p++)
 			{
-				if (particle_time < p->start || particle_time >= p->die)
+				if (particle_time < pt->start[n] || particle_time >= pt->die[n])
 					continue;
 
-				VectorCopy (p->vel, up);
+				VectorCopy (pt->vel[n], up);
 				CrossProduct (vpn, up, right);
 				VectorNormalizeFast (right);
 				VectorScale (up, pt->custom, up);
@@ -812,109 +1203,69 @@ void QMB_DrawParticles (void)
 				VectorSubtract (right, up, velcoord[3]);
 				VectorNegate (velcoord[2], velcoord[0]);
 				VectorNegate (velcoord[3], velcoord[1]);
-				DRAW_PARTICLE_BILLBOARD(ptex, p, velcoord);
+				QMB_EmitBillboard (pt, n, ptex, velcoord);
 			}
+			QMB_FlushVerts (GL_QUADS, true);
 			break;
 
 		case pd_q3flame:
 			ptex = &particle_textures[pt->texture];
 			GL_Bind (ptex->texnum);
-			for (p = pt->start ; p ; p = p->next)
+			for (n = 0, p = pt->info ; n < pt->numparts ; n++, p++)
 			{
-				float	varray_vertex[16];
-				float	xhalf = p->size / 2.0, yhalf = p->size;
-			//	vec3_t	org, v, end, normal;
+				float	xhalf = pt->size[n] / 2.0, yhalf = pt->size[n];
+				float	c = cos(DEG2RAD(45)), s;
+
+			// sigh. The best would be if the flames were always orthogonal to their surfaces
+			// but I'm afraid it's impossible to get that work (w/o progs modification of course)
 
-				if (particle_time < p->start || particle_time >= p->die)
+				if (particle_time < pt->start[n] || particle_time >= pt->die[n])
 					continue;
 
-				glDisable (GL_CULL_FACE);
-				for (j=0 ; j<2 ; j++)
+				// two crossed quads, turned 45 degrees either way around z
+				for (j = 0 ; j < 2 ; j++)
 				{
-					glPushMatrix ();
-					glTranslatef (p->org[0], p->org[1], p->org[2]);
-					glRotatef (!j ? 45 : -45, 0, 0, 1);
-					glColor4ubv (p->color);
+					s = !j ? sin(DEG2RAD(45)) : sin(DEG2RAD(-45));
 
-			// sigh. The best would be if the flames were always orthogonal to their surfaces
-			// but I'm afraid it's impossible to get that work (w/o progs modification of course)
-			/*	VectorCopy (cl_entities[cl.viewentity].origin, org);
-				VectorSubtract (p->org, org, v);
-				VectorScale (v, 2, v);
-				VectorAdd (org, v, end);
-				if (TraceLineN(org, end, end, normal))
-				{
-					varray_vertex[0] = normal[0] * xhalf;
-					varray_vertex[1] = normal[1] * xhalf;
-					varray_vertex[2] = -yhalf;
-					varray_vertex[4] = normal[0] * xhalf;
-					varray_vertex[5] = normal[1] * xhalf;
-					varray_vertex[6] = yhalf;
-					varray_vertex[8] = normal[0] * -xhalf;
-					varray_vertex[9] = normal[1] * -xhalf;
-					varray_vertex[10] = yhalf;
-					varray_vertex[12] = normal[0] * -xhalf;
-					varray_vertex[13] = normal[1] * -xhalf;
-					varray_vertex[14] = -yhalf;
-				}*/
-
-					varray_vertex[0] = 0;
-					varray_vertex[1] = xhalf;
-					varray_vertex[2] = -yhalf;
-					varray_vertex[4] = 0;
-					varray_vertex[5] = xhalf;
-					varray_vertex[6] = yhalf;
-					varray_vertex[8] = 0;
-					varray_vertex[9] = -xhalf;
-					varray_vertex[10] = yhalf;
-					varray_vertex[12] = 0;
-					varray_vertex[13] = -xhalf;
-					varray_vertex[14] = -yhalf;
-
-					glBegin (GL_QUADS);
-					glTexCoord2f (ptex->coords[p->texindex][0], ptex->coords[p->texindex][3]);
-					glVertex3f (varray_vertex[0], varray_vertex[1], varray_vertex[2]);
-					glTexCoord2f (ptex->coords[p->texindex][0], ptex->coords[p->texindex][1]);
-					glVertex3f (varray_vertex[4], varray_vertex[5], varray_vertex[6]);
-					glTexCoord2f (ptex->coords[p->texindex][2], ptex->coords[p->texindex][1]);
-					glVertex3f (varray_vertex[8], varray_vertex[9], varray_vertex[10]);
-					glTexCoord2f (ptex->coords[p->texindex][2], ptex->coords[p->texindex][3]);
-					glVertex3f (varray_vertex[12], varray_vertex[13], varray_vertex[14]);
-					glEnd ();
-
-					glPopMatrix ();
+					VectorSet (verts[0], pt->org[n][0] - xhalf * s, pt->org[n][1] + xhalf * c, pt->org[n][2] - yhalf);
+					VectorSet (verts[1], pt->org[n][0] - xhalf * s, pt->org[n][1] + xhalf * c, pt->org[n][2] + yhalf);
+					VectorSet (verts[2], pt->org[n][0] + xhalf * s, pt->org[n][1] - xhalf * c, pt->org[n][2] + yhalf);
+					VectorSet (verts[3], pt->org[n][0] + xhalf * s, pt->org[n][1] - xhalf * c, pt->org[n][2] - yhalf);
+					QMB_EmitQuad (verts, p, ptex);
 				}
-				glEnable (GL_CULL_FACE);
 			}
+			glDisable (GL_CULL_FACE);
+			QMB_FlushVerts (GL_QUADS, true);
+			glEnable (GL_CULL_FACE);
 			break;
 
 		case pd_q3gunshot:
-			for (p = pt->start ; p ; p = p->next)
-				QMB_Q3Gunshot (p->org, (int)p->texindex, (float)p->color[3] / 255.0);
+			for (n = 0, p = pt->info ; n < pt->numparts ; n++, p++)
+				QMB_Q3Gunshot (pt->org[n], (int)p->texindex, (float)p->color[3] / 255.0);
 			break;
 
 		case pd_q3teleport:
-			for (p = pt->start ; p ; p = p->next)
+			for (n = 0, p = pt->info ; n < pt->numparts ; n++, p++)
 			{
 				float alpha = (float)p->color[3] / 255.0;
 
 				if (gl_part_telesplash.value != 2 && gl_part_telesplash.value != 3)
 				{
-					p->die = 0;
+					pt->die[n] = 0;
 					continue;
 				}
 				if (gl_part_telesplash.value == 3)
 				{
-					if (cl.time < p->die - ((p->die - p->start) / 2.0))
+					if (cl.time < pt->die[n] - ((pt->die[n] - pt->start[n]) / 2.0))
 					{
 						alpha = 1.0;
 					}
 					else
 					{
-						alpha = (p->die - cl.time) / ((p->die - p->start) / 2.0);
+						alpha = (pt->die[n] - cl.time) / ((pt->die[n] - pt->start[n]) / 2.0);
 					}
 				}
-				QMB_Q3Teleport (p->org, alpha);
+				QMB_Q3Teleport (pt->org[n], alpha);
 			}
 			break;
 
@@ -942,10 +1293,7 @@ void d8to24col (col_t colourv, int colour)
 }
 
 #define	INIT_NEW_PARTICLE(_pt, _p, _color, _size, _time)\
-	_p = free_particles;				\
-	free_particles = _p->next;			\
-	_p->next = _pt->start;				\
-	_pt->start = _p;					\
+	_p = QMB_NewParticle ();			\
 	_p->size = _size;					\
 	_p->hit = 0;						\
 	_p->start = cl.time;				\
@@ -987,7 +1335,7 @@ __inline static void AddParticle (part_type_t type, vec3_t org, int count, float
 		count *= 3;
 	}
 
-	for (i = 0 ; i < count && free_particles ; i++)
+	for (i = 0 ; i < count && num_live_particles < r_numparticles ; i++)
 	{
 		if (colorMapped)
 		{
@@ -1170,6 +1518,8 @@ __inline static void AddParticle (part_type_t type, vec3_t org, int count, float
 			Host_Error ("AddParticle: unexpected type");
 			break;
 		}
+
+		QMB_StoreParticle (pt, p);
 	}
 }
 
@@ -1248,7 +1598,7 @@ __inline static void AddParticleTrail (part_type_t type, vec3_t start, vec3_t en
 
 	VectorScale (delta, 1.0 / num_particles, delta);
 
-	for (i = 0 ; i < num_particles && free_particles ; i++)
+	for (i = 0 ; i < num_particles && num_live_particles < r_numparticles ; i++)
 	{
 		color = col ? col : ColorForParticle (type);
 		INIT_NEW_PARTICLE(pt, p, color, size, time);
@@ -1339,6 +1689,7 @@ __inline static void AddParticleTrail (part_type_t type, vec3_t start, vec3_t en
 			break;
 		}
 
+		QMB_StoreParticle (pt, p);
 		VectorAdd (point, delta, point);
 	}
 
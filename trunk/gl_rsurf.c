@@ -61,6 +61,7 @@ glpoly_t	*caustics_polys = NULL;
 glpoly_t	*detail_polys = NULL;
 glpoly_t	*outline_polys = NULL;
 
+static qboolean R_ShaderDlights (void);
 float GL_WaterAlphaForEntitySurface(entity_t *ent, msurface_t *s);
 void DrawWaterPoly(glpoly_t *p);
 byte *SV_FatPVS(vec3_t org, model_t *worldmodel);
@@ -193,17 +194,16 @@ typedef struct dlightinfo_s
 	int	type;
 } dlightinfo_t;
 
-static dlightinfo_t dlightlist[MAX_DLIGHTS];
-static int	numdlights;
-
 /*
 ===============
 R_BuildDlightList
+
+Fills list with the lights that reach surf, returns how many
 ===============
 */
-void R_BuildDlightList (msurface_t *surf)
+int R_BuildDlightList (msurface_t *surf, dlightinfo_t *list)
 {
-	int			lnum, i, smax, tmax, irad, iminlight, local[2], tdmin, sdmin, distmin;
+	int			lnum, i, smax, tmax, irad, iminlight, local[2], tdmin, sdmin, distmin, numdlights;
 	float		dist;
 	vec3_t		impact;
 	mtexinfo_t	*tex;
@@ -264,7 +264,7 @@ void R_BuildDlightList (msurface_t *surf)
 		if (distmin < iminlight)
 		{
 			// save dlight info
-			light = &dlightlist[numdlights];
+			light = &list[numdlights];
 			light->minlight = iminlight;
 			light->rad = irad;
 			light->local[0] = local[0];
@@ -273,6 +273,8 @@ void R_BuildDlightList (msurface_t *surf)
 			numdlights++;
 		}
 	}
+
+	return numdlights;
 }
 
 int dlightcolor[NUM_DLIGHTTYPES][3] = {
@@ -290,19 +292,18 @@ int dlightcolor[NUM_DLIGHTTYPES][3] = {
 ===============
 R_AddDynamicLights
 
-NOTE: R_BuildDlightList must be called first!
+Adds the lights found by R_BuildDlightList to blocklights
 ===============
 */
-void R_AddDynamicLights (msurface_t *surf)
+void R_AddDynamicLights (msurface_t *surf, unsigned *blocklights, dlightinfo_t *dlights, int numdlights)
 {
-	int			i, j, smax, tmax, s, t, sd, td, _sd, _td, irad, idist, iminlight, color[3], tmp;
-	unsigned	*dest;
+	int			i, j, smax, tmax, color[3];
 	dlightinfo_t *light;
 
 	smax = (surf->extents[0] >> 4) + 1;
 	tmax = (surf->extents[1] >> 4) + 1;
 
-	for (i = 0, light = dlightlist ; i < numdlights ; i++, light++)
+	for (i = 0, light = dlights ; i < numdlights ; i++, light++)
 	{
 		for (j = 0 ; j < 3 ; j++)
 		{
@@ -312,34 +313,7 @@ void R_AddDynamicLights (msurface_t *surf)
 				color[j] = dlightcolor[light->type][j];
 		}
 
-		irad = light->rad;
-		iminlight = light->minlight;
-
-		_td = light->local[1];
-		dest = blocklights;
-		for (t = 0 ; t < tmax ; t++)
-		{
-			td = _td;
-			if (td < 0)
-				td = -td;
-			_td -= 16;
-			_sd = light->local[0];
-
-			for (s = 0 ; s < smax ; s++)
-			{
-				sd = _sd < 0 ? -_sd : _sd;
-				_sd -= 16;
-				idist = (sd > td) ? (sd << 8) + (td << 7) : (td << 8) + (sd << 7);
-				if (idist < iminlight)
-				{
-					tmp = (irad - idist) >> 7;
-					dest[0] += tmp * color[0];
-					dest[1] += tmp * color[1];
-					dest[2] += tmp * color[2];
-				}
-				dest += 3;
-			}
-		}
+		lightkernels->adddlight (blocklights, smax, tmax, light->local[0], light->local[1], light->rad, light->minlight, color);
 	}
 }
 
@@ -347,16 +321,18 @@ void R_AddDynamicLights (msurface_t *surf)
 ===============
 R_BuildLightMap
 
-Combine and scale multiple lightmaps into the 8.8 format in blocklights
+Combine and scale multiple lightmaps into the 8.8 format in blocklights,
+which must hold the whole surface.  Touches nothing but the surface and its
+lightmap block, so different surfaces can be built on different threads.
 ===============
 */
-void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
+void R_BuildLightMap (msurface_t *surf, byte *dest, int stride, unsigned *blocklights, dlightinfo_t *dlights, int numdlights)
 {
-	int			smax, tmax, i, j, size, maps, r, g, b, blocksize;
+	int			smax, tmax, i, size, maps, blocksize, shift, maxvalue;
 	byte		*lightmap;
 	unsigned	scale, *bl, ambient_light;
 
-	surf->cached_dlight = (surf->dlightframe == r_framecount);
+	surf->cached_dlight = (surf->dlightframe == r_framecount && numdlights);
 
 	smax = (surf->extents[0] >> 4) + 1;
 	tmax = (surf->extents[1] >> 4) + 1;
@@ -366,18 +342,11 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 
 	if (cl.worldmodel->lightdata)
 	{
-		// clear to no light
-		memset(&blocklights[0], 0, size * 3 * sizeof(unsigned int)); //johnfitz -- lit support via lordhavoc
-
 		// clear to ambient
 		bl = blocklights;
 		ambient_light = (unsigned int)(max(0, r_ambient.value)) << 8;
-		for (i = 0; i < size; i++)
-		{
+		for (i = 0; i < blocksize; i++)
 			*bl++ = ambient_light;
-			*bl++ = ambient_light;
-			*bl++ = ambient_light;
-		}
 
 		// add all the lightmaps
 		if (lightmap)
@@ -387,118 +356,150 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 			{
 				scale = d_lightstylevalue[surf->styles[maps]];
 				surf->cached_light[maps] = scale;	// 8.8 fraction
-				//johnfitz -- lit support via lordhavoc
-				bl = blocklights;
-				for (i = 0; i < size; i++)
-				{
-					*bl++ += *lightmap++ * scale;
-					*bl++ += *lightmap++ * scale;
-					*bl++ += *lightmap++ * scale;
-				}
-				//johnfitz
+				lightkernels->addlightmap (blocklights, lightmap, scale, blocksize);	//johnfitz -- lit support via lordhavoc
+				lightmap += blocksize;
 			}
 		}
 
 		// add all the dynamic lights
 		if (surf->dlightframe == r_framecount)
-			R_AddDynamicLights(surf);
+			R_AddDynamicLights(surf, blocklights, dlights, numdlights);
 	}
 	else
 	{
 		// set to full bright if no light data
-		memset(&blocklights[0], 255, size * 3 * sizeof(unsigned int)); //johnfitz -- lit support via lordhavoc
+		memset(&blocklights[0], 255, blocksize * sizeof(unsigned int)); //johnfitz -- lit support via lordhavoc
 	}
 
-	// bound, invert, and shift
-	switch (gl_lightmap_format)
+	if (gl_lightmap_format != GL_RGBA && gl_lightmap_format != GL_BGRA)
+		Sys_Error("R_BuildLightMap: bad lightmap format");
+
+	// bound, invert, and shift; gl_overbright 0 is clamped to 255 so that
+	// it renders as expected in the gl_packed_pixels case too
+	shift = gl_overbright.value ? 8 : 7;
+	maxvalue = (gl_overbright.value && gl_packed_pixels) ? 1023 : 255;
+	lightkernels->packlightmap (dest, stride, blocklights, smax, tmax, shift, maxvalue, gl_lightmap_format == GL_BGRA, gl_packed_pixels);
+}
+
+/*
+=============================================================
+
+Lightmap rebuilds are queued by R_RenderDynamicLightmaps together with the
+lights that reach each surface, and built all at once by R_UploadLightmaps.
+Surfaces never share lightmap texels, so the queue is split across the task
+workers, each with its own blocklights.
+
+=============================================================
+*/
+
+#define	MAX_LIGHTMAP_TASKS			16
+#define	MIN_LIGHTMAPS_PER_TASK		16
+
+typedef struct
+{
+	msurface_t	*surf;
+	int			firstdlight, numdlights;
+} queuedlightmap_t;
+
+typedef struct
+{
+	task_t		*task;
+	int			first, step;
+	unsigned	*blocklights;
+	int			blocklights_size;
+} lightmaptask_t;
+
+static queuedlightmap_t	*queued_lightmaps;
+static int				num_queued_lightmaps, max_queued_lightmaps;
+static dlightinfo_t		*queued_dlights;
+static int				num_queued_dlights, max_queued_dlights;
+static int				queued_blocklights_size;		// of the largest queued surface
+
+static lightmaptask_t	lightmaptasks[MAX_LIGHTMAP_TASKS];
+
+static void R_QueueLightMap (msurface_t *surf, int numdlights, int blocksize)
+{
+	queuedlightmap_t	*queued;
+
+	if (num_queued_lightmaps == max_queued_lightmaps)
 	{
-	case GL_RGBA:
-		stride -= smax * 4;
-		bl = blocklights;
-		for (i = 0; i < tmax; i++, dest += stride)
-		{
-			for (j = 0; j < smax; j++)
-			{
-				if (gl_overbright.value)
-				{
-					r = *bl++ >> 8;
-					g = *bl++ >> 8;
-					b = *bl++ >> 8;
-				}
-				else
-				{
-					r = *bl++ >> 7;
-					g = *bl++ >> 7;
-					b = *bl++ >> 7;
-
-					// artifically clamp to 255 so gl_overbright 0 renders as expected in the gl_packed_pixels case
-					r = (r > 255) ? 255 : r;
-					g = (g > 255) ? 255 : g;
-					b = (b > 255) ? 255 : b;
-				}
-				if (gl_packed_pixels)
-				{
-					r = (r > 1023) ? 1023 : r;
-					g = (g > 1023) ? 1023 : g;
-					b = (b > 1023) ? 1023 : b;
-					*(unsigned int*)dest = (r << 22) | (g << 12) | (b << 2) | 3;
-					dest += 4;
-				}
-				else
-				{
-					*dest++ = (r > 255) ? 255 : r;
-					*dest++ = (g > 255) ? 255 : g;
-					*dest++ = (b > 255) ? 255 : b;
-					*dest++ = 255;
-				}
-			}
-		}
-		break;
-	case GL_BGRA:
-		stride -= smax * 4;
-		bl = blocklights;
-		for (i = 0; i < tmax; i++, dest += stride)
+		max_queued_lightmaps = max(256, max_queued_lightmaps * 2);
+		queued_lightmaps = Q_realloc (queued_lightmaps, max_queued_lightmaps * sizeof(*queued_lightmaps));
+	}
+
+	queued = &queued_lightmaps[num_queued_lightmaps++];
+	queued->surf = surf;
+	queued->firstdlight = num_queued_dlights;
+	queued->numdlights = numdlights;
+	num_queued_dlights += numdlights;
+
+	queued_blocklights_size = max(queued_blocklights_size, blocksize);
+}
+
+// builds every step'th queued lightmap starting with first
+static void R_BuildQueuedLightMaps (int first, int step, unsigned *blocklights)
+{
+	int					i;
+	byte				*base;
+	msurface_t			*fa;
+	queuedlightmap_t	*queued;
+
+	for (i = first ; i < num_queued_lightmaps ; i += step)
+	{
+		queued = &queued_lightmaps[i];
+		fa = queued->surf;
+		base = lightmaps[fa->lightmaptexturenum].data;
+		base += fa->light_t * LMBLOCK_WIDTH * lightmap_bytes + fa->light_s * lightmap_bytes;
+		R_BuildLightMap (fa, base, LMBLOCK_WIDTH * lightmap_bytes, blocklights, queued_dlights + queued->firstdlight, queued->numdlights);
+	}
+}
+
+static void R_LightMapTask (void *data)
+{
+	lightmaptask_t	*t = (lightmaptask_t *)data;
+
+	R_BuildQueuedLightMaps (t->first, t->step, t->blocklights);
+}
+
+/*
+===============
+R_FlushLightMaps
+
+Builds the queued lightmaps, using the task workers for big queues
+===============
+*/
+static void R_FlushLightMaps (void)
+{
+	int				i, numtasks;
+	lightmaptask_t	*t;
+
+	if (!num_queued_lightmaps)
+		return;
+
+	numtasks = min(Tasks_NumWorkers(), MAX_LIGHTMAP_TASKS);
+	numtasks = bound(0, num_queued_lightmaps / MIN_LIGHTMAPS_PER_TASK - 1, numtasks);
+
+	for (i = 0, t = lightmaptasks ; i < numtasks ; i++, t++)
+	{
+		if (t->blocklights_size < queued_blocklights_size)
 		{
-			for (j = 0; j < smax; j++)
-			{
-				if (gl_overbright.value)
-				{
-					r = *bl++ >> 8;
-					g = *bl++ >> 8;
-					b = *bl++ >> 8;
-				}
-				else
-				{
-					r = *bl++ >> 7;
-					g = *bl++ >> 7;
-					b = *bl++ >> 7;
-
-					// artifically clamp to 255 so gl_overbright 0 renders as expected in the gl_packed_pixels case
-					r = (r > 255) ? 255 : r;
-					g = (g > 255) ? 255 : g;
-					b = (b > 255) ? 255 : b;
-				}
-				if (gl_packed_pixels)
-				{
-					r = (r > 1023) ? 1023 : r;
-					g = (g > 1023) ? 1023 : g;
-					b = (b > 1023) ? 1023 : b;
-					*(unsigned int*)dest = (b << 22) | (g << 12) | (r << 2) | 3;
-					dest += 4;
-				}
-				else
-				{
-					*dest++ = (b > 255) ? 255 : b;
-					*dest++ = (g > 255) ? 255 : g;
-					*dest++ = (r > 255) ? 255 : r;
-					*dest++ = 255;
-				}
-			}
+			t->blocklights_size = queued_blocklights_size;
+			t->blocklights = Q_realloc (t->blocklights, t->blocklights_size * sizeof(unsigned));
 		}
-		break;
-	default:
-		Sys_Error("R_BuildLightMap: bad lightmap format");
+		t->first = i + 1;
+		t->step = numtasks + 1;
+		t->task = Task_Submit (R_LightMapTask, t);
 	}
+
+	// the main thread takes a share too
+	R_BuildQueuedLightMaps (0, numtasks + 1, blocklights);
+
+	for (i = 0 ; i < numtasks ; i++)
+		Task_Wait (lightmaptasks[i].task);
+
+	num_queued_lightmaps = 0;
+	num_queued_dlights = 0;
+	queued_blocklights_size = 0;
 }
 
 /*
@@ -530,6 +531,8 @@ void R_UploadLightmaps(void)
 {
 	int lmap;
 
+	R_FlushLightMaps ();
+
 	for (lmap = 0; lmap < lightmap_count; lmap++)
 	{
 		if (!lightmaps[lmap].modified)
@@ -568,7 +571,7 @@ void R_RebuildAllLightmaps (void)
 				continue;
 			base = lightmaps[fa->lightmaptexturenum].data;
 			base += fa->light_t * LMBLOCK_WIDTH * lightmap_bytes + fa->light_s * lightmap_bytes;
-			R_BuildLightMap (fa, base, LMBLOCK_WIDTH*lightmap_bytes);
+			R_BuildLightMap (fa, base, LMBLOCK_WIDTH*lightmap_bytes, blocklights, NULL, 0);
 		}
 	}
 
@@ -757,8 +760,7 @@ R_RenderDynamicLightmaps
 */
 void R_RenderDynamicLightmaps (msurface_t *fa, texchain_t chain)
 {
-	int			maps, smax, tmax;
-	byte		*base;
+	int			maps, smax, tmax, numdlights;
 	glRect_t	*theRect;
 	qboolean	lightstyle_modified = false;
 	struct lightmap_s *lm;
@@ -785,10 +787,21 @@ void R_RenderDynamicLightmaps (msurface_t *fa, texchain_t chain)
 		}
 	}
 
-	if (fa->dlightframe == r_framecount)
-		R_BuildDlightList (fa);
+	// with r_dynamic_glsl the dlights are added by the world shader and only
+	// lightstyles, and clearing dlights baked in before, need a rebuild
+	if (fa->dlightframe == r_framecount && !R_ShaderDlights())
+	{
+		if (num_queued_dlights + MAX_DLIGHTS > max_queued_dlights)
+		{
+			max_queued_dlights = max(1024, max_queued_dlights * 2);
+			queued_dlights = Q_realloc (queued_dlights, max_queued_dlights * sizeof(*queued_dlights));
+		}
+		numdlights = R_BuildDlightList (fa, queued_dlights + num_queued_dlights);
+	}
 	else
+	{
 		numdlights = 0;
+	}
 
 	if (numdlights == 0 && !fa->cached_dlight && !lightstyle_modified)
 		return;
@@ -814,9 +827,7 @@ void R_RenderDynamicLightmaps (msurface_t *fa, texchain_t chain)
 		theRect->w = fa->light_s - theRect->l + smax;
 	if (theRect->h + theRect->t < fa->light_t + tmax)
 		theRect->h = fa->light_t - theRect->t + tmax;
-	base = lm->data;
-	base += fa->light_t * LMBLOCK_WIDTH * lightmap_bytes + fa->light_s * lightmap_bytes;
-	R_BuildLightMap(fa, base, LMBLOCK_WIDTH * lightmap_bytes);
+	R_QueueLightMap (fa, numdlights, smax * tmax * 3);
 }
 
 static void R_ClearTextureChains (model_t *mod, texchain_t chain)
@@ -870,6 +881,306 @@ qboolean R_BackFaceCull(msurface_t *surf)
 	return false;
 }
 
+/*
+================
+R_BackFaceCullMargin
+
+Like R_BackFaceCull seen from origin, but only culls surfaces that are
+more than margin units behind it.
+================
+*/
+static qboolean R_BackFaceCullMargin(msurface_t *surf, vec3_t origin, float margin)
+{
+	double dot;
+
+	if (surf->plane->type < 3)
+		dot = origin[surf->plane->type] - surf->plane->dist;
+	else
+		dot = DotProduct(origin, surf->plane->normal) - surf->plane->dist;
+
+	if (surf->flags & SURF_PLANEBACK)
+		return dot >= margin;
+
+	return dot < -margin;
+}
+
+/*
+=============================================================
+
+Render lists
+
+The world is drawn from a render list: the leafs in the PVS that survive
+culling and the surfaces in them. Lists are culled against a frustum
+MARK_FOV degrees wider on each side and backed off from the view, with
+backface culling MARK_MOVE units lenient. While the view stays in the
+same leaf and its real frustum still fits inside the wide one, the list
+is a superset of the visible surfaces and only the chains are rebuilt.
+
+There are two lists. R_MarkSurfaces draws from r_renderlist and, when
+the view has moved since it was built, has a worker build r_backlist
+around the current view while the main thread draws the frame.
+R_FinishRenderList swaps them at the end of the frame, so the next
+frame usually finds a list that fits without walking the PVS itself.
+
+Building a list only reads the world model and the copies of the view
+and the PVS taken by R_SetupRenderList, so it is safe on a worker.
+
+=============================================================
+*/
+
+#define MARK_FOV	10		// degrees added to each side of the frustum
+#define MARK_MOVE	16		// units the view may move
+
+typedef struct
+{
+	qboolean	valid;			// built with the wide frustum, may be reused
+	model_t		*model;
+	mleaf_t		*viewleaf;
+	float		novis;
+	vec3_t		origin;
+	mplane_t	viewfrustum[4];
+	mplane_t	frustum[4];
+	float		backface;
+	byte		*vis;
+
+	mleaf_t		**leafs;
+	int			numleafs;
+	msurface_t	**surfs;
+	int			numsurfs;
+	byte		*surfmarks;		// so surfaces in several leafs are added once
+
+	int			maxleafs, maxsurfs;	// what the arrays were allocated for
+} renderlist_t;
+
+static renderlist_t	renderlists[2];
+static renderlist_t	*r_renderlist = &renderlists[0];
+static renderlist_t	*r_backlist = &renderlists[1];
+static task_t		*r_renderlist_task;
+
+/*
+===============
+R_FinishRenderList
+
+Waits for the back list and swaps it in if it was built.
+===============
+*/
+void R_FinishRenderList (void)
+{
+	renderlist_t	*temp;
+
+	if (!r_renderlist_task)
+		return;
+
+	Task_Wait (r_renderlist_task);
+	r_renderlist_task = NULL;
+
+	temp = r_renderlist;
+	r_renderlist = r_backlist;
+	r_backlist = temp;
+}
+
+/*
+===============
+R_ClearRenderLists
+===============
+*/
+void R_ClearRenderLists (void)
+{
+	R_FinishRenderList ();
+
+	// the next world may be loaded into the same model_t
+	renderlists[0].valid = renderlists[1].valid = false;
+	renderlists[0].model = renderlists[1].model = NULL;
+	renderlists[0].viewleaf = renderlists[1].viewleaf = NULL;
+}
+
+/*
+===============
+R_SetMarkFrustum
+
+Sets up planes as a widened copy of the view frustum with its apex
+pulled back along vpn. Returns false if it would be too wide to cull.
+===============
+*/
+static qboolean R_SetMarkFrustum (mplane_t *planes)
+{
+	int		i;
+	vec3_t	apex;
+
+	if (r_fovx + 2 * MARK_FOV >= 170 || r_fovy + 2 * MARK_FOV >= 170)
+		return false;
+
+	RotatePointAroundVector (planes[0].normal, vup, vpn, -(90 - (r_fovx / 2 + MARK_FOV)));
+	RotatePointAroundVector (planes[1].normal, vup, vpn, 90 - (r_fovx / 2 + MARK_FOV));
+	RotatePointAroundVector (planes[2].normal, vright, vpn, 90 - (r_fovy / 2 + MARK_FOV));
+	RotatePointAroundVector (planes[3].normal, vright, vpn, -(90 - (r_fovy / 2 + MARK_FOV)));
+
+	VectorMA (r_origin, -4 * MARK_MOVE, vpn, apex);
+	for (i = 0 ; i < 4 ; i++)
+	{
+		planes[i].type = PLANE_ANYZ;
+		planes[i].dist = DotProduct (apex, planes[i].normal);
+		planes[i].signbits = SignbitsForPlane (&planes[i]);
+	}
+
+	return true;
+}
+
+/*
+===============
+R_RenderListFits
+
+A list can be reused if the view hasn't left its leaf or moved further
+than MARK_MOVE (that keeps backface culling exact), and the current
+frustum lies inside the list's one: its apex is inside all four planes
+and so are its four edges.
+===============
+*/
+static qboolean R_RenderListFits (renderlist_t *rl)
+{
+	int			i, j;
+	vec3_t		v, edges[4];
+
+	if (!rl->valid || rl->model != cl.worldmodel || rl->viewleaf != r_viewleaf || rl->novis != r_novis.value)
+		return false;
+
+	VectorSubtract (r_origin, rl->origin, v);
+	if (DotProduct(v, v) > MARK_MOVE * MARK_MOVE)
+		return false;
+
+	CrossProduct (frustum[2].normal, frustum[0].normal, edges[0]);
+	CrossProduct (frustum[0].normal, frustum[3].normal, edges[1]);
+	CrossProduct (frustum[3].normal, frustum[1].normal, edges[2]);
+	CrossProduct (frustum[1].normal, frustum[2].normal, edges[3]);
+
+	for (i = 0 ; i < 4 ; i++)
+	{
+		// make the edges point away from the view
+		if (DotProduct(edges[i], vpn) < 0)
+			VectorNegate (edges[i], edges[i]);
+	}
+
+	for (i = 0 ; i < 4 ; i++)
+	{
+		if (DotProduct(r_origin, rl->frustum[i].normal) < rl->frustum[i].dist)
+			return false;
+		for (j = 0 ; j < 4 ; j++)
+			if (DotProduct(edges[j], rl->frustum[i].normal) < 0)
+				return false;
+	}
+
+	return true;
+}
+
+/*
+===============
+R_ViewMoved
+
+Returns true if the view is not the one rl was built for.
+===============
+*/
+static qboolean R_ViewMoved (renderlist_t *rl)
+{
+	int	i;
+
+	if (!VectorCompare(rl->origin, r_origin))
+		return true;
+
+	for (i = 0 ; i < 4 ; i++)
+		if (!VectorCompare(rl->viewfrustum[i].normal, frustum[i].normal))
+			return true;
+
+	return false;
+}
+
+/*
+===============
+R_SetupRenderList
+
+Copies everything R_BuildRenderList needs to know about the current view
+into rl. A wide list culls against the widened frustum and can be reused,
+otherwise the view frustum is used as is.
+===============
+*/
+static void R_SetupRenderList (renderlist_t *rl, byte *vis, qboolean wide)
+{
+	model_t	*model = cl.worldmodel;
+
+	rl->model = model;
+
+	if (model->numleafs > rl->maxleafs)
+	{
+		rl->maxleafs = model->numleafs;
+		rl->vis = Q_realloc (rl->vis, (rl->maxleafs + 7) >> 3);
+		rl->leafs = Q_realloc (rl->leafs, rl->maxleafs * sizeof(*rl->leafs));
+	}
+
+	if (model->numsurfaces > rl->maxsurfs)
+	{
+		rl->maxsurfs = model->numsurfaces;
+		rl->surfs = Q_realloc (rl->surfs, rl->maxsurfs * sizeof(*rl->surfs));
+		rl->surfmarks = Q_realloc (rl->surfmarks, (rl->maxsurfs + 7) >> 3);
+	}
+
+	if (vis != rl->vis)
+		memcpy (rl->vis, vis, (model->numleafs + 7) >> 3);
+
+	rl->viewleaf = r_viewleaf;
+	rl->novis = r_novis.value;
+	VectorCopy (r_origin, rl->origin);
+	memcpy (rl->viewfrustum, frustum, sizeof(rl->viewfrustum));
+
+	rl->valid = wide && R_SetMarkFrustum (rl->frustum);
+	if (!rl->valid)
+		memcpy (rl->frustum, frustum, sizeof(rl->frustum));
+	rl->backface = rl->valid ? MARK_MOVE : 0;
+}
+
+/*
+===============
+R_BuildRenderList
+
+Walks the PVS copied into the list and gathers what survives culling.
+===============
+*/
+static void R_BuildRenderList (void *data)
+{
+	renderlist_t	*rl = (renderlist_t *)data;
+	mleaf_t			*leaf;
+	msurface_t		*surf, **mark;
+	int				i, j, surfnum;
+
+	rl->numleafs = rl->numsurfs = 0;
+	memset (rl->surfmarks, 0, (rl->model->numsurfaces + 7) >> 3);
+
+	leaf = &rl->model->leafs[1];
+	for (i = 0 ; i < rl->model->numleafs ; i++, leaf++)
+	{
+		if (!(rl->vis[i >> 3] & (1 << (i & 7))))
+			continue;
+
+		if (R_CullBoxPlanes(rl->frustum, leaf->minmaxs, leaf->minmaxs + 3))
+			continue;
+
+		rl->leafs[rl->numleafs++] = leaf;
+
+		if (leaf->contents == CONTENTS_SKY)
+			continue;
+
+		for (j = 0, mark = leaf->firstmarksurface ; j < leaf->nummarksurfaces ; j++, mark++)
+		{
+			surf = *mark;
+			surfnum = surf - rl->model->surfaces;
+			if (rl->surfmarks[surfnum >> 3] & (1 << (surfnum & 7)))
+				continue;
+			rl->surfmarks[surfnum >> 3] |= 1 << (surfnum & 7);
+
+			if (!R_CullBoxPlanes(rl->frustum, surf->mins, surf->maxs) && !R_BackFaceCullMargin(surf, rl->origin, rl->backface))
+				rl->surfs[rl->numsurfs++] = surf;
+		}
+	}
+}
+
 /*
 ===============
 R_MarkSurfaces -- johnfitz -- mark surfaces based on PVS and rebuild texture chains
@@ -878,30 +1189,16 @@ R_MarkSurfaces -- johnfitz -- mark surfaces based on PVS and rebuild texture cha
 void R_MarkSurfaces(void)
 {
 	byte		*vis;
-	mleaf_t		*leaf;
 	msurface_t	*surf, **mark;
-	int			i, j;
+	int			i;
 	qboolean	nearwaterportal;
 	
+	R_FinishRenderList ();
+
 	// clear lightmap chains
 	for (i = 0; i < lightmap_count; i++)
 		lightmaps[i].polys = NULL;
 
-	// check this leaf for water portals
-	// TODO: loop through all water surfs and use distance to leaf cullbox
-	nearwaterportal = false;
-	for (i = 0, mark = r_viewleaf->firstmarksurface; i < r_viewleaf->nummarksurfaces; i++, mark++)
-		if ((*mark)->flags & SURF_DRAWTURB)
-			nearwaterportal = true;
-
-	// choose vis data
-	if (r_novis.value || r_viewleaf->contents == CONTENTS_SOLID || r_viewleaf->contents == CONTENTS_SKY)
-		vis = Mod_NoVisPVS(cl.worldmodel);
-	else if (nearwaterportal)
-		vis = SV_FatPVS(r_origin, cl.worldmodel);
-	else
-		vis = Mod_LeafPVS(r_viewleaf, cl.worldmodel);
-
 	r_visframecount++;
 
 	// set all chains to null
@@ -909,37 +1206,49 @@ void R_MarkSurfaces(void)
 		if (cl.worldmodel->textures[i])
 			cl.worldmodel->textures[i]->texturechains[chain_world] = NULL;
 
-	// iterate through leaves, marking surfaces
-	leaf = &cl.worldmodel->leafs[1];
-	for (i = 0; i<cl.worldmodel->numleafs; i++, leaf++)
+	if (!r_markcache.value || !R_RenderListFits(r_renderlist))
 	{
-		if (vis[i >> 3] & (1 << (i & 7)))
-		{
-			if (R_CullBox(leaf->minmaxs, leaf->minmaxs + 3))
-				continue;
+		// check this leaf for water portals
+		// TODO: loop through all water surfs and use distance to leaf cullbox
+		nearwaterportal = false;
+		for (i = 0, mark = r_viewleaf->firstmarksurface; i < r_viewleaf->nummarksurfaces; i++, mark++)
+			if ((*mark)->flags & SURF_DRAWTURB)
+				nearwaterportal = true;
+
+		// choose vis data
+		if (r_novis.value || r_viewleaf->contents == CONTENTS_SOLID || r_viewleaf->contents == CONTENTS_SKY)
+			vis = Mod_NoVisPVS(cl.worldmodel);
+		else if (nearwaterportal)
+			vis = SV_FatPVS(r_origin, cl.worldmodel);
+		else
+			vis = Mod_LeafPVS(r_viewleaf, cl.worldmodel);
 
-			if (leaf->contents != CONTENTS_SKY)
-				for (j = 0, mark = leaf->firstmarksurface; j<leaf->nummarksurfaces; j++, mark++)
-				{
-					surf = *mark;
-					if (surf->visframe != r_visframecount)
-					{
-						surf->visframe = r_visframecount;
-						if (!R_CullBox(surf->mins, surf->maxs) && !R_BackFaceCull(surf))
-						{
-							R_ChainSurface(surf, chain_world);
-							R_RenderDynamicLightmaps(surf, chain_world);
-							if (surf->texinfo->texture->warp_texturenum)
-								surf->texinfo->texture->update_warp = true;
-						}
-					}
-				}
+		// the fat PVS depends on the exact origin, so it can't be reused
+		R_SetupRenderList (r_renderlist, vis, r_markcache.value && !nearwaterportal);
+		R_BuildRenderList (r_renderlist);
+	}
+	else if (Tasks_NumWorkers() > 0 && R_ViewMoved(r_renderlist))
+	{
+		// same leaf, same PVS: build a list centered on this view for the next frame
+		R_SetupRenderList (r_backlist, r_renderlist->vis, true);
+		if (r_backlist->valid)
+			r_renderlist_task = Task_Submit (R_BuildRenderList, r_backlist);
+	}
 
-			// add static models
-			if (leaf->efrags)
-				R_StoreEfrags(&leaf->efrags);
-		}
+	for (i = 0 ; i < r_renderlist->numsurfs ; i++)
+	{
+		surf = r_renderlist->surfs[i];
+		surf->visframe = r_visframecount;
+		R_ChainSurface(surf, chain_world);
+		R_RenderDynamicLightmaps(surf, chain_world);
+		if (surf->texinfo->texture->warp_texturenum)
+			surf->texinfo->texture->update_warp = true;
 	}
+
+	// add static models
+	for (i = 0 ; i < r_renderlist->numleafs ; i++)
+		if (r_renderlist->leafs[i]->efrags)
+			R_StoreEfrags(&r_renderlist->leafs[i]->efrags);
 }
 
 /*
@@ -951,6 +1260,9 @@ VBO support
 */
 
 GLuint gl_bmodel_vbo = 0;
+GLuint gl_bmodel_ibo = 0;
+
+static void R_InitIndexBuffer (void);
 
 void GL_DeleteBModelVertexBuffer(void)
 {
@@ -959,6 +1271,8 @@ void GL_DeleteBModelVertexBuffer(void)
 
 	qglDeleteBuffers(1, &gl_bmodel_vbo);
 	gl_bmodel_vbo = 0;
+	qglDeleteBuffers(1, &gl_bmodel_ibo);
+	gl_bmodel_ibo = 0;
 
 	GL_ClearBufferBindings();
 }
@@ -968,7 +1282,7 @@ void GL_DeleteBModelVertexBuffer(void)
 GL_BuildBModelVertexBuffer
 
 Deletes gl_bmodel_vbo if it already exists, then rebuilds it with all
-surfaces from world + all brush models
+surfaces from world + all brush models. Also resets gl_bmodel_ibo.
 ==================
 */
 void GL_BuildBModelVertexBuffer(void)
@@ -1024,6 +1338,9 @@ void GL_BuildBModelVertexBuffer(void)
 	qglBufferData(GL_ARRAY_BUFFER, varray_bytes, varray, GL_STATIC_DRAW);
 	free(varray);
 
+	// the batch indices are streamed separately, see R_StreamBatch
+	R_InitIndexBuffer ();
+
 	// invalidate the cached bindings
 	GL_ClearBufferBindings();
 }
@@ -1052,10 +1369,202 @@ static void R_TriangleIndicesForSurf(msurface_t *s, unsigned int *dest)
 	}
 }
 
-#define MAX_BATCH_SIZE 4096
+/*
+=============================================================
+
+Index streaming
+
+Batch indices live in gl_bmodel_ibo, which is filled front to back and
+orphaned when it runs out of room. Every batch drawn remembers its list of
+surfaces and where its indices went, so when the next frame draws the same
+surfaces in the same order the indices are reused instead of rebuilt and
+uploaded again. Orphaning the buffer bumps ibo_generation, which throws
+away everything remembered so far.
+
+=============================================================
+*/
+
+#define MAX_BATCH_SIZE		4096
+#define INDEX_BUFFER_SIZE	(256 * MAX_BATCH_SIZE)	// in indices, 4 MB
+#define BATCH_HASH_SIZE		1024
+
+static int	ibo_offset;			// first free index in gl_bmodel_ibo
+static int	ibo_generation;
+
+typedef struct
+{
+	int		firstsurf, numsurfs;	// in the surfs list of the frame that drew it
+	int		offset;					// in gl_bmodel_ibo
+	int		generation;
+	int		hashnext;
+} cachedbatch_t;
+
+typedef struct
+{
+	int				framecount;
+	msurface_t		**surfs;
+	int				numsurfs, maxsurfs;
+	cachedbatch_t	*batches;
+	int				numbatches, maxbatches;
+	int				hash[BATCH_HASH_SIZE];
+} batchframe_t;
+
+static batchframe_t	batchframes[2];
+static batchframe_t	*curbatches = &batchframes[0], *prevbatches = &batchframes[1];
 
 static unsigned int vbo_indices[MAX_BATCH_SIZE];
 static unsigned int num_vbo_indices;
+static int	batch_firstsurf;		// first surface of the open batch in curbatches->surfs
+
+static int R_BatchHash (msurface_t **surfs, int numsurfs)
+{
+	return (surfs[0]->vbo_firstvert * 31 + numsurfs) & (BATCH_HASH_SIZE - 1);
+}
+
+/*
+================
+R_ResetIndexBuffer
+
+Orphans gl_bmodel_ibo so the driver can hand out fresh storage while the
+GPU is still reading the old one. The element buffer must be bound.
+================
+*/
+static void R_ResetIndexBuffer (void)
+{
+	qglBufferData(GL_ELEMENT_ARRAY_BUFFER, INDEX_BUFFER_SIZE * sizeof(unsigned int), NULL, GL_STREAM_DRAW);
+	ibo_offset = 0;
+	ibo_generation++;
+}
+
+/*
+================
+R_InitIndexBuffer
+
+(Re)creates gl_bmodel_ibo and forgets every cached batch, as the surfaces
+they point at may be gone.
+================
+*/
+static void R_InitIndexBuffer (void)
+{
+	int	i;
+
+	qglDeleteBuffers(1, &gl_bmodel_ibo);
+	qglGenBuffers(1, &gl_bmodel_ibo);
+	qglBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gl_bmodel_ibo);
+	R_ResetIndexBuffer ();
+
+	for (i = 0 ; i < 2 ; i++)
+	{
+		batchframes[i].framecount = -1;
+		batchframes[i].numsurfs = 0;
+		batchframes[i].numbatches = 0;
+		memset(batchframes[i].hash, -1, sizeof(batchframes[i].hash));
+	}
+}
+
+/*
+================
+R_FindCachedBatch
+
+Looks for the surfaces of the open batch among the ones drawn last frame.
+================
+*/
+static cachedbatch_t *R_FindCachedBatch (msurface_t **surfs, int numsurfs)
+{
+	int				i;
+	cachedbatch_t	*batch;
+
+	for (i = prevbatches->hash[R_BatchHash(surfs, numsurfs)] ; i >= 0 ; i = batch->hashnext)
+	{
+		batch = &prevbatches->batches[i];
+		if (batch->generation == ibo_generation && batch->numsurfs == numsurfs &&
+			!memcmp(&prevbatches->surfs[batch->firstsurf], surfs, numsurfs * sizeof(*surfs)))
+			return batch;
+	}
+
+	return NULL;
+}
+
+/*
+================
+R_StreamBatch
+
+Returns the offset in gl_bmodel_ibo of the indices for the open batch,
+uploading them if last frame didn't leave them there already.
+================
+*/
+static int R_StreamBatch (void)
+{
+	int				i, hash, numsurfs;
+	msurface_t		**surfs;
+	unsigned int	*dest;
+	cachedbatch_t	*batch, *cached;
+
+	surfs = &curbatches->surfs[batch_firstsurf];
+	numsurfs = curbatches->numsurfs - batch_firstsurf;
+
+	if (curbatches->numbatches == curbatches->maxbatches)
+	{
+		curbatches->maxbatches = max(256, curbatches->maxbatches * 2);
+		curbatches->batches = Q_realloc (curbatches->batches, curbatches->maxbatches * sizeof(*curbatches->batches));
+	}
+
+	hash = R_BatchHash(surfs, numsurfs);
+	batch = &curbatches->batches[curbatches->numbatches];
+	batch->firstsurf = batch_firstsurf;
+	batch->numsurfs = numsurfs;
+	batch->hashnext = curbatches->hash[hash];
+	curbatches->hash[hash] = curbatches->numbatches++;
+
+	if ((cached = R_FindCachedBatch(surfs, numsurfs)))
+	{
+		batch->offset = cached->offset;
+		batch->generation = cached->generation;
+		return batch->offset;
+	}
+
+	if (ibo_offset + num_vbo_indices > INDEX_BUFFER_SIZE)
+		R_ResetIndexBuffer ();
+
+	for (i = 0, dest = vbo_indices ; i < numsurfs ; i++)
+	{
+		R_TriangleIndicesForSurf(surfs[i], dest);
+		dest += R_NumTriangleIndicesForSurf(surfs[i]);
+	}
+	qglBufferSubData(GL_ELEMENT_ARRAY_BUFFER, ibo_offset * sizeof(unsigned int), num_vbo_indices * sizeof(unsigned int), vbo_indices);
+
+	batch->offset = ibo_offset;
+	batch->generation = ibo_generation;
+	ibo_offset += num_vbo_indices;
+
+	return batch->offset;
+}
+
+/*
+================
+R_StartBatch
+
+Swaps the batch lists when a new frame starts and opens an empty batch.
+================
+*/
+static void R_StartBatch (void)
+{
+	batchframe_t	*temp;
+
+	if (curbatches->framecount != r_framecount)
+	{
+		temp = prevbatches;
+		prevbatches = curbatches;
+		curbatches = temp;
+
+		curbatches->framecount = r_framecount;
+		curbatches->numsurfs = 0;
+		curbatches->numbatches = 0;
+		memset(curbatches->hash, -1, sizeof(curbatches->hash));
+	}
+
+	batch_firstsurf = curbatches->numsurfs;
+}
 
 /*
 ================
@@ -1064,6 +1573,8 @@ R_ClearBatch
 */
 static void R_ClearBatch()
 {
+	if (num_vbo_indices > 0)
+		curbatches->numsurfs = batch_firstsurf;
 	num_vbo_indices = 0;
 }
 
@@ -1085,6 +1596,8 @@ Draw the current batch if non-empty and clears it, ready for more R_BatchSurface
 */
 static void R_FlushBatch(surfacetype surftype)
 {
+	int	offset;
+
 	if (num_vbo_indices > 0)
 	{
 		if (surftype == UNDER_WATER && gl_caustics.value && underwatertexture)
@@ -1105,7 +1618,8 @@ static void R_FlushBatch(surfacetype surftype)
 		else
 			qglUniform1i(useDetailTexLoc, 0);
 
-		glDrawElements(GL_TRIANGLES, num_vbo_indices, GL_UNSIGNED_INT, vbo_indices);
+		offset = R_StreamBatch();
+		glDrawElements(GL_TRIANGLES, num_vbo_indices, GL_UNSIGNED_INT, (void *)(intptr_t)(offset * sizeof(unsigned int)));
 		num_vbo_indices = 0;
 	}
 }
@@ -1114,8 +1628,8 @@ static void R_FlushBatch(surfacetype surftype)
 ================
 R_BatchSurface
 
-Add the surface to the current batch, or just draw it immediately if we're not
-using VBOs.
+Add the surface to the current batch. Its indices are only written out when
+the batch is flushed, and only if last frame didn't already upload them.
 ================
 */
 static void R_BatchSurface(msurface_t *s, surfacetype surftype)
@@ -1127,7 +1641,16 @@ static void R_BatchSurface(msurface_t *s, surfacetype surftype)
 	if (num_vbo_indices + num_surf_indices > MAX_BATCH_SIZE)
 		R_FlushBatch(surftype);
 
-	R_TriangleIndicesForSurf(s, &vbo_indices[num_vbo_indices]);
+	if (num_vbo_indices == 0)
+		R_StartBatch();
+
+	if (curbatches->numsurfs == curbatches->maxsurfs)
+	{
+		curbatches->maxsurfs = max(1024, curbatches->maxsurfs * 2);
+		curbatches->surfs = Q_realloc (curbatches->surfs, curbatches->maxsurfs * sizeof(*curbatches->surfs));
+	}
+
+	curbatches->surfs[curbatches->numsurfs++] = s;
 	num_vbo_indices += num_surf_indices;
 }
 
@@ -1150,6 +1673,14 @@ static GLuint useWaterFogLoc;
 static GLuint alphaLoc;
 static GLuint clTimeLoc;
 static GLuint turbsinLoc;
+static GLint  numDlightsLoc;
+static GLint  dlightOriginLoc;
+static GLint  dlightColorLoc;
+static GLint  maxLightLoc;
+
+// dlights handed to the world shader, all of them fit a GL 3.0 minimum of
+// uniform space next to turbsin
+#define	MAX_SHADER_DLIGHTS	32
 
 #define vertAttrIndex 0
 #define texCoordsAttrIndex 1
@@ -1181,9 +1712,11 @@ void GLWorld_CreateShaders(void)
 		"attribute vec2 DetailCoords;\n"
 		"\n"
 		"varying float FogFragCoord;\n"
+		"varying vec3 ModelPos;\n"
 		"\n"
 		"void main()\n"
 		"{\n"
+		"	ModelPos = Vert;\n"
 		"	gl_TexCoord[0] = vec4(TexCoords, 0.0, 0.0);\n"
 		"	gl_TexCoord[1] = vec4(LMCoords, 0.0, 0.0);\n"
 		"	gl_TexCoord[2] = vec4(DetailCoords.xy, 0.0, 0.0);\n"
@@ -1197,6 +1730,7 @@ void GLWorld_CreateShaders(void)
 		"#define M_PI			3.1415926535897932384626433832795\n"
 		"#define TURBSINSIZE	" TOSTRING(TURBSINSIZE) "\n"
 		"#define TURBSCALE		(float(TURBSINSIZE) / (2.0 * M_PI))\n"
+		"#define MAX_SHADER_DLIGHTS	" TOSTRING(MAX_SHADER_DLIGHTS) "\n"
 		"\n"
 		"uniform sampler2D Tex;\n"
 		"uniform sampler2D LMTex;\n"
@@ -1214,8 +1748,13 @@ void GLWorld_CreateShaders(void)
 		"uniform float Alpha;\n"
 		"uniform float ClTime;\n"
 		"uniform int turbsin[TURBSINSIZE];\n"
+		"uniform int NumDlights;\n"
+		"uniform vec4 DlightOrigin[MAX_SHADER_DLIGHTS];\n"	// xyz in model space, radius
+		"uniform vec4 DlightColor[MAX_SHADER_DLIGHTS];\n"	// rgb scaled to lightmap units, minlight
+		"uniform float MaxLight;\n"
 		"\n"
 		"varying float FogFragCoord;\n"
+		"varying vec3 ModelPos;\n"
 		"\n"
 		"\n"
 		"float SINTABLE_APPROX(float time)\n"	// caustics effect generation
@@ -1231,6 +1770,22 @@ void GLWorld_CreateShaders(void)
 		"	lerp = turbsin[sinlerp1 & (TURBSINSIZE - 1)] * (1 - lerptime) + turbsin[sinlerp2 & (TURBSINSIZE - 1)] * lerptime;\n"
 		"	return -8.0 + 16.0 * lerp / 255.0;\n"
 		"}\n"
+		"vec3 DynamicLight()\n"	// the falloff R_AddDynamicLights bakes in, per fragment
+		"{\n"
+		"	vec3 normal = normalize(cross(dFdx(ModelPos), dFdy(ModelPos)));\n"
+		"	vec3 light = vec3(0.0);\n"
+		"	for (int i = 0; i < NumDlights; i++)\n"
+		"	{\n"
+		"		vec3 d = DlightOrigin[i].xyz - ModelPos;\n"
+		"		float dist = dot(d, normal);\n"
+		"		float rad = DlightOrigin[i].w - abs(dist);\n"
+		"		float falloff = rad - length(d - normal * dist);\n"
+		"		if (falloff > DlightColor[i].w)\n"
+		"			light += falloff * DlightColor[i].rgb;\n"
+		"	}\n"
+		"	return light;\n"
+		"}\n"
+		"\n"
 		"void main()\n"
 		"{\n"
 		"	vec4 result = texture2D(Tex, gl_TexCoord[0].xy);\n"
@@ -1238,11 +1793,14 @@ void GLWorld_CreateShaders(void)
 		"		result = vec4(0.5, 0.5, 0.5, 1.0);\n"
 		"	if (UseAlphaTest && (result.a < 0.666))\n"
 		"		discard;\n"
-		"	result *= texture2D(LMTex, gl_TexCoord[1].xy);\n"
+		"	vec4 lightmap = texture2D(LMTex, gl_TexCoord[1].xy);\n"
 		"	if (UsePackedPixels)\n"
-		"	    result.rgb *= 4.0;\n"
+		"	    lightmap.rgb *= 4.0;\n"
 		"	if (UseOverbright)\n"
-		"		result.rgb *= 2.0;\n"
+		"		lightmap.rgb *= 2.0;\n"
+		"	if (NumDlights > 0)\n"
+		"		lightmap.rgb = min(lightmap.rgb + DynamicLight(), MaxLight);\n"
+		"	result *= lightmap;\n"
 		"	vec4 fb = texture2D(FullbrightTex, gl_TexCoord[0].xy);\n"
 		"	if (UseFullbrightTex == 1)\n"
 		"		result = mix(result, fb, fb.a);\n"
@@ -1300,7 +1858,78 @@ void GLWorld_CreateShaders(void)
 		alphaLoc = GL_GetUniformLocation(&r_world_program, "Alpha");
 		clTimeLoc = GL_GetUniformLocation(&r_world_program, "ClTime");
 		turbsinLoc = GL_GetUniformLocation(&r_world_program, "turbsin");
+		numDlightsLoc = GL_GetUniformLocation(&r_world_program, "NumDlights");
+		dlightOriginLoc = GL_GetUniformLocation(&r_world_program, "DlightOrigin");
+		dlightColorLoc = GL_GetUniformLocation(&r_world_program, "DlightColor");
+		maxLightLoc = GL_GetUniformLocation(&r_world_program, "MaxLight");
+	}
+}
+
+static qboolean R_ShaderDlights (void)
+{
+	return r_dynamic_glsl.value && r_dynamic.value && r_world_program;
+}
+
+/*
+================
+R_SetupShaderDlights
+
+Hands the live dlights to the world shader, moved into the space of ent
+================
+*/
+static void R_SetupShaderDlights (entity_t *ent)
+{
+	int			i, j, numdlights, color;
+	float		scale, maxlight;
+	vec3_t		org, forward, right, up;
+	dlight_t	*dl;
+	static	float	origins[MAX_SHADER_DLIGHTS*4], colors[MAX_SHADER_DLIGHTS*4];
+
+	numdlights = 0;
+	if (R_ShaderDlights())
+	{
+		scale = ENTSCALE_DECODE(ent->scale);
+		if (!scale)
+			scale = 1;
+		AngleVectors (ent->angles, forward, right, up);
+
+		for (i = 0, dl = cl_dlights ; i < MAX_DLIGHTS && numdlights < MAX_SHADER_DLIGHTS ; i++, dl++)
+		{
+			if (dl->die < cl.time || !dl->radius)
+				continue;
+
+			VectorSubtract (dl->origin, ent->origin, org);
+			origins[numdlights*4+0] = DotProduct(org, forward) / scale;
+			origins[numdlights*4+1] = -DotProduct(org, right) / scale;
+			origins[numdlights*4+2] = DotProduct(org, up) / scale;
+			origins[numdlights*4+3] = dl->radius / scale;
+
+			// R_AddDynamicLights adds ((irad - idist) >> 7) * color to 8.8
+			// blocklights, which pack to lightmap units at >> 7 and / 255;
+			// irad and idist are 256 times the distances
+			for (j = 0 ; j < 3 ; j++)
+			{
+				if (dl->type == lt_explosion2 || dl->type == lt_explosion3)
+					color = (int)(ExploColor[j] * 255);
+				else
+					color = dlightcolor[dl->type][j];
+				colors[numdlights*4+j] = color * 2.0f / (128 * 255) * scale;
+			}
+			colors[numdlights*4+3] = dl->minlight / scale;
+			numdlights++;
+		}
+	}
+
+	// the clamp R_BuildLightMap packs with
+	maxlight = !gl_overbright.value ? 1 : gl_packed_pixels ? 8 : 2;
+
+	qglUniform1i(numDlightsLoc, numdlights);
+	if (numdlights)
+	{
+		qglUniform4fv(dlightOriginLoc, numdlights, origins);
+		qglUniform4fv(dlightColorLoc, numdlights, colors);
 	}
+	qglUniform1f(maxLightLoc, maxlight);
 }
 
 extern GLuint gl_bmodel_vbo;
@@ -1329,7 +1958,7 @@ void R_DrawTextureChains_GLSL(model_t *model, texchain_t chain)
 
 	// Bind the buffers
 	GL_BindBuffer(GL_ARRAY_BUFFER, gl_bmodel_vbo);
-	GL_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // indices come from client memory!
+	GL_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, gl_bmodel_ibo);
 
 	qglEnableVertexAttribArray(vertAttrIndex);
 	qglEnableVertexAttribArray(texCoordsAttrIndex);
@@ -1358,6 +1987,7 @@ void R_DrawTextureChains_GLSL(model_t *model, texchain_t chain)
 	qglUniform1f(alphaLoc, ent->transparency == 0 ? 1 : ent->transparency);
 	qglUniform1f(clTimeLoc, cl.time);
 	qglUniform1iv(turbsinLoc, TURBSINSIZE, turbsin);
+	R_SetupShaderDlights(ent);
 
 	for (i = 0 ; i < model->numtextures ; i++)
 	{
@@ -1454,7 +2084,7 @@ void R_DrawLightmapChains_GLSL(model_t *model, texchain_t chain)
 
 	// Bind the buffers
 	GL_BindBuffer(GL_ARRAY_BUFFER, gl_bmodel_vbo);
-	GL_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // indices come from client memory!
+	GL_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, gl_bmodel_ibo);
 
 	qglEnableVertexAttribArray(vertAttrIndex);
 	qglEnableVertexAttribArray(texCoordsAttrIndex);
@@ -1478,6 +2108,7 @@ void R_DrawLightmapChains_GLSL(model_t *model, texchain_t chain)
 	qglUniform1i(useLightmapOnlyLoc, 1);
 	qglUniform1i(useWaterFogLoc, 0);
 	qglUniform1f(clTimeLoc, cl.time);
+	R_SetupShaderDlights(currententity);
 
 	R_ClearBatch();
 	lastlightmap = -1;
@@ -1885,7 +2516,7 @@ void R_DrawTextureChains_Water(model_t *model, entity_t *ent, texchain_t chain)
 
 			// Bind the buffers
 			GL_BindBuffer(GL_ARRAY_BUFFER, gl_bmodel_vbo);
-			GL_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			GL_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, gl_bmodel_ibo);
 
 			qglEnableVertexAttribArray(vertAttrIndex);
 			qglEnableVertexAttribArray(texCoordsAttrIndex);
@@ -1908,6 +2539,8 @@ void R_DrawTextureChains_Water(model_t *model, entity_t *ent, texchain_t chain)
 			qglUniform1i(useLightmapOnlyLoc, 0);
 			qglUniform1i(useWaterFogLoc, 0);
 			qglUniform1f(clTimeLoc, cl.time);
+			// R_RenderDynamicLightmaps leaves the dlights to the shader
+			R_SetupShaderDlights(ent ? ent : &r_worldentity);
 
 			for (i = 0; i<model->numtextures; i++)
 			{
@@ -2394,7 +3027,7 @@ void GL_CreateSurfaceLightmap (msurface_t *surf)
 	surf->lightmaptexturenum = AllocBlock(smax, tmax, &surf->light_s, &surf->light_t);
 	base = lightmaps[surf->lightmaptexturenum].data;
 	base += (surf->light_t * LMBLOCK_WIDTH + surf->light_s) * lightmap_bytes;
-	R_BuildLightMap(surf, base, LMBLOCK_WIDTH * lightmap_bytes);
+	R_BuildLightMap(surf, base, LMBLOCK_WIDTH * lightmap_bytes, blocklights, NULL, 0);
 }
 
 /*
@@ -21,9 +21,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 #include "bhop/practice.h"
-#ifdef _WIN32
 #include "movie.h"
-#endif
 
 /*
 
@@ -537,9 +535,7 @@ void SCR_Init (void)
 	SCR_LoadPics();
 	SCR_LoadCursorImage();
 
-#ifdef _WIN32
 	Movie_Init ();
-#endif
 
 	scr_initialized = true;
 }
@@ -862,29 +858,192 @@ void ApplyGamma (byte *buffer, int size)
 	}
 }
 
-int SCR_ScreenShot (char *name)
+/*
+==============================================================================
+
+ASYNCHRONOUS SCREENSHOTS
+
+The framebuffer is read into a pixel buffer object and mapped on a later
+frame, then a task does the gamma, encodes the image and writes it, so
+neither the readback nor the compression stall the frame. Without pixel
+buffer objects the read is synchronous but the rest still runs on a task.
+
+==============================================================================
+*/
+
+#define	MAX_SHOTJOBS	8
+
+typedef enum {shot_free, shot_reading, shot_writing} shotstate_t;
+
+typedef struct
 {
-	qboolean	ok = false;
-	int		buffersize = glwidth * glheight * 3;
+	shotstate_t	state;
+	char		name[MAX_OSPATH];
+	qboolean	report;
+	int			width, height;
+	int			quality;
+	int			framecount;		// of the readback
+	GLuint		pbo;
 	byte		*buffer;
-	char		*ext;
+	task_t		*task;
+} shotjob_t;
 
-	ext = COM_FileExtension (name);
+static	shotjob_t	shotjobs[MAX_SHOTJOBS];
+static	int			shotjobs_head, shotjobs_count;
+
+static void SCR_ScreenShotTask (void *data)
+{
+	shotjob_t	*job = (shotjob_t *)data;
+	qboolean	ok;
+	int		size = job->width * job->height * 3;
+	char		*ext;
 
-	buffer = Q_malloc (buffersize);
-	glReadPixels (glx, gly, glwidth, glheight, GL_RGB, GL_UNSIGNED_BYTE, buffer);
-	ApplyGamma (buffer, buffersize);
+	ApplyGamma (job->buffer, size);
 
+	ext = COM_FileExtension (job->name);
 	if (!Q_strcasecmp(ext, "jpg"))
-		ok = Image_WriteJPEG (name, jpeg_compression_level.value, buffer + buffersize - 3 * glwidth, -glwidth, glheight);
+		ok = Image_WriteJPEG (job->name, job->quality, job->buffer + size - 3 * job->width, -job->width, job->height);
 	else if (!Q_strcasecmp(ext, "png"))
-		ok = Image_WritePNG (name, png_compression_level.value, buffer + buffersize - 3 * glwidth, -glwidth, glheight);
+		ok = Image_WritePNG (job->name, job->quality, job->buffer + size - 3 * job->width, -job->width, job->height);
 	else
-		ok = Image_WriteTGA (name, buffer, glwidth, glheight);
+		ok = Image_WriteTGA (job->name, job->buffer, job->width, job->height);
 
-	free (buffer);
+	free (job->buffer);
+	job->buffer = NULL;
 
-	return ok;
+	if (!ok)
+		Con_Printf ("Couldn't write %s\n", COM_SkipPath(job->name));
+	else if (job->report)
+		Con_Printf ("Wrote %s\n", COM_SkipPath(job->name));
+}
+
+// copies a finished readback out of its pixel buffer and hands it to a task
+static void SCR_MapScreenShot (shotjob_t *job)
+{
+	int		size = job->width * job->height * 3;
+	byte	*data;
+
+	job->buffer = Q_malloc (size);
+
+	qglBindBuffer (GL_PIXEL_PACK_BUFFER, job->pbo);
+	if ((data = qglMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY)))
+	{
+		memcpy (job->buffer, data, size);
+		qglUnmapBuffer (GL_PIXEL_PACK_BUFFER);
+	}
+	else
+	{
+		memset (job->buffer, 0, size);
+	}
+	qglBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+
+	job->state = shot_writing;
+	job->task = Task_Submit (SCR_ScreenShotTask, job);
+}
+
+static void SCR_FinishScreenShot (void)
+{
+	shotjob_t	*job = &shotjobs[shotjobs_head];
+
+	if (job->state == shot_reading)
+		SCR_MapScreenShot (job);
+
+	Task_Wait (job->task);
+	job->task = NULL;
+	job->state = shot_free;
+
+	shotjobs_head = (shotjobs_head + 1) % MAX_SHOTJOBS;
+	shotjobs_count--;
+}
+
+/*
+==================
+SCR_UpdateScreenShots
+
+Passes the readbacks started on earlier frames on to their tasks
+==================
+*/
+static void SCR_UpdateScreenShots (void)
+{
+	int			i;
+	shotjob_t	*job;
+
+	for (i = 0 ; i < shotjobs_count ; i++)
+	{
+		job = &shotjobs[(shotjobs_head + i) % MAX_SHOTJOBS];
+		if (job->state == shot_reading && job->framecount != host_framecount)
+			SCR_MapScreenShot (job);
+	}
+}
+
+void SCR_FlushScreenShots (void)
+{
+	while (shotjobs_count)
+		SCR_FinishScreenShot ();
+}
+
+static void SCR_QueueScreenShot (char *name, qboolean report)
+{
+	shotjob_t	*job;
+	char		*ext;
+
+	if (shotjobs_count == MAX_SHOTJOBS)
+		SCR_FinishScreenShot ();
+
+	job = &shotjobs[(shotjobs_head + shotjobs_count) % MAX_SHOTJOBS];
+	shotjobs_count++;
+
+	Q_strncpyz (job->name, name, sizeof(job->name));
+	job->report = report;
+	job->width = glwidth;
+	job->height = glheight;
+	job->framecount = host_framecount;
+
+	ext = COM_FileExtension (name);
+	if (!Q_strcasecmp(ext, "jpg"))
+		job->quality = jpeg_compression_level.value;
+	else
+		job->quality = png_compression_level.value;
+
+	glPixelStorei (GL_PACK_ALIGNMENT, 1);
+	if (gl_pbo_able)
+	{
+		if (!job->pbo)
+			qglGenBuffers (1, &job->pbo);
+		qglBindBuffer (GL_PIXEL_PACK_BUFFER, job->pbo);
+		qglBufferData (GL_PIXEL_PACK_BUFFER, job->width * job->height * 3, NULL, GL_STREAM_READ);
+		glReadPixels (glx, gly, job->width, job->height, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+		qglBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+		job->state = shot_reading;
+	}
+	else
+	{
+		job->buffer = Q_malloc (job->width * job->height * 3);
+		glReadPixels (glx, gly, job->width, job->height, GL_RGB, GL_UNSIGNED_BYTE, job->buffer);
+		job->state = shot_writing;
+		job->task = Task_Submit (SCR_ScreenShotTask, job);
+	}
+	glPixelStorei (GL_PACK_ALIGNMENT, 4);
+}
+
+// a queued shot's file doesn't exist until its task gets to it
+static qboolean SCR_ScreenShotQueued (char *name)
+{
+	int	i;
+
+	for (i = 0 ; i < shotjobs_count ; i++)
+		if (!Q_strcasecmp(shotjobs[(shotjobs_head + i) % MAX_SHOTJOBS].name, name))
+			return true;
+
+	return false;
+}
+
+// the image is written later, failures are reported on the console
+int SCR_ScreenShot (char *name)
+{
+	SCR_QueueScreenShot (name, false);
+
+	return true;
 }
 
 /* 
@@ -894,7 +1053,7 @@ SCR_ScreenShot_f
 */  
 void SCR_ScreenShot_f (void) 
 {
-	int	i, success;
+	int	i;
 	char	name[MAX_OSPATH], ext[4], *sshot_dir = "joequake/shots";
 
 	if (Cmd_Argc() == 2)
@@ -914,7 +1073,8 @@ void SCR_ScreenShot_f (void)
 		for (i=0 ; i<999 ; i++) 
 		{ 
 			Q_snprintfz (name, sizeof(name), "joequake%03i.%s", i, ext);
-			if (Sys_FileTime(va("%s/%s/%s", com_basedir, sshot_dir, name)) == -1)
+			if (Sys_FileTime(va("%s/%s/%s", com_basedir, sshot_dir, name)) == -1 &&
+			    !SCR_ScreenShotQueued(va("%s/%s", sshot_dir, name)))
 				break;	// file doesn't exist
 		} 
 
@@ -930,8 +1090,7 @@ void SCR_ScreenShot_f (void)
 		return;
 	}
 
-	success = SCR_ScreenShot (va("%s/%s", sshot_dir, name));
-	Con_Printf ("%s %s\n", success ? "Wrote" : "Couldn't write", name);
+	SCR_QueueScreenShot (va("%s/%s", sshot_dir, name), true);
 } 
 
 //=============================================================================
@@ -1121,6 +1280,8 @@ needs almost the entire 256k of stack space!
 */
 void SCR_UpdateScreen (void)
 {
+	SCR_UpdateScreenShots ();
+
 	if (block_drawing)
 		return;
 
@@ -1253,6 +1414,7 @@ void SCR_UpdateScreen (void)
 		SCR_CheckDrawCenterString ();
 		SCR_DrawClock ();
 		SCR_DrawFPS ();
+		Prof_DrawGraph ();
 		SCR_DrawSpeed ();
 		PathTracer_Sample_Each_Frame ();
 		if (!cls.demorecording && !cls.demoplayback)
@@ -1271,6 +1433,7 @@ void SCR_UpdateScreen (void)
 	if (CL_DemoUIOpen() && key_dest == key_game)
 		DemoUI_Draw();
 	SCR_DrawCursor();
+	Draw_Flush ();
 
 	if (!gl_glsl_gamma_able)
 	{
@@ -1280,9 +1443,7 @@ void SCR_UpdateScreen (void)
 
 	GLSLGamma_GammaCorrect();
 
-#ifdef _WIN32
 	Movie_UpdateScreen ();
-#endif
 
 	GL_EndRendering ();
 }
@@ -0,0 +1,611 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// gl_texsimd.c -- SSE2/AVX2/NEON versions of the texture resampling kernels
+//
+// Every kernel must produce exactly the bytes the scalar one does, texbench
+// checks that.  The lerps are ((b - a) * lerp >> 16) + a with lerp in
+// [0, 65535], which does not fit a signed 16 bit multiplier; the x86
+// kernels multiply by lerp - 65536 instead and add b - a back for the
+// lerps that wrapped, the NEON ones widen to 32 bits.
+
+#include "quakedef.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define	TEXSIMD_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define	TARGET_SSE2
+#define	TARGET_AVX2
+#else
+#define	TARGET_SSE2	__attribute__((target("sse2")))
+#define	TARGET_AVX2	__attribute__((target("avx2")))
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define	TEXSIMD_NEON
+#include <arm_neon.h>
+#endif
+
+qboolean OnChange_gl_texsimd (cvar_t *var, char *string);
+cvar_t	gl_texsimd = {"gl_texsimd", "1", 0, OnChange_gl_texsimd};
+
+/*
+=========================================================
+
+			Scalar
+
+=========================================================
+*/
+
+static void LerpLine_Scalar (byte *in, byte *out, int inwidth, int outwidth)
+{
+	int	j, xi, oldx = 0, f, fstep, endx = (inwidth - 1), lerp;
+
+	fstep = (inwidth << 16) / outwidth;
+	for (j = 0, f = 0 ; j < outwidth ; j++, f += fstep)
+	{
+		xi = f >> 16;
+		if (xi != oldx)
+		{
+			in += (xi - oldx) * 4;
+			oldx = xi;
+		}
+		if (xi < endx)
+		{
+			lerp = f & 0xFFFF;
+			*out++ = (byte)((((in[4] - in[0]) * lerp) >> 16) + in[0]);
+			*out++ = (byte)((((in[5] - in[1]) * lerp) >> 16) + in[1]);
+			*out++ = (byte)((((in[6] - in[2]) * lerp) >> 16) + in[2]);
+			*out++ = (byte)((((in[7] - in[3]) * lerp) >> 16) + in[3]);
+		}
+		else	// last pixel of the line has no pixel to lerp to
+		{
+			*out++ = in[0];
+			*out++ = in[1];
+			*out++ = in[2];
+			*out++ = in[3];
+		}
+	}
+}
+
+static void LerpRows_Scalar (byte *out, byte *row1, byte *row2, int size, int lerp)
+{
+	int	i;
+
+	for (i = 0 ; i < size ; i++)
+		out[i] = (byte)((((row2[i] - row1[i]) * lerp) >> 16) + row1[i]);
+}
+
+static void MipMap2D_Scalar (byte *in, int nextrow, int width, int height)
+{
+	int		i, j;
+	byte	*out = in;
+
+	for (i = 0 ; i < height ; i++, in += nextrow)
+	{
+		for (j = 0 ; j < width ; j++, out += 4, in += 8)
+		{
+			out[0] = (in[0] + in[4] + in[nextrow+0] + in[nextrow+4]) >> 2;
+			out[1] = (in[1] + in[5] + in[nextrow+1] + in[nextrow+5]) >> 2;
+			out[2] = (in[2] + in[6] + in[nextrow+2] + in[nextrow+6]) >> 2;
+			out[3] = (in[3] + in[7] + in[nextrow+3] + in[nextrow+7]) >> 2;
+		}
+	}
+}
+
+// the pixels past the last whole vector of a line
+static void MipMap2D_Tail (byte *out, byte *in, int nextrow, int count)
+{
+	for ( ; count ; count--, out += 4, in += 8)
+	{
+		out[0] = (in[0] + in[4] + in[nextrow+0] + in[nextrow+4]) >> 2;
+		out[1] = (in[1] + in[5] + in[nextrow+1] + in[nextrow+5]) >> 2;
+		out[2] = (in[2] + in[6] + in[nextrow+2] + in[nextrow+6]) >> 2;
+		out[3] = (in[3] + in[7] + in[nextrow+3] + in[nextrow+7]) >> 2;
+	}
+}
+
+#ifdef TEXSIMD_X86
+/*
+=========================================================
+
+			SSE2
+
+=========================================================
+*/
+
+TARGET_SSE2 static void LerpLine_SSE2 (byte *in, byte *out, int inwidth, int outwidth)
+{
+	int		j, xj, xk, f, fstep, endx = (inwidth - 1), lj, lk;
+	__m128i	zero = _mm_setzero_si128(), pj, pk, a, d, l, h;
+
+	fstep = (inwidth << 16) / outwidth;
+
+	// two pixels at a time while both have a right neighbour
+	for (j = 0, f = 0 ; j + 1 < outwidth ; j += 2, f += 2 * fstep)
+	{
+		xj = f >> 16;
+		xk = (f + fstep) >> 16;
+		if (xk >= endx)
+			break;
+
+		lj = f & 0xFFFF;
+		lk = (f + fstep) & 0xFFFF;
+
+		pj = _mm_unpacklo_epi8 (_mm_loadl_epi64((__m128i *)(in + xj * 4)), zero);
+		pk = _mm_unpacklo_epi8 (_mm_loadl_epi64((__m128i *)(in + xk * 4)), zero);
+		a = _mm_unpacklo_epi64 (pj, pk);
+		d = _mm_sub_epi16 (_mm_unpackhi_epi64(pj, pk), a);
+		l = _mm_set_epi16 ((short)lk, (short)lk, (short)lk, (short)lk, (short)lj, (short)lj, (short)lj, (short)lj);
+		h = _mm_mulhi_epi16 (d, l);
+		h = _mm_add_epi16 (h, _mm_and_si128(d, _mm_srai_epi16(l, 15)));
+		_mm_storel_epi64 ((__m128i *)out, _mm_packus_epi16(_mm_add_epi16(h, a), zero));
+		out += 8;
+	}
+
+	for ( ; j < outwidth ; j++, f += fstep, out += 4)
+	{
+		byte	*p = in + (f >> 16) * 4;
+		int		lerp = f & 0xFFFF;
+
+		if ((f >> 16) < endx)
+		{
+			out[0] = (byte)((((p[4] - p[0]) * lerp) >> 16) + p[0]);
+			out[1] = (byte)((((p[5] - p[1]) * lerp) >> 16) + p[1]);
+			out[2] = (byte)((((p[6] - p[2]) * lerp) >> 16) + p[2]);
+			out[3] = (byte)((((p[7] - p[3]) * lerp) >> 16) + p[3]);
+		}
+		else
+		{
+			out[0] = p[0];
+			out[1] = p[1];
+			out[2] = p[2];
+			out[3] = p[3];
+		}
+	}
+}
+
+TARGET_SSE2 static __m128i LerpBytes_SSE2 (__m128i r1, __m128i r2, __m128i l, __m128i wrapped)
+{
+	__m128i	zero = _mm_setzero_si128(), a, d, lo, hi;
+
+	a = _mm_unpacklo_epi8 (r1, zero);
+	d = _mm_sub_epi16 (_mm_unpacklo_epi8(r2, zero), a);
+	lo = _mm_add_epi16 (_mm_add_epi16(_mm_mulhi_epi16(d, l), _mm_and_si128(d, wrapped)), a);
+
+	a = _mm_unpackhi_epi8 (r1, zero);
+	d = _mm_sub_epi16 (_mm_unpackhi_epi8(r2, zero), a);
+	hi = _mm_add_epi16 (_mm_add_epi16(_mm_mulhi_epi16(d, l), _mm_and_si128(d, wrapped)), a);
+
+	return _mm_packus_epi16 (lo, hi);
+}
+
+TARGET_SSE2 static void LerpRows_SSE2 (byte *out, byte *row1, byte *row2, int size, int lerp)
+{
+	__m128i	l = _mm_set1_epi16 ((short)lerp);
+	__m128i	wrapped = _mm_set1_epi16 ((lerp & 0x8000) ? -1 : 0);
+
+	for ( ; size >= 16 ; size -= 16, out += 16, row1 += 16, row2 += 16)
+		_mm_storeu_si128 ((__m128i *)out, LerpBytes_SSE2(_mm_loadu_si128((__m128i *)row1), _mm_loadu_si128((__m128i *)row2), l, wrapped));
+
+	LerpRows_Scalar (out, row1, row2, size, lerp);
+}
+
+// sums two 16 bit pixel pairs [p0 p1] [p2 p3] horizontally into [p0+p1 p2+p3]
+#define	PAIRSUM_SSE2(x, y)	_mm_add_epi16 (_mm_unpacklo_epi64(x, y), _mm_unpackhi_epi64(x, y))
+
+TARGET_SSE2 static void MipMap2D_SSE2 (byte *in, int nextrow, int width, int height)
+{
+	int		i, j;
+	byte	*out = in;
+	__m128i	zero = _mm_setzero_si128(), a0, a1, b0, b1, q0, q1;
+
+	for (i = 0 ; i < height ; i++, in += nextrow)
+	{
+		// 4 output pixels from 8 input pixels on each of the two rows;
+		// out never gets ahead of in, so working in place is fine
+		for (j = 0 ; j + 4 <= width ; j += 4, out += 16, in += 32)
+		{
+			a0 = _mm_loadu_si128 ((__m128i *)in);
+			a1 = _mm_loadu_si128 ((__m128i *)(in + 16));
+			b0 = _mm_loadu_si128 ((__m128i *)(in + nextrow));
+			b1 = _mm_loadu_si128 ((__m128i *)(in + nextrow + 16));
+
+			q0 = PAIRSUM_SSE2(_mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero)),
+			                  _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero)));
+			q1 = PAIRSUM_SSE2(_mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero)),
+			                  _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero)));
+
+			_mm_storeu_si128 ((__m128i *)out, _mm_packus_epi16(_mm_srli_epi16(q0, 2), _mm_srli_epi16(q1, 2)));
+		}
+
+		MipMap2D_Tail (out, in, nextrow, width - j);
+		out += (width - j) * 4;
+		in += (width - j) * 8;
+	}
+}
+
+/*
+=========================================================
+
+			AVX2
+
+=========================================================
+*/
+
+TARGET_AVX2 static void LerpRows_AVX2 (byte *out, byte *row1, byte *row2, int size, int lerp)
+{
+	__m256i	zero = _mm256_setzero_si256(), r1, r2, a, d, lo, hi;
+	__m256i	l = _mm256_set1_epi16 ((short)lerp);
+	__m256i	wrapped = _mm256_set1_epi16 ((lerp & 0x8000) ? -1 : 0);
+
+	// unpack and pack both work within 128 bit lanes, so the bytes come
+	// back out in order
+	for ( ; size >= 32 ; size -= 32, out += 32, row1 += 32, row2 += 32)
+	{
+		r1 = _mm256_loadu_si256 ((__m256i *)row1);
+		r2 = _mm256_loadu_si256 ((__m256i *)row2);
+
+		a = _mm256_unpacklo_epi8 (r1, zero);
+		d = _mm256_sub_epi16 (_mm256_unpacklo_epi8(r2, zero), a);
+		lo = _mm256_add_epi16 (_mm256_add_epi16(_mm256_mulhi_epi16(d, l), _mm256_and_si256(d, wrapped)), a);
+
+		a = _mm256_unpackhi_epi8 (r1, zero);
+		d = _mm256_sub_epi16 (_mm256_unpackhi_epi8(r2, zero), a);
+		hi = _mm256_add_epi16 (_mm256_add_epi16(_mm256_mulhi_epi16(d, l), _mm256_and_si256(d, wrapped)), a);
+
+		_mm256_storeu_si256 ((__m256i *)out, _mm256_packus_epi16(lo, hi));
+	}
+
+	LerpRows_SSE2 (out, row1, row2, size, lerp);
+}
+
+#define	PAIRSUM_AVX2(x, y)	_mm256_add_epi16 (_mm256_unpacklo_epi64(x, y), _mm256_unpackhi_epi64(x, y))
+
+TARGET_AVX2 static void MipMap2D_AVX2 (byte *in, int nextrow, int width, int height)
+{
+	int		i, j;
+	byte	*out = in;
+	__m256i	zero = _mm256_setzero_si256(), a0, a1, b0, b1, q0, q1;
+
+	for (i = 0 ; i < height ; i++, in += nextrow)
+	{
+		// q0 ends up as output pixels [0 1 | 2 3] and q1 as [4 5 | 6 7],
+		// the lane-wise pack interleaves them, the permute restores the order
+		for (j = 0 ; j + 8 <= width ; j += 8, out += 32, in += 64)
+		{
+			a0 = _mm256_loadu_si256 ((__m256i *)in);
+			a1 = _mm256_loadu_si256 ((__m256i *)(in + 32));
+			b0 = _mm256_loadu_si256 ((__m256i *)(in + nextrow));
+			b1 = _mm256_loadu_si256 ((__m256i *)(in + nextrow + 32));
+
+			q0 = PAIRSUM_AVX2(_mm256_add_epi16(_mm256_unpacklo_epi8(a0, zero), _mm256_unpacklo_epi8(b0, zero)),
+			                  _mm256_add_epi16(_mm256_unpackhi_epi8(a0, zero), _mm256_unpackhi_epi8(b0, zero)));
+			q1 = PAIRSUM_AVX2(_mm256_add_epi16(_mm256_unpacklo_epi8(a1, zero), _mm256_unpacklo_epi8(b1, zero)),
+			                  _mm256_add_epi16(_mm256_unpackhi_epi8(a1, zero), _mm256_unpackhi_epi8(b1, zero)));
+
+			q0 = _mm256_packus_epi16 (_mm256_srli_epi16(q0, 2), _mm256_srli_epi16(q1, 2));
+			_mm256_storeu_si256 ((__m256i *)out, _mm256_permute4x64_epi64(q0, _MM_SHUFFLE(3, 1, 2, 0)));
+		}
+
+		MipMap2D_Tail (out, in, nextrow, width - j);
+		out += (width - j) * 4;
+		in += (width - j) * 8;
+	}
+}
+
+qboolean CPU_HasSSE2 (void)
+{
+#ifdef _MSC_VER
+	int	regs[4];
+
+	__cpuid (regs, 1);
+	return (regs[3] & (1 << 26)) != 0;
+#else
+	__builtin_cpu_init ();
+	return __builtin_cpu_supports ("sse2");
+#endif
+}
+
+qboolean CPU_HasAVX2 (void)
+{
+#ifdef _MSC_VER
+	int	regs[4];
+
+	__cpuid (regs, 0);
+	if (regs[0] < 7)
+		return false;
+
+	// the OS has to save the ymm registers too
+	__cpuid (regs, 1);
+	if (!(regs[2] & (1 << 27)) || !(regs[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex (regs, 7, 0);
+	return (regs[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init ();
+	return __builtin_cpu_supports ("avx2");
+#endif
+}
+#endif	// TEXSIMD_X86
+
+#ifdef TEXSIMD_NEON
+/*
+=========================================================
+
+			NEON
+
+=========================================================
+*/
+
+static uint8x8_t LerpPixels_NEON (uint8x8_t r1, uint8x8_t r2, int32x4_t lerplo, int32x4_t lerphi)
+{
+	int16x8_t	a = vreinterpretq_s16_u16 (vmovl_u8(r1));
+	int16x8_t	d = vsubq_s16 (vreinterpretq_s16_u16(vmovl_u8(r2)), a);
+	int16x4_t	lo = vshrn_n_s32 (vmulq_s32(vmovl_s16(vget_low_s16(d)), lerplo), 16);
+	int16x4_t	hi = vshrn_n_s32 (vmulq_s32(vmovl_s16(vget_high_s16(d)), lerphi), 16);
+
+	return vqmovun_s16 (vaddq_s16(vcombine_s16(lo, hi), a));
+}
+
+static void LerpLine_NEON (byte *in, byte *out, int inwidth, int outwidth)
+{
+	int			j, xj, xk, f, fstep, endx = (inwidth - 1);
+	uint8x8_t	pj, pk;
+
+	fstep = (inwidth << 16) / outwidth;
+
+	for (j = 0, f = 0 ; j + 1 < outwidth ; j += 2, f += 2 * fstep)
+	{
+		xj = f >> 16;
+		xk = (f + fstep) >> 16;
+		if (xk >= endx)
+			break;
+
+		pj = vld1_u8 (in + xj * 4);
+		pk = vld1_u8 (in + xk * 4);
+		vst1_u8 (out, LerpPixels_NEON(
+			vreinterpret_u8_u32(vzip_u32(vreinterpret_u32_u8(pj), vreinterpret_u32_u8(pk)).val[0]),
+			vreinterpret_u8_u32(vzip_u32(vreinterpret_u32_u8(pj), vreinterpret_u32_u8(pk)).val[1]),
+			vdupq_n_s32(f & 0xFFFF), vdupq_n_s32((f + fstep) & 0xFFFF)));
+		out += 8;
+	}
+
+	for ( ; j < outwidth ; j++, f += fstep, out += 4)
+	{
+		byte	*p = in + (f >> 16) * 4;
+		int		lerp = f & 0xFFFF;
+
+		if ((f >> 16) < endx)
+		{
+			out[0] = (byte)((((p[4] - p[0]) * lerp) >> 16) + p[0]);
+			out[1] = (byte)((((p[5] - p[1]) * lerp) >> 16) + p[1]);
+			out[2] = (byte)((((p[6] - p[2]) * lerp) >> 16) + p[2]);
+			out[3] = (byte)((((p[7] - p[3]) * lerp) >> 16) + p[3]);
+		}
+		else
+		{
+			out[0] = p[0];
+			out[1] = p[1];
+			out[2] = p[2];
+			out[3] = p[3];
+		}
+	}
+}
+
+static void LerpRows_NEON (byte *out, byte *row1, byte *row2, int size, int lerp)
+{
+	int32x4_t	l = vdupq_n_s32 (lerp);
+
+	for ( ; size >= 8 ; size -= 8, out += 8, row1 += 8, row2 += 8)
+		vst1_u8 (out, LerpPixels_NEON(vld1_u8(row1), vld1_u8(row2), l, l));
+
+	LerpRows_Scalar (out, row1, row2, size, lerp);
+}
+
+static void MipMap2D_NEON (byte *in, int nextrow, int width, int height)
+{
+	int			i, j;
+	byte		*out = in;
+	uint32x4x2_t	a, b;
+	uint16x8_t	lo, hi;
+
+	for (i = 0 ; i < height ; i++, in += nextrow)
+	{
+		// vld2 splits the 8 input pixels of each row into even and odd ones
+		for (j = 0 ; j + 4 <= width ; j += 4, out += 16, in += 32)
+		{
+			a = vld2q_u32 ((uint32_t *)in);
+			b = vld2q_u32 ((uint32_t *)(in + nextrow));
+
+			lo = vaddl_u8 (vget_low_u8(vreinterpretq_u8_u32(a.val[0])), vget_low_u8(vreinterpretq_u8_u32(a.val[1])));
+			lo = vaddq_u16 (lo, vaddl_u8(vget_low_u8(vreinterpretq_u8_u32(b.val[0])), vget_low_u8(vreinterpretq_u8_u32(b.val[1]))));
+			hi = vaddl_u8 (vget_high_u8(vreinterpretq_u8_u32(a.val[0])), vget_high_u8(vreinterpretq_u8_u32(a.val[1])));
+			hi = vaddq_u16 (hi, vaddl_u8(vget_high_u8(vreinterpretq_u8_u32(b.val[0])), vget_high_u8(vreinterpretq_u8_u32(b.val[1]))));
+
+			vst1q_u8 (out, vcombine_u8(vshrn_n_u16(lo, 2), vshrn_n_u16(hi, 2)));
+		}
+
+		MipMap2D_Tail (out, in, nextrow, width - j);
+		out += (width - j) * 4;
+		in += (width - j) * 8;
+	}
+}
+#endif	// TEXSIMD_NEON
+
+/*
+=========================================================
+
+			Selection
+
+=========================================================
+*/
+
+static texkernels_t	texkernels_list[] =
+{
+	{"scalar", LerpLine_Scalar, LerpRows_Scalar, MipMap2D_Scalar},
+#ifdef TEXSIMD_X86
+	{"SSE2", LerpLine_SSE2, LerpRows_SSE2, MipMap2D_SSE2},
+	{"AVX2", LerpLine_SSE2, LerpRows_AVX2, MipMap2D_AVX2},
+#endif
+#ifdef TEXSIMD_NEON
+	{"NEON", LerpLine_NEON, LerpRows_NEON, MipMap2D_NEON},
+#endif
+};
+
+#define	NUM_TEXKERNELS	(sizeof(texkernels_list) / sizeof(texkernels_list[0]))
+
+texkernels_t	*texkernels = &texkernels_list[0];
+
+static qboolean TexKernels_Supported (texkernels_t *k)
+{
+#ifdef TEXSIMD_X86
+	if (!strcmp(k->name, "SSE2"))
+		return CPU_HasSSE2 ();
+	if (!strcmp(k->name, "AVX2"))
+		return CPU_HasAVX2 ();
+#endif
+	return true;
+}
+
+// picks the last supported entry, they're in order of preference
+static texkernels_t *TexKernels_Best (void)
+{
+	int	i;
+
+	for (i = NUM_TEXKERNELS - 1 ; i > 0 ; i--)
+		if (TexKernels_Supported(&texkernels_list[i]))
+			return &texkernels_list[i];
+
+	return &texkernels_list[0];
+}
+
+qboolean OnChange_gl_texsimd (cvar_t *var, char *string)
+{
+	texkernels = Q_atof(string) ? TexKernels_Best () : &texkernels_list[0];
+
+	return false;
+}
+
+/*
+====================
+TexBench_f
+
+Times every supported kernel set against the scalar one on a synthetic
+image and checks the output matches byte for byte
+====================
+*/
+#define	BENCH_SIZE		2048
+#define	BENCH_SOURCE	1500	// resampled up to BENCH_SIZE
+#define	BENCH_RUNS		8
+#define	BENCH_BYTES		(BENCH_SIZE * BENCH_SIZE * 4)
+
+// leaves the resampled image in resampled and the mipped down one in mipped,
+// which still holds the tail ends of all the bigger levels
+static void TexBench_Run (texkernels_t *k, byte *src, byte *resampled, byte *mipped, double *resample_ms, double *mip_ms)
+{
+	int				i, w, h;
+	double			start;
+	texkernels_t	*saved = texkernels;
+
+	texkernels = k;
+
+	start = Sys_DoubleTime ();
+	for (i = 0 ; i < BENCH_RUNS ; i++)
+		ResampleTexture ((unsigned *)src, BENCH_SOURCE, BENCH_SOURCE, (unsigned *)resampled, BENCH_SIZE, BENCH_SIZE, true);
+	*resample_ms = (Sys_DoubleTime() - start) * 1000 / BENCH_RUNS;
+
+	start = Sys_DoubleTime ();
+	for (i = 0 ; i < BENCH_RUNS ; i++)
+	{
+		memcpy (mipped, resampled, BENCH_BYTES);
+		for (w = h = BENCH_SIZE ; w > 1 || h > 1 ; )
+			MipMap (mipped, &w, &h);
+	}
+	*mip_ms = (Sys_DoubleTime() - start) * 1000 / BENCH_RUNS;
+
+	texkernels = saved;
+}
+
+static void TexBench_f (void)
+{
+	int		i;
+	byte	*src, *ref, *dst;
+	double	resample_ms, mip_ms;
+	unsigned	seed = 1;
+	char	*result;
+
+	src = Q_malloc (BENCH_SOURCE * BENCH_SOURCE * 4);
+	ref = Q_malloc (2 * BENCH_BYTES);
+	dst = Q_malloc (2 * BENCH_BYTES);
+
+	// noise, so that every lerp and rounding case shows up
+	for (i = 0 ; i < BENCH_SOURCE * BENCH_SOURCE * 4 ; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		src[i] = (byte)(seed >> 16);
+	}
+
+	Con_Printf ("%dx%d to %dx%d resample, mipmap includes a %d KB copy, %d runs:\n",
+		BENCH_SOURCE, BENCH_SOURCE, BENCH_SIZE, BENCH_SIZE, BENCH_BYTES / 1024, BENCH_RUNS);
+	for (i = 0 ; i < NUM_TEXKERNELS ; i++)
+	{
+		if (!TexKernels_Supported(&texkernels_list[i]))
+		{
+			Con_Printf ("%-8s not supported by this CPU\n", texkernels_list[i].name);
+			continue;
+		}
+
+		if (!i)
+		{
+			TexBench_Run (&texkernels_list[i], src, ref, ref + BENCH_BYTES, &resample_ms, &mip_ms);
+			result = "reference";
+		}
+		else
+		{
+			TexBench_Run (&texkernels_list[i], src, dst, dst + BENCH_BYTES, &resample_ms, &mip_ms);
+			if (memcmp(ref, dst, BENCH_BYTES))
+				result = "resample MISMATCH";
+			else if (memcmp(ref + BENCH_BYTES, dst + BENCH_BYTES, BENCH_BYTES))
+				result = "mipmap MISMATCH";
+			else
+				result = "identical";
+		}
+
+		Con_Printf ("%-8s resample %7.2f ms  mipmap %7.2f ms  %s\n", texkernels_list[i].name, resample_ms, mip_ms, result);
+	}
+	Con_Printf ("in use: %s\n", texkernels->name);
+
+	free (src);
+	free (ref);
+	free (dst);
+}
+
+void TexKernels_Init (void)
+{
+	Cvar_Register (&gl_texsimd);
+	Cmd_AddCommand ("texbench", TexBench_f);
+
+	texkernels = gl_texsimd.value ? TexKernels_Best () : &texkernels_list[0];
+}
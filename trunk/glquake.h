@@ -66,6 +66,38 @@ void GL_EnableMultitexture (void);
 void GL_EnableTMU (GLenum target);
 void GL_DisableTMU (GLenum target);
 
+// texture resampling kernels, gl_texsimd.c picks the fastest the CPU runs
+typedef struct
+{
+	char	*name;
+	void	(*lerpline) (byte *in, byte *out, int inwidth, int outwidth);
+	void	(*lerprows) (byte *out, byte *row1, byte *row2, int size, int lerp);
+	void	(*mipmap2d) (byte *in, int nextrow, int width, int height);	// in place, output size
+} texkernels_t;
+
+extern	texkernels_t	*texkernels;
+
+void TexKernels_Init (void);
+
+// x86 only, gl_texsimd.c
+qboolean CPU_HasSSE2 (void);
+qboolean CPU_HasAVX2 (void);
+
+// lightmap building kernels, gl_lightsimd.c picks the fastest the CPU runs;
+// blocklights is 8.8 RGB, maxvalue is at most 255 unless packed
+typedef struct
+{
+	char	*name;
+	void	(*addlightmap) (unsigned *bl, byte *lightmap, unsigned scale, int count);
+	void	(*adddlight) (unsigned *bl, int smax, int tmax, int sd, int td, int irad, int iminlight, int *color);
+	void	(*packlightmap) (byte *dest, int stride, unsigned *bl, int smax, int tmax, int shift, int maxvalue, qboolean bgra, qboolean packed);
+} lightkernels_t;
+
+extern	lightkernels_t	*lightkernels;
+
+void LightKernels_Init (void);
+void ResampleTexture (unsigned *indata, int inwidth, int inheight, unsigned *outdata, int outwidth, int outheight, qboolean quality);
+void MipMap (byte *in, int *width, int *height);
 void GL_Upload32 (unsigned *data, int width, int height, int mode);
 void GL_Upload8 (byte *data, int width, int height, int mode);
 int GL_LoadTexture (char *identifier, int width, int height, byte *data, int mode, int bytesperpixel);
@@ -73,6 +105,11 @@ byte *GL_LoadImagePixels (char* filename, int matchwidth, int matchheight, int m
 int GL_LoadTextureImage (char *filename, char *identifier, int matchwidth, int matchheight, int mode);
 mpic_t *GL_LoadPicImage (char *filename, char *id, int matchwidth, int matchheight, int mode);
 int GL_LoadCharsetImage (char *filename, char *identifier);
+qboolean GL_BeginImageBatch (void);
+void GL_EndImageBatch (void);
+typedef void (*imageretry_t) (void *data);
+void GL_SetImageRetry (imageretry_t func, void *data);
+void GL_PruneTextureCache (void);
 
 typedef struct
 {
@@ -101,7 +138,7 @@ void R_ReadPointFile_f (void);
 texture_t *R_TextureAnimation (texture_t *base);
 
 #define ISTRANSPARENT(ent)	(((ent)->transparency > 0 && (ent)->transparency < 1) || \
-							 (ent)->model && (ent)->model->type == mod_md3 && ((ent)->model->flags & EF_Q3TRANS))
+							 ((ent)->model && (ent)->model->type == mod_md3 && ((ent)->model->flags & EF_Q3TRANS)))
 
 //====================================================
 
@@ -140,6 +177,7 @@ extern	entity_t	*currententity;
 extern	int		r_visframecount;	// ??? what difs?
 extern	int		r_framecount;
 extern	mplane_t	frustum[4];
+extern	float		r_fovx, r_fovy;
 extern	int		c_brush_polys, c_alias_polys, c_md3_polys;
 
 // view origin
@@ -177,7 +215,10 @@ extern	cvar_t	r_shadows;
 extern	cvar_t	r_wateralpha;
 extern	cvar_t	r_litwater;
 extern	cvar_t	r_dynamic;
+extern	cvar_t	r_dynamic_glsl;
 extern	cvar_t	r_novis;
+extern	cvar_t	r_markcache;
+extern	cvar_t	r_occlusion;
 extern	cvar_t	r_outline_players;
 extern	cvar_t	r_outline_monsters;
 extern	cvar_t	r_outline_color;
@@ -276,6 +317,19 @@ void GL_BindTBO (int texnum);
 // Generate mipmaps
 typedef void (APIENTRY *lpGenerateMipmapFUNC)(GLenum);
 
+// Texture compression
+typedef void (APIENTRY *lpCompressedTexImage2DFUNC)(GLenum, GLint, GLenum, GLsizei, GLsizei, GLint, GLsizei, const GLvoid *);
+extern	qboolean	gl_texture_s3tc_able;
+extern	qboolean	gl_texture_bptc_able;
+
+// Occlusion queries
+typedef void (APIENTRY *lpGenQueriesFUNC)(GLsizei, GLuint *);
+typedef void (APIENTRY *lpDeleteQueriesFUNC)(GLsizei, const GLuint *);
+typedef void (APIENTRY *lpBeginQueryFUNC)(GLenum, GLuint);
+typedef void (APIENTRY *lpEndQueryFUNC)(GLenum);
+typedef void (APIENTRY *lpGetQueryObjectuivFUNC)(GLuint, GLenum, GLuint *);
+extern	qboolean	gl_occlusion_able;
+
 // Multitexture
 typedef void (APIENTRY *lpMTexFUNC)(GLenum, GLfloat, GLfloat);
 typedef void (APIENTRY *lpSelTexFUNC)(GLenum);
@@ -293,6 +347,10 @@ typedef void (APIENTRY *lpBufferSubDataFUNC) (GLenum, GLintptrARB, GLsizeiptrARB
 typedef void (APIENTRY *lpDeleteBuffersFUNC) (GLsizei, const GLuint *);
 typedef void (APIENTRY *lpGenBuffersFUNC) (GLsizei, GLuint *);
 
+// PBO
+typedef void *(APIENTRY *lpMapBufferFUNC) (GLenum, GLenum);
+typedef GLboolean (APIENTRY *lpUnmapBufferFUNC) (GLenum);
+
 // GLSL
 typedef GLuint(APIENTRY *lpCreateShaderFUNC) (GLenum type);
 typedef void (APIENTRY *lpDeleteShaderFUNC) (GLuint shader);
@@ -318,6 +376,7 @@ typedef void (APIENTRY *lpUniform1ivFUNC) (GLint location, GLsizei count, const
 typedef void (APIENTRY *lpUniform1fFUNC) (GLint location, GLfloat v0);
 typedef void (APIENTRY *lpUniform3fFUNC) (GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
 typedef void (APIENTRY *lpUniform4fFUNC) (GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
+typedef void (APIENTRY *lpUniform4fvFUNC) (GLint location, GLsizei count, const GLfloat *v);
 typedef void (APIENTRY *lpUniformMatrix4fvFUNC) (GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
 typedef void (APIENTRY *lpTexBufferFUNC) (GLenum target, GLenum internalformat, GLuint buffer);
 typedef void (APIENTRY *lpBindBufferBaseFUNC) (GLenum target, GLuint index, GLuint buffer);
@@ -325,6 +384,12 @@ typedef GLuint(APIENTRY *lpGetUniformBlockIndexFUNC) (GLuint program, const GLch
 typedef void (APIENTRY *lpUniformBlockBindingFUNC) (GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding);
 
 extern lpGenerateMipmapFUNC qglGenerateMipmap;
+extern lpCompressedTexImage2DFUNC qglCompressedTexImage2D;
+extern lpGenQueriesFUNC qglGenQueries;
+extern lpDeleteQueriesFUNC qglDeleteQueries;
+extern lpBeginQueryFUNC qglBeginQuery;
+extern lpEndQueryFUNC qglEndQuery;
+extern lpGetQueryObjectuivFUNC qglGetQueryObjectuiv;
 
 extern lpMTexFUNC qglMultiTexCoord2f;
 extern lpSelTexFUNC qglActiveTexture;
@@ -333,6 +398,8 @@ extern lpBufferDataFUNC qglBufferData;
 extern lpBufferSubDataFUNC qglBufferSubData;
 extern lpDeleteBuffersFUNC qglDeleteBuffers;
 extern lpGenBuffersFUNC qglGenBuffers;
+extern lpMapBufferFUNC qglMapBuffer;
+extern lpUnmapBufferFUNC qglUnmapBuffer;
 
 extern lpCreateShaderFUNC qglCreateShader;
 extern lpDeleteShaderFUNC qglDeleteShader;
@@ -358,6 +425,7 @@ extern lpUniform1ivFUNC qglUniform1iv;
 extern lpUniform1fFUNC qglUniform1f;
 extern lpUniform3fFUNC qglUniform3f;
 extern lpUniform4fFUNC qglUniform4f;
+extern lpUniform4fvFUNC qglUniform4fv;
 extern lpUniformMatrix4fvFUNC qglUniformMatrix4fv;
 extern lpTexBufferFUNC qglTexBuffer;
 extern lpBindBufferBaseFUNC qglBindBufferBase;
@@ -367,6 +435,7 @@ extern lpUniformBlockBindingFUNC qglUniformBlockBinding;
 extern qboolean gl_mtexable;
 extern int gl_textureunits;
 extern qboolean	gl_vbo_able;
+extern qboolean	gl_pbo_able;
 extern qboolean	gl_glsl_able;
 extern qboolean gl_glsl_gamma_able;
 extern qboolean gl_glsl_alias_able;
@@ -426,13 +495,18 @@ typedef enum {
 
 // gl_rmain.c
 qboolean R_CullBox (vec3_t mins, vec3_t maxs);
+qboolean R_CullBoxPlanes (mplane_t *planes, vec3_t mins, vec3_t maxs);
 qboolean R_CullSphere (vec3_t centre, float radius);
+int SignbitsForPlane (mplane_t *out);
 void R_PolyBlend (void);
 void R_BrightenScreen (void);
 void R_Q3DamageDraw (void);
 void GLAlias_CreateShaders(void);
 void GLSLGamma_GammaCorrect(void);
 qboolean R_CullModelForEntity(entity_t *ent);
+void R_CullEntities (void);
+void R_FinishCullEntities (void);
+void R_ClearOcclusion (void);
 
 #define NUMVERTEXNORMALS	162
 extern	float	r_avertexnormals[NUMVERTEXNORMALS][3];
@@ -467,6 +541,8 @@ void R_MarkLights (dlight_t *light, int lnum, mnode_t *node);
 void R_AnimateLight (void);
 void R_RenderDlights (void);
 int R_LightPoint (vec3_t p);
+int R_LightPointCached (vec3_t p, lightcache_t *cache);
+void R_ClearLightCache (void);
 float R_GetVertexLightValue (byte ppitch, byte pyaw, float apitch, float ayaw);
 float R_LerpVertexLight (byte ppitch1, byte pyaw1, byte ppitch2, byte pyaw2, float ilerp, float apitch, float ayaw);
 void R_InitVertexLights (void);
@@ -480,6 +556,7 @@ void R_StoreEfrags (efrag_t **ppefrag);
 
 // gl_mesh.c
 void GL_MakeAliasModelDisplayLists (model_t *m, aliashdr_t *hdr);
+void GLMesh_LoadQ3VertexBuffer (model_t *m, const md3header_t *hdr);
 
 // gl_rsurf.c
 void DrawGLPoly(glpoly_t *p);
@@ -489,6 +566,8 @@ void R_DrawWorld (void);
 void GL_BuildLightmaps (void);
 void GL_DeleteBModelVertexBuffer(void);
 void GL_BuildBModelVertexBuffer(void);
+void R_ClearRenderLists (void);
+void R_FinishRenderList (void);
 void GLWorld_CreateShaders(void);
 
 // gl_rmisc.c
@@ -512,6 +591,7 @@ extern	part_mode_t	particle_mode;
 // gl_decals.c
 void R_InitDecals (void);
 void R_ClearDecals (void);
+void R_FlushDecals (void);
 void R_DrawDecals (void);
 void R_SpawnDecal (vec3_t center, vec3_t normal, vec3_t tangent, int tex, int size);
 void R_SpawnDecalStatic (vec3_t org, int tex, int size);
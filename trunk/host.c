@@ -21,9 +21,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 #include "bgmusic.h"
-#ifdef _WIN32
 #include "movie.h"
-#endif
 #ifndef GLQUAKE
 #include "r_local.h"
 #endif
@@ -159,6 +157,8 @@ void Host_Error (char *error, ...)
 	Con_Printf ("Host_Error: %s\n",string);
 	Con_Printf ("===========================\n\n");
 	
+	CL_FlushDemo ();
+
 	if (sv.active)
 		Host_ShutdownServer (false);
 
@@ -536,6 +536,10 @@ not reinitialize anything.
 void Host_ClearMemory (void)
 {
 	Con_DPrintf ("Clearing memory\n");
+#ifdef GLQUAKE
+	// the decal clipping task walks the world that's about to be freed
+	R_FlushDecals ();
+#endif
 	D_FlushCaches ();
 	Mod_ClearAll ();
 	if (host_hunklevel)
@@ -577,10 +581,8 @@ qboolean Host_FilterTime (double time)
 
 	if (host_framerate.value > 0 || (cls.demoplayback && cl_demospeed.value != 1))
 		frametime = MinPhysFrameTime();
-#ifdef _WIN32
 	else if (Movie_IsActive())
 		frametime = Movie_FrameTime();
-#endif
 	else
 		frametime = 1.0 / (!cl_maxfps.value ? 100000 : bound(10, cl_maxfps.value, 100000));
 
@@ -588,11 +590,9 @@ qboolean Host_FilterTime (double time)
 
 	if (cls.capturedemo || cls.timedemo || realtime - oldrealtime >= frametime)
 	{
-#ifdef _WIN32
 		if (Movie_IsActive())
 			host_frametime = frametime;
 		else
-#endif
 			host_frametime = realtime - oldrealtime;
 		if (cls.demoplayback)
 			host_frametime *= bound(0, cl_demospeed.value, 20);
@@ -676,7 +676,11 @@ void Host_ServerFrame (double time)
 	// move things around and think
 	// always pause in single player if in console or menus
 	if (!sv.paused && (svs.maxclients > 1 || key_dest == key_game))
+	{
+		Prof_Begin (prof_physics);
 		SV_Physics ();
+		Prof_End (prof_physics);
+	}
 
 	// send all messages to the clients
 	SV_SendClientMessages ();
@@ -700,6 +704,8 @@ void _Host_Frame (double time)
 	// keep the random time dependent
 	rand ();
 
+	Tasks_Frame ();
+
 	// decide the simulation time
 	if (!Host_FilterTime(time))
 	{
@@ -709,12 +715,12 @@ void _Host_Frame (double time)
 		return;			// don't run too fast, or packets will flood out
 	}
 
+	Prof_BeginFrame ();
+
 	if (!cl_independentphysics.value || 
 		host_framerate.value > 0 ||
 		(cls.demoplayback && cl_demospeed.value != 1)
-#ifdef _WIN32
 		|| Movie_IsActive()
-#endif
 		)
 	{
 		physframe = true;
@@ -779,7 +785,11 @@ void _Host_Frame (double time)
 
 		// fetch results from server
 		if (cls.state == ca_connected)
+		{
+			Prof_Begin (prof_client);
 			CL_ReadFromServer();
+			Prof_End (prof_client);
+		}
 
 		if (cls.state == ca_disconnected) // We need to move the mouse also when disconnected
 		{
@@ -793,7 +803,11 @@ void _Host_Frame (double time)
 
 		// fetch results from server
 		if (cls.state == ca_connected)
+		{
+			Prof_Begin (prof_client);
 			CL_ReadFromServer();
+			Prof_End (prof_client);
+		}
 
 		if (!cls.demoplayback || // not demo playback
 			CL_DemoUIOpen() || // unless we have the demo UI open, then we need correct mouse cursor movement
@@ -813,13 +827,16 @@ void _Host_Frame (double time)
 		time1 = Sys_DoubleTime ();
 
 	// update video
+	Prof_Begin (prof_screen);
 	SCR_UpdateScreen ();
+	Prof_End (prof_screen);
 
 	if (host_speeds.value)
 		time2 = Sys_DoubleTime ();
 
 	// update audio
 	BGM_Update();
+	Prof_Begin (prof_sound);
 	if (cls.signon == SIGNONS)
 	{
 		// update audio
@@ -830,6 +847,7 @@ void _Host_Frame (double time)
 	{
 		S_Update (vec3_origin, vec3_origin, vec3_origin, vec3_origin);
 	}
+	Prof_End (prof_sound);
 
 	CDAudio_Update ();
 
@@ -880,6 +898,8 @@ void _Host_Frame (double time)
 		}
 	}
 
+	Prof_EndFrame ();
+
 	host_framecount++;
 	fps_count++;
 }
@@ -1025,6 +1045,8 @@ void Host_Init (quakeparms_t *parms)
 	Cbuf_Execute ();
 
 	Con_Init ();
+	Tasks_Init ();
+	Prof_Init ();
 	M_Init ();
 	PR_Init ();
 	Mod_Init ();
@@ -1136,6 +1158,12 @@ void Host_Shutdown (void)
 		fclose (cmdhist);
 	}
 
+#ifdef GLQUAKE
+	// the screenshots still being written would be lost with the workers
+	SCR_FlushScreenShots ();
+#endif
+
+	Tasks_Shutdown ();
 	SList_Shutdown ();
 	BGM_Shutdown ();
 	CDAudio_Shutdown ();
@@ -27,7 +27,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define	IMAGE_MAX_DIMENSIONS	8192
 
-int	image_width, image_height;
+THREADLOCAL	int	image_width, image_height;
 
 cvar_t	png_compression_level = {"png_compression_level", "1"};
 #ifdef GLQUAKE
@@ -858,6 +858,318 @@ int Image_WriteJPEG (char *filename, int compression, byte *pixels, int width, i
 
 #endif
 
+#ifdef GLQUAKE
+
+/*
+=========================================================
+
+			DDS / KTX
+
+Precompressed textures, uploaded as they are along with whatever mip levels
+they carry.  Only the S3TC and BPTC formats are recognized; the sRGB
+variants hold the same gamma encoded texels as every other image the engine
+loads, so they are taken as the plain ones.
+
+=========================================================
+*/
+
+#define	DDS_MAGIC			(('D'<<0)+('D'<<8)+('S'<<16)+(' '<<24))
+#define	DDS_FOURCC(a,b,c,d)	((a)+((b)<<8)+((c)<<16)+((d)<<24))
+
+#define	DDPF_ALPHAPIXELS	0x1
+#define	DDPF_FOURCC			0x4
+
+typedef struct
+{
+	int		size, flags, height, width, pitch, depth, mipmapcount;
+	int		reserved1[11];
+	int		pfsize, pfflags, pffourcc, pfrgbbitcount;
+	int		pfrmask, pfgmask, pfbmask, pfamask;
+	int		caps, caps2, caps3, caps4, reserved2;
+} ddsheader_t;
+
+// follows the header when pffourcc is DX10
+typedef struct
+{
+	int		dxgiformat, dimension, miscflag, arraysize, miscflags2;
+} ddsheader_dx10_t;
+
+#define	KTX_ENDIANNESS	0x04030201
+
+static const byte ktx_identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+typedef struct
+{
+	byte	identifier[12];
+	int		endianness;
+	int		gltype, gltypesize, glformat;
+	int		glinternalformat, glbaseinternalformat;
+	int		width, height, depth;
+	int		numarrayelements, numfaces, numlevels;
+	int		keyvaluebytes;
+} ktxheader_t;
+
+static const int ktx_formats[][2] = {
+	{GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGB_S3TC_DXT1_EXT},
+	{GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT},
+	{GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT},
+	{GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT},
+	{GL_COMPRESSED_RGBA_BPTC_UNORM_ARB, GL_COMPRESSED_RGBA_BPTC_UNORM_ARB},
+	{GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGB_S3TC_DXT1_EXT},
+	{GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT},
+	{GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT},
+	{GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT},
+	{GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB, GL_COMPRESSED_RGBA_BPTC_UNORM_ARB}
+};
+
+/*
+=============
+Image_MipLevelSize
+=============
+*/
+int Image_MipLevelSize (int format, int width, int height)
+{
+	switch (format)
+	{
+	case 0:
+		return width * height * 4;
+
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		return ((width + 3) / 4) * ((height + 3) / 4) * 8;
+
+	default:
+		return ((width + 3) / 4) * ((height + 3) / 4) * 16;
+	}
+}
+
+// returns the GL format of the image, 0 if it can't be used
+static int DDS_ReadHeader (FILE *fin, ddsheader_t *header)
+{
+	int					i, magic, format;
+	ddsheader_dx10_t	dx10;
+
+	if (fread(&magic, 1, 4, fin) != 4 || LittleLong(magic) != DDS_MAGIC)
+		return 0;
+	if (fread(header, 1, sizeof(*header), fin) != sizeof(*header))
+		return 0;
+	for (i = 0 ; i < sizeof(*header) / 4 ; i++)
+		((int *)header)[i] = LittleLong (((int *)header)[i]);
+
+	if (header->size != sizeof(*header) || !(header->pfflags & DDPF_FOURCC))
+		return 0;
+	if (header->width <= 0 || header->width > IMAGE_MAX_DIMENSIONS || header->height <= 0 || header->height > IMAGE_MAX_DIMENSIONS)
+		return 0;
+
+	switch (header->pffourcc)
+	{
+	case DDS_FOURCC('D','X','T','1'):
+		return (header->pfflags & DDPF_ALPHAPIXELS) ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+	case DDS_FOURCC('D','X','T','3'):
+		return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+
+	case DDS_FOURCC('D','X','T','5'):
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+	case DDS_FOURCC('D','X','1','0'):
+		if (fread(&dx10, 1, sizeof(dx10), fin) != sizeof(dx10))
+			return 0;
+		if (LittleLong(dx10.arraysize) > 1)
+			return 0;
+
+		switch (LittleLong(dx10.dxgiformat))
+		{
+		case 71:	// DXGI_FORMAT_BC1_UNORM
+		case 72:	// DXGI_FORMAT_BC1_UNORM_SRGB
+			format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+			break;
+		case 74:	// DXGI_FORMAT_BC2_UNORM
+		case 75:	// DXGI_FORMAT_BC2_UNORM_SRGB
+			format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+			break;
+		case 77:	// DXGI_FORMAT_BC3_UNORM
+		case 78:	// DXGI_FORMAT_BC3_UNORM_SRGB
+			format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			break;
+		case 98:	// DXGI_FORMAT_BC7_UNORM
+		case 99:	// DXGI_FORMAT_BC7_UNORM_SRGB
+			format = GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
+			break;
+		default:
+			format = 0;
+			break;
+		}
+		return format;
+	}
+
+	return 0;
+}
+
+// returns the GL format of the image, 0 if it can't be used
+static int KTX_ReadHeader (FILE *fin, ktxheader_t *header)
+{
+	int		i;
+
+	if (fread(header, 1, sizeof(*header), fin) != sizeof(*header))
+		return 0;
+	if (memcmp(header->identifier, ktx_identifier, sizeof(ktx_identifier)) || header->endianness != KTX_ENDIANNESS)
+		return 0;
+
+	// 2D, block compressed, no arrays or cube maps
+	if (header->gltype || header->depth > 0 || header->numarrayelements > 0 || header->numfaces != 1)
+		return 0;
+	if (header->width <= 0 || header->width > IMAGE_MAX_DIMENSIONS || header->height <= 0 || header->height > IMAGE_MAX_DIMENSIONS)
+		return 0;
+
+	for (i = 0 ; i < sizeof(ktx_formats) / sizeof(ktx_formats[0]) ; i++)
+		if (header->glinternalformat == ktx_formats[i][0])
+			return ktx_formats[i][1];
+
+	return 0;
+}
+
+// sets up a chain of at most numlevels levels, stopping at 1x1
+static void Image_AllocMipChain (mipchain_t *chain, int format, int width, int height, int numlevels)
+{
+	chain->format = format;
+	chain->width = width;
+	chain->height = height;
+	chain->numlevels = 0;
+	chain->size = 0;
+
+	while (chain->numlevels < numlevels)
+	{
+		chain->size += Image_MipLevelSize (format, width, height);
+		chain->numlevels++;
+		if (width == 1 && height == 1)
+			break;
+		width = max(1, width >> 1);
+		height = max(1, height >> 1);
+	}
+
+	chain->data = Q_malloc (chain->size);
+}
+
+/*
+=============
+Image_CompressedFormat
+
+Peeks at the header of a DDS or KTX file, returns the GL format it would
+be uploaded with or 0
+=============
+*/
+int Image_CompressedFormat (FILE *fin, int filetype)
+{
+	int			format;
+	long		start;
+	ddsheader_t	ddsheader;
+	ktxheader_t	ktxheader;
+
+	start = ftell (fin);
+	if (filetype == image_DDS)
+		format = DDS_ReadHeader (fin, &ddsheader);
+	else if (filetype == image_KTX)
+		format = KTX_ReadHeader (fin, &ktxheader);
+	else
+		format = 0;
+	fseek (fin, start, SEEK_SET);
+
+	return format;
+}
+
+/*
+=============
+Image_LoadDDS
+=============
+*/
+qboolean Image_LoadDDS (FILE *fin, char *filename, mipchain_t *chain)
+{
+	int			format;
+	ddsheader_t	header;
+
+	if (!fin && COM_FOpenFile(filename, &fin) == -1)
+		return false;
+
+	if (!(format = DDS_ReadHeader(fin, &header)))
+	{
+		Con_DPrintf ("DDS image %s is not in a supported format\n", COM_SkipPath(filename));
+		fclose (fin);
+		return false;
+	}
+
+	// the levels follow the headers back to back
+	Image_AllocMipChain (chain, format, header.width, header.height, max(1, header.mipmapcount));
+	if (fread(chain->data, 1, chain->size, fin) != chain->size)
+	{
+		Con_DPrintf ("DDS image %s is truncated\n", COM_SkipPath(filename));
+		free (chain->data);
+		chain->data = NULL;
+		fclose (fin);
+		return false;
+	}
+
+	image_width = header.width;
+	image_height = header.height;
+
+	fclose (fin);
+
+	return true;
+}
+
+/*
+=============
+Image_LoadKTX
+=============
+*/
+qboolean Image_LoadKTX (FILE *fin, char *filename, mipchain_t *chain)
+{
+	int			i, format, width, height, size, levelsize;
+	byte		*level;
+	ktxheader_t	header;
+
+	if (!fin && COM_FOpenFile(filename, &fin) == -1)
+		return false;
+
+	if (!(format = KTX_ReadHeader(fin, &header)))
+	{
+		Con_DPrintf ("KTX image %s is not in a supported format\n", COM_SkipPath(filename));
+		fclose (fin);
+		return false;
+	}
+
+	fseek (fin, header.keyvaluebytes, SEEK_CUR);
+
+	// each level is prefixed with its size, block sizes need no padding
+	Image_AllocMipChain (chain, format, header.width, header.height, max(1, header.numlevels));
+	width = header.width;
+	height = header.height;
+	for (i = 0, level = chain->data ; i < chain->numlevels ; i++)
+	{
+		levelsize = Image_MipLevelSize (format, width, height);
+		if (fread(&size, 1, 4, fin) != 4 || size != levelsize || fread(level, 1, levelsize, fin) != levelsize)
+		{
+			Con_DPrintf ("KTX image %s is truncated\n", COM_SkipPath(filename));
+			free (chain->data);
+			chain->data = NULL;
+			fclose (fin);
+			return false;
+		}
+		level += levelsize;
+		width = max(1, width >> 1);
+		height = max(1, height >> 1);
+	}
+
+	image_width = header.width;
+	image_height = header.height;
+
+	fclose (fin);
+
+	return true;
+}
+
+#endif
+
 /*
 =========================================================
 
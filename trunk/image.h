@@ -19,7 +19,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 // image.h
 
-extern	int	image_width, image_height;
+// per thread, so images can be decoded on task workers
+extern	THREADLOCAL	int	image_width, image_height;
 
 extern	cvar_t	png_compression_level, jpeg_compression_level;
 
@@ -38,6 +39,21 @@ byte *Image_LoadJPEG (FILE *fin, char *filename, int matchwidth, int matchheight
 int Image_WriteJPEG (char *filename, int compression, byte *pixels, int width, int height);
 
 #ifdef GLQUAKE
+// a texture with its mip levels stored back to back
+typedef struct
+{
+	int		format;				// compressed GL internal format, 0 for RGBA
+	int		width, height;		// of the top level
+	int		numlevels;
+	int		size;				// of all levels, in bytes
+	byte	*data;
+} mipchain_t;
+
+int Image_MipLevelSize (int format, int width, int height);
+int Image_CompressedFormat (FILE *fin, int filetype);
+qboolean Image_LoadDDS (FILE *fin, char *filename, mipchain_t *chain);
+qboolean Image_LoadKTX (FILE *fin, char *filename, mipchain_t *chain);
+
 int Image_WritePCX (char *filename, byte *data, int width, int height, byte *palette);
 #else
 int Image_WritePCX (char *filename, byte *data, int width, int height, int rowbytes, byte *palette);
@@ -3371,6 +3371,7 @@ void M_Hud_Draw(void)
 	y = 64 + m_yofs;
 #ifdef GLQUAKE
 	col = StringToRGB(crosshaircolor.string);
+	Draw_Flush();
 	glDisable(GL_TEXTURE_2D);
 	glColor3ubv(col);
 	glBegin(GL_QUADS);
@@ -3844,6 +3845,7 @@ void M_ColorChooser_Draw(colorchooser_t cstype)
 	colorchooser_window.w = (24 + 17) * 8; // presume 8 pixels for each letter
 	colorchooser_window.h = ly - colorchooser_window.y + 8;
 
+	Draw_Flush();
 	glDisable(GL_TEXTURE_2D);
 	y = 96 + m_yofs;
 	for (int i = 0; i < COLORCHOOSER_PALETTE_SIZE; i++, y += 8)
@@ -3872,6 +3874,7 @@ void M_ColorChooser_Draw(colorchooser_t cstype)
 	M_Print(176, 96, "Old");
 	x = 176 + ((menuwidth - 320) >> 1);
 	y = 104 + m_yofs;
+	Draw_Flush();
 	glDisable(GL_TEXTURE_2D);
 	glColor3ubv(col);
 	glBegin(GL_QUADS);
@@ -3886,6 +3889,7 @@ void M_ColorChooser_Draw(colorchooser_t cstype)
 	M_Print(176 + square_size, 96, "New");
 	x = 176 + square_size + ((menuwidth - 320) >> 1);
 	y = 104 + m_yofs;
+	Draw_Flush();
 	glDisable(GL_TEXTURE_2D);
 	glColor3ub(red, green, blue);
 	glBegin(GL_QUADS);
@@ -4344,6 +4348,7 @@ void M_View_Draw (void)
 	x = 220 + ((menuwidth - 320) >> 1);
 	y = 88 + m_yofs;
 	col = StringToRGB(r_skycolor.string);
+	Draw_Flush();
 	glDisable(GL_TEXTURE_2D);
 	glColor3ubv(col);
 	glBegin(GL_QUADS);
@@ -4373,6 +4378,7 @@ void M_View_Draw (void)
 	x = 220 + ((menuwidth - 320) >> 1);
 	y = 136 + m_yofs;
 	col = StringToRGB(r_outline_color.string);
+	Draw_Flush();
 	glDisable(GL_TEXTURE_2D);
 	glColor3ubv(col);
 	glBegin(GL_QUADS);
@@ -8695,6 +8701,7 @@ void M_Draw (void)
 	menuwidth = 480;
 	aspect = (double)vid.height / (double)vid.width;
 	menuheight = (int)(menuwidth * aspect);
+	Draw_Flush ();
 	glMatrixMode (GL_PROJECTION);
 	glLoadIdentity ();
 	glOrtho (0, menuwidth, menuheight, 0, -99999, 99999);
@@ -8873,6 +8880,7 @@ void M_Draw (void)
 	}
 
 #ifdef GLQUAKE
+	Draw_Flush ();
 	glMatrixMode (GL_PROJECTION);
 	glLoadIdentity ();
 	glOrtho (0, vid.width, vid.height, 0, -99999, 99999);
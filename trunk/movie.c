@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "movie.h"
 #include "movie_avi.h"
 #include "screen.h"
+#include <time.h>
 
 extern	float	scr_con_current;
 extern qboolean	scr_drawloading;
@@ -56,11 +57,230 @@ cvar_t	capture_avi_split = {"capture_avi_split", "1900"};
 static qboolean movie_is_capturing = false;
 qboolean	avi_loaded, acm_loaded;
 
-static SYSTEMTIME movie_start_date; 
+static struct tm movie_start_date;
+
+// capturedemos batch
+static	char	**movie_demolist;
+static	int		movie_demolist_count, movie_demolist_next, movie_demolist_size;
 
 static int movie_avi_num_segments;
 static char movie_avi_path[256];
 
+// Frames and audio go to the AVI writer through an ordered queue that is
+// drained by a thread of its own, so the colour conversion and the (possibly
+// compressing) writes don't stall the renderer.
+#define	MOVIE_MAX_QUEUED	8		// video frames the writer may fall behind
+
+typedef struct moviepacket_s
+{
+	int			width, height;	// 0 for audio
+	int			samples;
+	byte		*data;
+	struct moviepacket_s	*next;
+} moviepacket_t;
+
+static	void			*movie_writer;
+static	void			*movie_mutex, *movie_queue_cond, *movie_space_cond;
+static	moviepacket_t	*movie_queue_head, *movie_queue_tail;
+static	int				movie_queued_frames;
+static	qboolean		movie_writer_quit;
+static	int				movie_written_bytes;
+
+#ifdef GLQUAKE
+// glReadPixels into a ring of pixel buffer objects, mapping each one a couple
+// of frames later when the transfer has finished
+#define	MOVIE_PBOS		3
+
+static	GLuint	movie_pbos[MOVIE_PBOS];
+static	int		movie_pbo_width[MOVIE_PBOS], movie_pbo_height[MOVIE_PBOS];
+static	int		movie_pbo_frames;
+static	qboolean	movie_use_pbo;
+#endif
+
+static moviepacket_t *Movie_AllocPacket (int size)
+{
+	moviepacket_t	*packet;
+
+	packet = Q_malloc (sizeof(moviepacket_t) + size);
+	packet->width = packet->height = packet->samples = 0;
+	packet->data = (byte *)(packet + 1);
+	packet->next = NULL;
+
+	return packet;
+}
+
+static void Movie_WritePacket (moviepacket_t *packet)
+{
+	int		i, size;
+	byte	*buffer, temp;
+
+	if (!packet->width)
+	{
+		Capture_WriteAudio (packet->samples, packet->data);
+		return;
+	}
+
+	buffer = packet->data;
+	size = packet->width * packet->height * 3;
+#ifdef GLQUAKE
+	ApplyGamma (buffer, size);
+#endif
+
+	// AVI wants BGR
+	for (i = 0 ; i < size ; i += 3)
+	{
+		temp = buffer[i];
+		buffer[i] = buffer[i+2];
+		buffer[i+2] = temp;
+	}
+
+	Capture_WriteVideo (packet->width, packet->height, buffer);
+}
+
+static int Movie_WriterThread (void *unused)
+{
+	moviepacket_t	*packet;
+	qboolean		video;
+
+	while (1)
+	{
+		Sys_LockMutex (movie_mutex);
+		while (!movie_queue_head && !movie_writer_quit)
+			Sys_CondWait (movie_queue_cond, movie_mutex);
+
+		// only leave once everything queued has been written
+		if (!(packet = movie_queue_head))
+		{
+			Sys_UnlockMutex (movie_mutex);
+			break;
+		}
+
+		if (!(movie_queue_head = packet->next))
+			movie_queue_tail = NULL;
+		Sys_UnlockMutex (movie_mutex);
+
+		video = packet->width != 0;
+		Movie_WritePacket (packet);
+		free (packet);
+
+		Sys_LockMutex (movie_mutex);
+		movie_written_bytes = Capture_GetNumWrittenBytes ();
+		if (video)
+		{
+			movie_queued_frames--;
+			Sys_CondSignal (movie_space_cond);
+		}
+		Sys_UnlockMutex (movie_mutex);
+	}
+
+	return 0;
+}
+
+static void Movie_QueuePacket (moviepacket_t *packet)
+{
+	Sys_LockMutex (movie_mutex);
+
+	// don't let the writer fall arbitrarily far behind, a frame is several megabytes
+	if (packet->width)
+	{
+		while (movie_queued_frames >= MOVIE_MAX_QUEUED)
+			Sys_CondWait (movie_space_cond, movie_mutex);
+		movie_queued_frames++;
+	}
+
+	if (movie_queue_tail)
+		movie_queue_tail->next = packet;
+	else
+		movie_queue_head = packet;
+	movie_queue_tail = packet;
+
+	Sys_CondSignal (movie_queue_cond);
+	Sys_UnlockMutex (movie_mutex);
+}
+
+#ifdef GLQUAKE
+static void Movie_ReadPixels (int width, int height, void *dest)
+{
+	glPixelStorei (GL_PACK_ALIGNMENT, 1);
+	glReadPixels (glx, gly, width, height, GL_RGB, GL_UNSIGNED_BYTE, dest);
+	glPixelStorei (GL_PACK_ALIGNMENT, 4);
+}
+
+static void Movie_FinishPBO (int slot)
+{
+	int				size;
+	byte			*data;
+	moviepacket_t	*packet;
+
+	size = movie_pbo_width[slot] * movie_pbo_height[slot] * 3;
+	packet = Movie_AllocPacket (size);
+	packet->width = movie_pbo_width[slot];
+	packet->height = movie_pbo_height[slot];
+
+	qglBindBuffer (GL_PIXEL_PACK_BUFFER, movie_pbos[slot]);
+	if ((data = qglMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY)))
+	{
+		memcpy (packet->data, data, size);
+		qglUnmapBuffer (GL_PIXEL_PACK_BUFFER);
+	}
+	else
+	{
+		// keep the video in sync with the audio
+		memset (packet->data, 0, size);
+	}
+	qglBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+
+	Movie_QueuePacket (packet);
+}
+
+static void Movie_FlushPBOs (void)
+{
+	int	i;
+
+	if (!movie_use_pbo)
+		return;
+
+	for (i = max(movie_pbo_frames - MOVIE_PBOS, 0) ; i < movie_pbo_frames ; i++)
+		Movie_FinishPBO (i % MOVIE_PBOS);
+
+	qglDeleteBuffers (MOVIE_PBOS, movie_pbos);
+	movie_use_pbo = false;
+}
+#endif
+
+static void Movie_BeginCapture (void)
+{
+#ifdef GLQUAKE
+	movie_use_pbo = gl_pbo_able;
+	movie_pbo_frames = 0;
+	if (movie_use_pbo)
+		qglGenBuffers (MOVIE_PBOS, movie_pbos);
+#endif
+
+	movie_written_bytes = 0;
+	movie_queued_frames = 0;
+	movie_writer_quit = false;
+	movie_writer = Sys_CreateThread (Movie_WriterThread, NULL);
+}
+
+static void Movie_EndCapture (void)
+{
+#ifdef GLQUAKE
+	Movie_FlushPBOs ();
+#endif
+
+	if (!movie_writer)
+		return;
+
+	Sys_LockMutex (movie_mutex);
+	movie_writer_quit = true;
+	Sys_CondSignal (movie_queue_cond);
+	Sys_UnlockMutex (movie_mutex);
+
+	Sys_WaitThread (movie_writer);
+	movie_writer = NULL;
+}
+
 qboolean Movie_IsActive (void)
 {
 	// don't output whilst console is down or 'loading' is displayed
@@ -99,6 +319,8 @@ void Movie_StartNewAviSegment()
 	}
 
 	movie_is_capturing = Capture_Open(path);
+	if (movie_is_capturing)
+		Movie_BeginCapture ();
 	++movie_avi_num_segments;
 }
 
@@ -124,7 +346,10 @@ void Movie_Start_f (void)
 	}
 	else
 	{
-		GetLocalTime(&movie_start_date); 
+		time_t	now;
+
+		time (&now);
+		movie_start_date = *localtime (&now);
 
 		movie_frame_count = 0;
 		movie_is_capturing = true;
@@ -137,11 +362,86 @@ void Movie_Stop (void)
 
 	if (capture_avi.value)
 	{
+		Movie_EndCapture ();
 		Capture_Close ();
 		fclose (moviefile);
 	}
 }
 
+static void Movie_ClearDemoList (void)
+{
+	int	i;
+
+	for (i = 0 ; i < movie_demolist_count ; i++)
+		free (movie_demolist[i]);
+	free (movie_demolist);
+	movie_demolist = NULL;
+	movie_demolist_count = movie_demolist_next = movie_demolist_size = 0;
+}
+
+static void Movie_AddToDemoList (char *name)
+{
+	if (movie_demolist_count == movie_demolist_size)
+	{
+		movie_demolist_size = max(movie_demolist_size * 2, 64);
+		movie_demolist = Q_realloc (movie_demolist, movie_demolist_size * sizeof(char *));
+	}
+	movie_demolist[movie_demolist_count++] = Q_strdup (name);
+}
+
+static void Movie_ReadDemoList (char *filename)
+{
+	FILE	*f;
+	char	line[MAX_OSPATH], *s, *end;
+
+	if (!(f = fopen(filename, "rt")) && !COM_IsAbsolutePath(filename))
+		f = fopen (va("%s/%s", com_basedir, filename), "rt");
+	if (!f)
+	{
+		Con_Printf ("Couldn't open %s\n", filename);
+		return;
+	}
+
+	// one demo per line, blank lines and // comments are skipped
+	while (fgets(line, sizeof(line), f))
+	{
+		for (s = line ; *s == ' ' || *s == '\t' ; s++)
+			;
+		for (end = s + strlen(s) ; end > s && (unsigned char)end[-1] <= ' ' ; end--)
+			;
+		*end = 0;
+
+		if (*s && strncmp(s, "//", 2))
+			Movie_AddToDemoList (s);
+	}
+
+	fclose (f);
+}
+
+/*
+====================
+Movie_CaptureNextDemo
+
+Starts capturing the next demo of the batch. When the list is done the
+batch is dropped, and a -headless session quits
+====================
+*/
+static void Movie_CaptureNextDemo (void)
+{
+	if (movie_demolist_next < movie_demolist_count)
+	{
+		Cbuf_AddText (va("capturedemo \"%s\"\n", movie_demolist[movie_demolist_next++]));
+		return;
+	}
+
+	Con_Printf ("Finished capturing %i demos\n", movie_demolist_count);
+	Movie_ClearDemoList ();
+
+	// "quit" would wait for cl_confirmquit with nobody there to answer
+	if (COM_CheckParm("-headless"))
+		Host_Quit ();
+}
+
 void Movie_Stop_f (void)
 {
 	if (!Movie_IsActive())
@@ -153,6 +453,7 @@ void Movie_Stop_f (void)
 	if (cls.capturedemo)
 		cls.capturedemo = false;
 
+	Movie_ClearDemoList ();
 	Movie_Stop ();
 
 	Con_Printf ("Stopped capturing\n");
@@ -170,7 +471,12 @@ void Movie_CaptureDemo_f (void)
 
 	CL_PlayDemo_f ();
 	if (!cls.demoplayback)
+	{
+		// carry on with the rest of the batch
+		if (movie_demolist)
+			Movie_CaptureNextDemo ();
 		return;
+	}
 
 	Movie_Start_f ();
 	cls.capturedemo = true;
@@ -179,6 +485,28 @@ void Movie_CaptureDemo_f (void)
 		Movie_StopPlayback ();
 }
 
+void Movie_CaptureDemos_f (void)
+{
+	int	i;
+
+	if (Cmd_Argc() < 2)
+	{
+		Con_Printf ("Usage: capturedemos <demoname | @listfile> [...]\n");
+		return;
+	}
+
+	Movie_ClearDemoList ();
+	for (i = 1 ; i < Cmd_Argc() ; i++)
+	{
+		if (Cmd_Argv(i)[0] == '@')
+			Movie_ReadDemoList (Cmd_Argv(i) + 1);
+		else
+			Movie_AddToDemoList (Cmd_Argv(i));
+	}
+
+	Movie_CaptureNextDemo ();
+}
+
 void Movie_Init (void)
 {
 	AVI_LoadLibrary ();
@@ -187,9 +515,14 @@ void Movie_Init (void)
 
 	captured_audio_samples = 0;
 
+	movie_mutex = Sys_CreateMutex ();
+	movie_queue_cond = Sys_CreateCond ();
+	movie_space_cond = Sys_CreateCond ();
+
 	Cmd_AddCommand ("capture_start", Movie_Start_f);
 	Cmd_AddCommand ("capture_stop", Movie_Stop_f);
 	Cmd_AddCommand ("capturedemo", Movie_CaptureDemo_f);
+	Cmd_AddCommand ("capturedemos", Movie_CaptureDemos_f);
 	Cvar_Register (&capture_codec);
 	Cvar_Register (&capture_fps);
 	Cvar_Register (&capture_dir);
@@ -212,6 +545,9 @@ void Movie_StopPlayback (void)
 
 	cls.capturedemo = false;
 	Movie_Stop ();
+
+	if (movie_demolist)
+		Movie_CaptureNextDemo ();
 }
 
 double Movie_FrameTime (void)
@@ -226,61 +562,82 @@ void Movie_UpdateScreen (void)
 
 	if (capture_avi.value)
 	{
-		if (capture_avi_split.value > 0 && Capture_GetNumWrittenBytes() >= capture_avi_split.value * 1024 * 1024)
+		int		written;
+
+		Sys_LockMutex (movie_mutex);
+		written = movie_written_bytes;
+		Sys_UnlockMutex (movie_mutex);
+
+		if (capture_avi_split.value > 0 && written >= capture_avi_split.value * 1024 * 1024)
 		{
 			Movie_Stop();
 			Movie_StartNewAviSegment();
+			if (!movie_is_capturing)
+				return;
 		}
 
 #ifdef GLQUAKE
-		int	i, size = glwidth * glheight * 3;
-		byte *buffer, temp;
+		moviepacket_t	*packet;
+		int		slot;
 
-		buffer = Q_malloc (size);
-		glReadPixels (glx, gly, glwidth, glheight, GL_RGB, GL_UNSIGNED_BYTE, buffer);
-		ApplyGamma (buffer, size);
-
-		for (i = 0 ; i < size ; i += 3)
+		if (!movie_use_pbo)
 		{
-			temp = buffer[i];
-			buffer[i] = buffer[i+2];
-			buffer[i+2] = temp;
+			packet = Movie_AllocPacket (glwidth * glheight * 3);
+			packet->width = glwidth;
+			packet->height = glheight;
+			Movie_ReadPixels (glwidth, glheight, packet->data);
+			Movie_QueuePacket (packet);
+			return;
 		}
+
+		// the read that used this buffer before has had two frames to complete
+		slot = movie_pbo_frames % MOVIE_PBOS;
+		if (movie_pbo_frames >= MOVIE_PBOS)
+			Movie_FinishPBO (slot);
+
+		movie_pbo_width[slot] = glwidth;
+		movie_pbo_height[slot] = glheight;
+		qglBindBuffer (GL_PIXEL_PACK_BUFFER, movie_pbos[slot]);
+		qglBufferData (GL_PIXEL_PACK_BUFFER, glwidth * glheight * 3, NULL, GL_STREAM_READ);
+		Movie_ReadPixels (glwidth, glheight, NULL);
+		qglBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+		movie_pbo_frames++;
 #else
 		int i, j, rowp;
-		byte *buffer, *p;
+		moviepacket_t	*packet;
+		byte *p;
 
-		buffer = Q_malloc (vid.width * vid.height * 3);
+		packet = Movie_AllocPacket (vid.width * vid.height * 3);
+		packet->width = vid.width;
+		packet->height = vid.height;
 
 		D_EnableBackBufferAccess ();
 
-		p = buffer;
+		p = packet->data;
 		for (i = vid.height - 1 ; i >= 0 ; i--)
 		{
 			rowp = i * vid.rowbytes;
 			for (j = 0 ; j < vid.width ; j++)
 			{
-				*p++ = current_pal[vid.buffer[rowp]*3+2];
-				*p++ = current_pal[vid.buffer[rowp]*3+1];
 				*p++ = current_pal[vid.buffer[rowp]*3+0];
+				*p++ = current_pal[vid.buffer[rowp]*3+1];
+				*p++ = current_pal[vid.buffer[rowp]*3+2];
 				rowp++;
 			}
 		}
 
 		D_DisableBackBufferAccess ();
-#endif
-
-		Capture_WriteVideo (buffer);
 
-		free (buffer);
+		Movie_QueuePacket (packet);
+#endif
 	}
 	else
 	{
 		char name[128];
 
 		Q_snprintfz(name, sizeof(name), "%s/capture_%02d-%02d-%04d_%02d-%02d-%02d/shot-%06i.tga",
-		capture_dir.string, movie_start_date.wDay, movie_start_date.wMonth, movie_start_date.wYear,
-		movie_start_date.wHour, movie_start_date.wMinute, movie_start_date.wSecond, movie_frame_count);
+		capture_dir.string, movie_start_date.tm_mday, movie_start_date.tm_mon + 1, movie_start_date.tm_year + 1900,
+		movie_start_date.tm_hour, movie_start_date.tm_min, movie_start_date.tm_sec, movie_frame_count);
 		
 		movie_frame_count++;
 		SCR_ScreenShot(name);
@@ -298,8 +655,13 @@ void Movie_TransferStereo16 (void)
 
 	if (captured_audio_samples >= Q_rint (host_frametime * shm->speed))
 	{
+		moviepacket_t	*packet;
+
 		// We have enough audio samples to match one frame of video
-		Capture_WriteAudio (captured_audio_samples, (byte *)capture_audio_samples);
+		packet = Movie_AllocPacket (captured_audio_samples * 4);
+		packet->samples = captured_audio_samples;
+		memcpy (packet->data, capture_audio_samples, captured_audio_samples * 4);
+		Movie_QueuePacket (packet);
 		captured_audio_samples = 0;
 	}
 }
@@ -391,15 +391,11 @@ void Capture_Close (void)
 	qAVIFileExit ();
 }
 
-void Capture_WriteVideo (byte *pixel_buffer)
+void Capture_WriteVideo (int width, int height, byte *pixel_buffer)
 {
 	HRESULT	hr;
 	LONG frame_bytes_written;
-#ifdef GLQUAKE
-	int	size = glwidth * glheight * 3;
-#else
-	int	size = vid.width * vid.height * 3;
-#endif
+	int	size = width * height * 3;
 
 	if (m_video_frame_size != size)
 	{
@@ -499,7 +495,7 @@ clean:
 	}
 }
 
-LONG Capture_GetNumWrittenBytes (void)
+int Capture_GetNumWrittenBytes (void)
 {
 	return m_bytes_written;
 }
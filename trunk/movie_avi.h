@@ -22,7 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 void AVI_LoadLibrary (void);
 void ACM_LoadLibrary (void);
 qboolean Capture_Open (char *filename);
-void Capture_WriteVideo (byte *pixel_buffer);
+void Capture_WriteVideo (int width, int height, byte *pixel_buffer);
 void Capture_WriteAudio (int samples, byte *sample_buffer);
 void Capture_Close (void);
-LONG Capture_GetNumWrittenBytes (void);
+int Capture_GetNumWrittenBytes (void);
@@ -0,0 +1,341 @@
+/*
+Copyright (C) 2002 Quake done Quick
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// movie_rawavi.c -- uncompressed AVI writer for systems without Video for Windows
+
+// Writes an AVI 1.0 file with a 24 bit DIB video stream and a 16 bit stereo
+// PCM audio stream, followed by an idx1 index. capture_avi_split keeps the
+// files below the 2 gigabyte limit of the format.
+
+#include "quakedef.h"
+#include "movie_avi.h"
+
+#define	AVIF_HASINDEX		0x00000010
+#define	AVIF_ISINTERLEAVED	0x00000100
+#define	AVIIF_KEYFRAME		0x00000010
+
+typedef struct
+{
+	int		ckid;
+	int		size;
+	int		offset;		// from the 'movi' fourcc
+} aviindex_t;
+
+static	FILE		*avi_file;
+static	int			avi_width, avi_height, avi_rowbytes;
+static	int			avi_video_frames, avi_audio_samples;
+static	int			avi_bytes_written;
+
+// where the sizes and counts go once they're known
+static	int			avi_riff_size_ofs, avi_movi_size_ofs, avi_movi_ofs;
+static	int			avi_total_frames_ofs, avi_video_length_ofs, avi_audio_length_ofs;
+
+static	aviindex_t	*avi_index;
+static	int			avi_numindex, avi_maxindex;
+
+static	byte		*avi_rowbuf;
+
+extern qboolean avi_loaded, acm_loaded;
+extern	cvar_t	capture_fps;
+
+#define	AVI_FOURCC(s)	((s)[0] | ((s)[1] << 8) | ((s)[2] << 16) | ((s)[3] << 24))
+
+void AVI_LoadLibrary (void)
+{
+	avi_loaded = true;
+}
+
+void ACM_LoadLibrary (void)
+{
+	// no mp3 encoder, audio is always stored as PCM
+	acm_loaded = false;
+}
+
+static void AVI_PutLong (int l)
+{
+	byte	b[4];
+
+	b[0] = l & 0xff;
+	b[1] = (l >> 8) & 0xff;
+	b[2] = (l >> 16) & 0xff;
+	b[3] = (l >> 24) & 0xff;
+	fwrite (b, 1, 4, avi_file);
+}
+
+static void AVI_PutShort (int s)
+{
+	byte	b[2];
+
+	b[0] = s & 0xff;
+	b[1] = (s >> 8) & 0xff;
+	fwrite (b, 1, 2, avi_file);
+}
+
+static void AVI_PutFourCC (char *s)
+{
+	fwrite (s, 1, 4, avi_file);
+}
+
+static void AVI_PatchLong (int ofs, int l)
+{
+	fseek (avi_file, ofs, SEEK_SET);
+	AVI_PutLong (l);
+}
+
+static void AVI_PutStreamHeader (char *type, char *handler, int scale, int rate, int samplesize, int bufsize, int *length_ofs)
+{
+	AVI_PutFourCC ("strh");
+	AVI_PutLong (56);
+	AVI_PutFourCC (type);
+	AVI_PutFourCC (handler);
+	AVI_PutLong (0);		// flags
+	AVI_PutShort (0);		// priority
+	AVI_PutShort (0);		// language
+	AVI_PutLong (0);		// initial frames
+	AVI_PutLong (scale);
+	AVI_PutLong (rate);
+	AVI_PutLong (0);		// start
+	*length_ofs = ftell (avi_file);
+	AVI_PutLong (0);		// length, patched on close
+	AVI_PutLong (bufsize);
+	AVI_PutLong (-1);		// quality
+	AVI_PutLong (samplesize);
+	AVI_PutShort (0);		// frame rectangle
+	AVI_PutShort (0);
+	AVI_PutShort (avi_width);
+	AVI_PutShort (avi_height);
+}
+
+static void AVI_AddIndex (char *ckid, int size)
+{
+	if (avi_numindex == avi_maxindex)
+	{
+		avi_maxindex = max(avi_maxindex * 2, 1024);
+		avi_index = Q_realloc (avi_index, avi_maxindex * sizeof(aviindex_t));
+	}
+
+	avi_index[avi_numindex].ckid = AVI_FOURCC(ckid);
+	avi_index[avi_numindex].size = size;
+	avi_index[avi_numindex].offset = ftell (avi_file) - avi_movi_ofs;
+	avi_numindex++;
+}
+
+qboolean Capture_Open (char *filename)
+{
+	int		fps, hdrl_ofs, strl_ofs, end;
+
+	if (!(avi_file = fopen(filename, "wb")))
+	{
+		Con_Printf ("ERROR: Couldn't open AVI file\n");
+		return false;
+	}
+
+#ifdef GLQUAKE
+	avi_width = glwidth;
+	avi_height = glheight;
+#else
+	avi_width = vid.width;
+	avi_height = vid.height;
+#endif
+	avi_rowbytes = (avi_width * 3 + 3) & ~3;	// DIB rows are 4 byte aligned
+	avi_video_frames = avi_audio_samples = 0;
+	avi_bytes_written = 0;
+	avi_numindex = 0;
+	avi_rowbuf = Q_calloc (avi_rowbytes, 1);
+
+	fps = (int)(0.5 + capture_fps.value);
+
+	AVI_PutFourCC ("RIFF");
+	avi_riff_size_ofs = ftell (avi_file);
+	AVI_PutLong (0);
+	AVI_PutFourCC ("AVI ");
+
+	AVI_PutFourCC ("LIST");
+	hdrl_ofs = ftell (avi_file);
+	AVI_PutLong (0);
+	AVI_PutFourCC ("hdrl");
+
+	AVI_PutFourCC ("avih");
+	AVI_PutLong (56);
+	AVI_PutLong (1000000 / max(fps, 1));	// microseconds per frame
+	AVI_PutLong (avi_rowbytes * avi_height * max(fps, 1) + shm->speed * 4);
+	AVI_PutLong (0);		// padding granularity
+	AVI_PutLong (AVIF_HASINDEX | AVIF_ISINTERLEAVED);
+	avi_total_frames_ofs = ftell (avi_file);
+	AVI_PutLong (0);		// total frames, patched on close
+	AVI_PutLong (0);		// initial frames
+	AVI_PutLong (2);		// streams
+	AVI_PutLong (avi_rowbytes * avi_height);
+	AVI_PutLong (avi_width);
+	AVI_PutLong (avi_height);
+	AVI_PutLong (0);
+	AVI_PutLong (0);
+	AVI_PutLong (0);
+	AVI_PutLong (0);
+
+	// video stream
+	AVI_PutFourCC ("LIST");
+	strl_ofs = ftell (avi_file);
+	AVI_PutLong (0);
+	AVI_PutFourCC ("strl");
+	AVI_PutStreamHeader ("vids", "DIB ", 1, fps, 0, avi_rowbytes * avi_height, &avi_video_length_ofs);
+	AVI_PutFourCC ("strf");
+	AVI_PutLong (40);
+	AVI_PutLong (40);		// BITMAPINFOHEADER
+	AVI_PutLong (avi_width);
+	AVI_PutLong (avi_height);	// positive, the rows are bottom up like glReadPixels
+	AVI_PutShort (1);
+	AVI_PutShort (24);
+	AVI_PutLong (0);		// BI_RGB
+	AVI_PutLong (avi_rowbytes * avi_height);
+	AVI_PutLong (0);
+	AVI_PutLong (0);
+	AVI_PutLong (0);
+	AVI_PutLong (0);
+	end = ftell (avi_file);
+	AVI_PatchLong (strl_ofs, end - strl_ofs - 4);
+	fseek (avi_file, end, SEEK_SET);
+
+	// audio stream, always 16 bit stereo in the Quake sound engine
+	AVI_PutFourCC ("LIST");
+	strl_ofs = ftell (avi_file);
+	AVI_PutLong (0);
+	AVI_PutFourCC ("strl");
+	AVI_PutStreamHeader ("auds", "\0\0\0\0", 4, shm->speed * 4, 4, shm->speed * 4, &avi_audio_length_ofs);
+	AVI_PutFourCC ("strf");
+	AVI_PutLong (18);
+	AVI_PutShort (1);		// WAVE_FORMAT_PCM
+	AVI_PutShort (2);
+	AVI_PutLong (shm->speed);
+	AVI_PutLong (shm->speed * 4);
+	AVI_PutShort (4);
+	AVI_PutShort (16);
+	AVI_PutShort (0);
+	end = ftell (avi_file);
+	AVI_PatchLong (strl_ofs, end - strl_ofs - 4);
+	AVI_PatchLong (hdrl_ofs, end - hdrl_ofs - 4);
+	fseek (avi_file, end, SEEK_SET);
+
+	AVI_PutFourCC ("LIST");
+	avi_movi_size_ofs = ftell (avi_file);
+	AVI_PutLong (0);
+	avi_movi_ofs = ftell (avi_file);
+	AVI_PutFourCC ("movi");
+
+	return true;
+}
+
+void Capture_Close (void)
+{
+	int		i, end;
+
+	if (!avi_file)
+		return;
+
+	end = ftell (avi_file);
+	AVI_PatchLong (avi_movi_size_ofs, end - avi_movi_size_ofs - 4);
+	fseek (avi_file, end, SEEK_SET);
+
+	AVI_PutFourCC ("idx1");
+	AVI_PutLong (avi_numindex * 16);
+	for (i = 0 ; i < avi_numindex ; i++)
+	{
+		AVI_PutLong (avi_index[i].ckid);
+		AVI_PutLong (AVIIF_KEYFRAME);
+		AVI_PutLong (avi_index[i].offset);
+		AVI_PutLong (avi_index[i].size);
+	}
+
+	end = ftell (avi_file);
+	AVI_PatchLong (avi_riff_size_ofs, end - 8);
+	AVI_PatchLong (avi_total_frames_ofs, avi_video_frames);
+	AVI_PatchLong (avi_video_length_ofs, avi_video_frames);
+	AVI_PatchLong (avi_audio_length_ofs, avi_audio_samples);
+
+	fclose (avi_file);
+	avi_file = NULL;
+
+	free (avi_rowbuf);
+	avi_rowbuf = NULL;
+	avi_bytes_written = 0;
+}
+
+void Capture_WriteVideo (int width, int height, byte *pixel_buffer)
+{
+	int		i, size;
+
+	if (!avi_file)
+	{
+		Con_Printf ("ERROR: Video stream is NULL\n");
+		return;
+	}
+
+	if (width != avi_width || height != avi_height)
+	{
+		Con_Printf ("ERROR: Frame size changed\n");
+		return;
+	}
+
+	size = avi_rowbytes * avi_height;
+	AVI_AddIndex ("00db", size);
+	AVI_PutFourCC ("00db");
+	AVI_PutLong (size);
+	if (avi_rowbytes == avi_width * 3)
+	{
+		fwrite (pixel_buffer, 1, size, avi_file);
+	}
+	else
+	{
+		for (i = 0 ; i < avi_height ; i++)
+		{
+			memcpy (avi_rowbuf, pixel_buffer + i * avi_width * 3, avi_width * 3);
+			fwrite (avi_rowbuf, 1, avi_rowbytes, avi_file);
+		}
+	}
+
+	avi_video_frames++;
+	avi_bytes_written += size + 8;
+}
+
+void Capture_WriteAudio (int samples, byte *sample_buffer)
+{
+	int		size;
+
+	if (!avi_file)
+	{
+		Con_Printf ("ERROR: Audio stream is NULL\n");
+		return;
+	}
+
+	size = samples * 4;
+	AVI_AddIndex ("01wb", size);
+	AVI_PutFourCC ("01wb");
+	AVI_PutLong (size);
+	fwrite (sample_buffer, 1, size, avi_file);
+	if (size & 1)
+		fputc (0, avi_file);
+
+	avi_audio_samples += samples;
+	avi_bytes_written += size + 8;
+}
+
+int Capture_GetNumWrittenBytes (void)
+{
+	return avi_bytes_written;
+}
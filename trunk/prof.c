@@ -0,0 +1,314 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// prof.c -- frame time telemetry
+
+#include "quakedef.h"
+
+#define	PROF_HISTORY		1024		// frames kept, a power of two
+
+#define	PROF_GRAPH_FRAMES	256
+#define	PROF_GRAPH_HEIGHT	64
+#define	PROF_GRAPH_SCALE	2			// graph units per millisecond
+
+typedef struct
+{
+	double	start;						// Sys_DoubleTime of the frame start
+	float	ms[NUM_PROF_TIMERS];		// accumulated over the frame
+	float	offset[NUM_PROF_TIMERS];	// from the frame start to the first Begin
+} profframe_t;
+
+static	char		*prof_names[NUM_PROF_TIMERS] = {"frame", "physics", "client", "render", "screen", "sound"};
+
+static	profframe_t	prof_history[PROF_HISTORY];
+static	int			prof_numframes;		// total recorded, the newest is prof_numframes - 1
+
+static	profframe_t	prof_current;
+static	double		prof_begin[NUM_PROF_TIMERS];
+static	qboolean	prof_running;
+
+cvar_t	host_profile = {"host_profile", "0"};
+cvar_t	show_framegraph = {"show_framegraph", "0"};
+
+void Prof_BeginFrame (void)
+{
+	int	i;
+
+	prof_running = host_profile.value || show_framegraph.value;
+	if (!prof_running)
+		return;
+
+	memset (&prof_current, 0, sizeof(prof_current));
+	for (i = 0 ; i < NUM_PROF_TIMERS ; i++)
+	{
+		prof_current.offset[i] = -1;
+		prof_begin[i] = 0;
+	}
+
+	prof_current.start = Sys_DoubleTime ();
+	prof_begin[prof_frame] = prof_current.start;
+	prof_current.offset[prof_frame] = 0;
+}
+
+void Prof_EndFrame (void)
+{
+	if (!prof_running)
+		return;
+
+	Prof_End (prof_frame);
+	prof_history[prof_numframes & (PROF_HISTORY - 1)] = prof_current;
+	prof_numframes++;
+	prof_running = false;
+}
+
+void Prof_Begin (proftimer_t timer)
+{
+	if (!prof_running)
+		return;
+
+	prof_begin[timer] = Sys_DoubleTime ();
+	if (prof_current.offset[timer] < 0)
+		prof_current.offset[timer] = (prof_begin[timer] - prof_current.start) * 1000;
+}
+
+void Prof_End (proftimer_t timer)
+{
+	if (!prof_running || !prof_begin[timer])
+		return;
+
+	prof_current.ms[timer] += (Sys_DoubleTime() - prof_begin[timer]) * 1000;
+	prof_begin[timer] = 0;
+}
+
+static profframe_t *Prof_Frame (int age)
+{
+	return &prof_history[(prof_numframes - 1 - age) & (PROF_HISTORY - 1)];
+}
+
+static int Prof_NumFrames (void)
+{
+	return min(prof_numframes, PROF_HISTORY);
+}
+
+static int Prof_CompareFloat (const void *a, const void *b)
+{
+	float	fa = *(const float *)a, fb = *(const float *)b;
+
+	return (fa > fb) - (fa < fb);
+}
+
+// over the last count frames
+static void Prof_Percentiles (proftimer_t timer, int count, float *p50, float *p99, float *max)
+{
+	int		i;
+	static	float	sorted[PROF_HISTORY];
+
+	for (i = 0 ; i < count ; i++)
+		sorted[i] = Prof_Frame(i)->ms[timer];
+	qsort (sorted, count, sizeof(float), Prof_CompareFloat);
+
+	*p50 = sorted[count / 2];
+	*p99 = sorted[min(count * 99 / 100, count - 1)];
+	*max = sorted[count - 1];
+}
+
+static void Prof_Report_f (void)
+{
+	int		i, count;
+	float	p50, p99, max;
+
+	if (!(count = Prof_NumFrames()))
+	{
+		Con_Printf ("No frames recorded, set host_profile 1 first\n");
+		return;
+	}
+
+	Con_Printf ("%i frames        p50     p99     max\n", count);
+	for (i = 0 ; i < NUM_PROF_TIMERS ; i++)
+	{
+		Prof_Percentiles (i, count, &p50, &p99, &max);
+		Con_Printf ("%-10s %7.2f %7.2f %7.2f\n", prof_names[i], p50, p99, max);
+	}
+}
+
+static void Prof_ExportCSV (FILE *f, int count)
+{
+	int			i, j;
+	profframe_t	*frame;
+
+	fprintf (f, "frame,start_ms");
+	for (j = 0 ; j < NUM_PROF_TIMERS ; j++)
+		fprintf (f, ",%s_ms", prof_names[j]);
+	fprintf (f, "\n");
+
+	for (i = count - 1 ; i >= 0 ; i--)
+	{
+		frame = Prof_Frame (i);
+		fprintf (f, "%i,%.3f", prof_numframes - 1 - i, (frame->start - Prof_Frame(count - 1)->start) * 1000);
+		for (j = 0 ; j < NUM_PROF_TIMERS ; j++)
+			fprintf (f, ",%.3f", frame->ms[j]);
+		fprintf (f, "\n");
+	}
+}
+
+// the Trace Event Format read by chrome://tracing and Perfetto
+static void Prof_ExportTrace (FILE *f, int count)
+{
+	int			i, j;
+	qboolean	first = true;
+	double		ts;
+	profframe_t	*frame;
+
+	fprintf (f, "{\"traceEvents\":[\n");
+	for (i = count - 1 ; i >= 0 ; i--)
+	{
+		frame = Prof_Frame (i);
+		for (j = 0 ; j < NUM_PROF_TIMERS ; j++)
+		{
+			if (frame->offset[j] < 0)
+				continue;
+
+			ts = (frame->start - Prof_Frame(count - 1)->start) * 1000000 + frame->offset[j] * 1000;
+			fprintf (f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.1f,\"dur\":%.1f}", first ? "" : ",\n", prof_names[j], ts, frame->ms[j] * 1000);
+			first = false;
+		}
+	}
+	fprintf (f, "\n]}\n");
+}
+
+static void Prof_Export_f (void)
+{
+	int		count;
+	char	name[MAX_OSPATH], path[MAX_OSPATH];
+	FILE	*f;
+
+	if (Cmd_Argc() != 2)
+	{
+		Con_Printf ("Usage: %s <filename.csv | filename.json>\n", Cmd_Argv(0));
+		return;
+	}
+
+	if (!(count = Prof_NumFrames()))
+	{
+		Con_Printf ("No frames recorded, set host_profile 1 first\n");
+		return;
+	}
+
+	Q_strncpyz (name, Cmd_Argv(1), sizeof(name));
+	if (Q_strcasecmp(COM_FileExtension(name), "json"))
+		COM_ForceExtension (name, ".csv");
+
+	if (COM_IsAbsolutePath(name))
+		Q_strncpyz (path, name, sizeof(path));
+	else
+		Q_snprintfz (path, sizeof(path), "%s/%s", com_basedir, name);
+
+	if (!(f = fopen(path, "wt")))
+	{
+		COM_CreatePath (path);
+		if (!(f = fopen(path, "wt")))
+		{
+			Con_Printf ("ERROR: Couldn't open %s\n", name);
+			return;
+		}
+	}
+
+	if (!Q_strcasecmp(COM_FileExtension(name), "json"))
+		Prof_ExportTrace (f, count);
+	else
+		Prof_ExportCSV (f, count);
+	fclose (f);
+
+	Con_Printf ("Wrote %i frames to %s\n", count, name);
+}
+
+// heights are in graph units, which Draw_Fill scales like the status bar
+static void Prof_DrawBar (int x, int y, float scale, float *bottom, float ms, int color)
+{
+	float	top;
+
+	if (ms <= 0)
+		return;
+
+	top = min(*bottom + ms * PROF_GRAPH_SCALE, PROF_GRAPH_HEIGHT);
+	if ((int)top > (int)*bottom)
+		Draw_Fill (x, y - (int)((int)top * scale), 1, (int)top - (int)*bottom, color);
+	*bottom = top;
+}
+
+/*
+==============
+Prof_DrawGraph
+
+One column per frame, stacked from the bottom: physics, client, render,
+the rest of the screen update, sound and whatever else is left of the frame
+==============
+*/
+void Prof_DrawGraph (void)
+{
+	int			i, x, y, count;
+	float		bottom, scale, p50, p99, max;
+	profframe_t	*frame;
+	static	double	lastupdate;
+	static	char	summary[64];
+
+	if (!show_framegraph.value || !(count = Prof_NumFrames()))
+		return;
+
+	scale = Sbar_GetScaleAmount ();
+	count = min(count, PROF_GRAPH_FRAMES);
+
+	x = 8;
+	y = vid.height - (int)(sb_lines * scale) - 8;
+
+	Draw_AlphaFill (x, y - (int)(PROF_GRAPH_HEIGHT * scale), PROF_GRAPH_FRAMES, PROF_GRAPH_HEIGHT, 0, 0.5);
+	Draw_AlphaFill (x, y - (int)(1000.0 / 60 * PROF_GRAPH_SCALE * scale), PROF_GRAPH_FRAMES, 1, 15, 0.5);	// 60 fps
+
+	for (i = 0 ; i < count ; i++)
+	{
+		frame = Prof_Frame (i);
+		bottom = 0;
+		x = 8 + (int)((count - 1 - i) * scale);
+		Prof_DrawBar (x, y, scale, &bottom, frame->ms[prof_physics], 208);
+		Prof_DrawBar (x, y, scale, &bottom, frame->ms[prof_client], 192);
+		Prof_DrawBar (x, y, scale, &bottom, frame->ms[prof_render], 251);
+		Prof_DrawBar (x, y, scale, &bottom, frame->ms[prof_screen] - frame->ms[prof_render], 60);
+		Prof_DrawBar (x, y, scale, &bottom, frame->ms[prof_sound], 224);
+		Prof_DrawBar (x, y, scale, &bottom, frame->ms[prof_frame] - frame->ms[prof_physics] - frame->ms[prof_client] - frame->ms[prof_screen] - frame->ms[prof_sound], 8);
+	}
+
+	// sorting the history every frame would show up in the graph
+	if (realtime - lastupdate > 0.5 || realtime < lastupdate)
+	{
+		Prof_Percentiles (prof_frame, Prof_NumFrames(), &p50, &p99, &max);
+		Q_snprintfz (summary, sizeof(summary), "p50 %.1f p99 %.1f max %.1f ms", p50, p99, max);
+		lastupdate = realtime;
+	}
+
+	Draw_String (8, y - (int)(PROF_GRAPH_HEIGHT * scale) - Sbar_GetScaledCharacterSize(), summary, true);
+}
+
+void Prof_Init (void)
+{
+	Cvar_Register (&host_profile);
+	Cvar_Register (&show_framegraph);
+
+	Cmd_AddCommand ("host_profile_report", Prof_Report_f);
+	Cmd_AddCommand ("host_profile_export", Prof_Export_f);
+}
@@ -0,0 +1,45 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// prof.h -- frame time telemetry
+
+// Begin/End pairs accumulate the time spent in a part of the frame, and
+// every frame the totals go into a history that can be graphed, summarized
+// with percentiles or exported. Main thread only.
+
+typedef enum
+{
+	prof_frame,			// all of _Host_Frame
+	prof_physics,		// SV_Physics
+	prof_client,		// CL_ReadFromServer
+	prof_render,		// R_RenderScene, part of prof_screen
+	prof_screen,		// SCR_UpdateScreen
+	prof_sound,			// S_Update
+	NUM_PROF_TIMERS
+} proftimer_t;
+
+void Prof_Init (void);
+
+void Prof_BeginFrame (void);
+void Prof_EndFrame (void);
+
+void Prof_Begin (proftimer_t timer);
+void Prof_End (proftimer_t timer);
+
+void Prof_DrawGraph (void);
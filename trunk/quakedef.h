@@ -239,6 +239,8 @@ typedef struct
 #include "cdaudio.h"
 #include "version.h"
 #include "image.h"
+#include "tasks.h"
+#include "prof.h"
 
 #ifdef GLQUAKE
 
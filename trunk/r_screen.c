@@ -810,6 +810,7 @@ void SCR_UpdateScreen (void)
 		SCR_CheckDrawCenterString ();
 		SCR_DrawClock ();
 		SCR_DrawFPS ();
+		Prof_DrawGraph ();
 		SCR_DrawSpeed ();
 		SCR_DrawStats ();
 		SCR_DrawVolume ();
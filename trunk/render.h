@@ -41,6 +41,19 @@ typedef struct efrag_s
 #define LERP_FINISH		(1<<4) //use lerpfinish time from server update instead of assuming interval of 0.1
 //johnfitz
 
+#ifdef GLQUAKE
+// the last R_LightPoint trace of an entity, see R_LightPointCached
+typedef struct lightcache_s
+{
+	int		generation;			// 0 = never traced
+	vec3_t	origin;
+	struct msurface_s *surf;	// lightmapped surface hit, NULL if none
+	int		ds, dt;
+	vec3_t	spot;
+	struct mplane_s *plane;
+} lightcache_t;
+#endif
+
 typedef struct entity_s
 {
 	qboolean forcelink;			// model changed
@@ -62,6 +75,8 @@ typedef struct entity_s
 	int		effects;			// light, particals, etc
 	int		skinnum;			// for Alias models
 	int		visframe;			// last frame this entity was found in an active leaf
+	int		cullframe;			// last frame culled was worked out by R_CullEntities
+	qboolean	culled;
 
 	int		dlightframe;		// dynamic lighting
 	int		dlightbits;
@@ -100,6 +115,8 @@ typedef struct entity_s
 	// nehahra support
 	float	transparency;
 	float	smokepuff_time;
+
+	lightcache_t lightcache;
 #endif
 } entity_t;
 
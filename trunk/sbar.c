@@ -382,6 +382,7 @@ void Sbar_DrawScrollString(int x, int y, int width, char *str)
 	if (cl.gametype != GAME_DEATHMATCH)
 		left += (((float)glwidth - 320.0 * scale) / 2);
 
+	Draw_Flush();
 	glEnable(GL_SCISSOR_TEST);
 	glScissor(left, 0, width * scale, glheight);
 
@@ -393,6 +394,7 @@ void Sbar_DrawScrollString(int x, int y, int width, char *str)
 	Sbar_DrawCharacter(x - ofs + len - 16, y, '/');
 	Sbar_DrawString(x - ofs + len, y, str);
 
+	Draw_Flush();
 	glDisable(GL_SCISSOR_TEST);
 }
 
@@ -29,6 +29,9 @@ void SCR_UpdateZoom (void);
 void SCR_CenterPrint (char *str);
 
 void ApplyGamma (byte *buffer, int size);
+#ifdef GLQUAKE
+void SCR_FlushScreenShots (void);
+#endif
 
 void SCR_BeginLoadingPlaque (void);
 void SCR_EndLoadingPlaque (void);
@@ -22,9 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 #include "sound.h"
 #include "winquake.h"
-#ifdef _WIN32
 #include "movie.h"
-#endif
 #include "bgmusic.h"
 #include "snd_codec.h"
 
@@ -866,10 +864,8 @@ void GetSoundtime (void)
 	int		samplepos, fullsamples;
 	static	int	buffers, oldsamplepos;
 	
-#ifdef _WIN32
 	if (Movie_GetSoundtime())
 		return;
-#endif
 
 	fullsamples = shm->samples / shm->channels;
 
@@ -897,10 +893,10 @@ void S_ExtraUpdate (void)
 {
 	extern void IN_Accumulate (void);
 
-#ifdef _WIN32
 	if (Movie_IsActive())
 		return;
 
+#ifdef _WIN32
 	IN_Accumulate ();
 #endif
 
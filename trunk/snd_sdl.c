@@ -83,6 +83,10 @@ qboolean SNDDMA_Init (void)
 	char	drivername[128];
 	char	*s;
 
+	// there is no sound device to play to, the mixer is only run for capturing
+	if (COM_CheckParm("-headless"))
+		SDL_setenv ("SDL_AUDIODRIVER", "dummy", 1);
+
 	if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0)
 	{
 		Con_Printf("Couldn't init SDL audio: %s\n", SDL_GetError());
@@ -55,3 +55,26 @@ void Sys_SetFPCW (void);
 
 char *Sys_GetClipboardData (void);
 qboolean Sys_SetClipboardData (const char *text);
+
+// threads -- handles are opaque, failing to create one is fatal
+#ifdef _MSC_VER
+#define	THREADLOCAL	__declspec(thread)
+#else
+#define	THREADLOCAL	__thread
+#endif
+
+void *Sys_CreateThread (int (*func)(void *), void *arg);
+void Sys_WaitThread (void *thread);
+unsigned long Sys_ThreadID (void);
+int Sys_NumCPUs (void);
+
+void *Sys_CreateMutex (void);
+void Sys_DestroyMutex (void *mutex);
+void Sys_LockMutex (void *mutex);
+void Sys_UnlockMutex (void *mutex);
+
+void *Sys_CreateCond (void);
+void Sys_DestroyCond (void *cond);
+void Sys_CondWait (void *cond, void *mutex);
+void Sys_CondSignal (void *cond);
+void Sys_CondBroadcast (void *cond);
@@ -41,6 +41,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <sys/wait.h>
 #include <sys/mman.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "quakedef.h"
 
@@ -94,6 +95,122 @@ void Sys_ReleaseLock (void)
 	unlink (va("%s/lock.dat", com_gamedir));
 }
 
+typedef struct
+{
+	pthread_t	handle;
+	int			(*func)(void *);
+	void		*arg;
+} sys_thread_t;
+
+static void *Sys_ThreadProc (void *arg)
+{
+	sys_thread_t	*thread = (sys_thread_t *)arg;
+
+	thread->func (thread->arg);
+
+	return NULL;
+}
+
+/*
+================
+Sys_CreateThread
+================
+*/
+void *Sys_CreateThread (int (*func)(void *), void *arg)
+{
+	sys_thread_t	*thread;
+
+	thread = Q_malloc (sizeof(sys_thread_t));
+	thread->func = func;
+	thread->arg = arg;
+	if (pthread_create(&thread->handle, NULL, Sys_ThreadProc, thread))
+		Sys_Error ("Sys_CreateThread: pthread_create failed");
+
+	return thread;
+}
+
+/*
+================
+Sys_WaitThread
+================
+*/
+void Sys_WaitThread (void *thread)
+{
+	pthread_join (((sys_thread_t *)thread)->handle, NULL);
+	free (thread);
+}
+
+unsigned long Sys_ThreadID (void)
+{
+	return (unsigned long)pthread_self ();
+}
+
+int Sys_NumCPUs (void)
+{
+	long	n = sysconf (_SC_NPROCESSORS_ONLN);
+
+	return (n < 1) ? 1 : (int)n;
+}
+
+void *Sys_CreateMutex (void)
+{
+	pthread_mutex_t	*mutex;
+
+	mutex = Q_malloc (sizeof(pthread_mutex_t));
+	if (pthread_mutex_init(mutex, NULL))
+		Sys_Error ("Sys_CreateMutex: pthread_mutex_init failed");
+
+	return mutex;
+}
+
+void Sys_DestroyMutex (void *mutex)
+{
+	pthread_mutex_destroy ((pthread_mutex_t *)mutex);
+	free (mutex);
+}
+
+void Sys_LockMutex (void *mutex)
+{
+	pthread_mutex_lock ((pthread_mutex_t *)mutex);
+}
+
+void Sys_UnlockMutex (void *mutex)
+{
+	pthread_mutex_unlock ((pthread_mutex_t *)mutex);
+}
+
+void *Sys_CreateCond (void)
+{
+	pthread_cond_t	*cond;
+
+	cond = Q_malloc (sizeof(pthread_cond_t));
+	if (pthread_cond_init(cond, NULL))
+		Sys_Error ("Sys_CreateCond: pthread_cond_init failed");
+
+	return cond;
+}
+
+void Sys_DestroyCond (void *cond)
+{
+	pthread_cond_destroy ((pthread_cond_t *)cond);
+	free (cond);
+}
+
+void Sys_CondWait (void *cond, void *mutex)
+{
+	pthread_cond_wait ((pthread_cond_t *)cond, (pthread_mutex_t *)mutex);
+}
+
+void Sys_CondSignal (void *cond)
+{
+	pthread_cond_signal ((pthread_cond_t *)cond);
+}
+
+void Sys_CondBroadcast (void *cond)
+{
+	pthread_cond_broadcast ((pthread_cond_t *)cond);
+}
+
 // =======================================================================
 // General routines
 // =======================================================================
@@ -107,6 +107,120 @@ void Sys_ReleaseLock (void)
 	_unlink (va("%s/lock.dat", com_gamedir));
 }
 
+typedef struct
+{
+	HANDLE	handle;
+	int		(*func)(void *);
+	void	*arg;
+} sys_thread_t;
+
+static DWORD WINAPI Sys_ThreadProc (LPVOID arg)
+{
+	sys_thread_t	*thread = (sys_thread_t *)arg;
+
+	return (DWORD)thread->func (thread->arg);
+}
+
+/*
+================
+Sys_CreateThread
+================
+*/
+void *Sys_CreateThread (int (*func)(void *), void *arg)
+{
+	sys_thread_t	*thread;
+
+	thread = Q_malloc (sizeof(sys_thread_t));
+	thread->func = func;
+	thread->arg = arg;
+	if (!(thread->handle = CreateThread(NULL, 0, Sys_ThreadProc, thread, 0, NULL)))
+		Sys_Error ("Sys_CreateThread: CreateThread failed");
+
+	return thread;
+}
+
+/*
+================
+Sys_WaitThread
+================
+*/
+void Sys_WaitThread (void *thread)
+{
+	WaitForSingleObject (((sys_thread_t *)thread)->handle, INFINITE);
+	CloseHandle (((sys_thread_t *)thread)->handle);
+	free (thread);
+}
+
+unsigned long Sys_ThreadID (void)
+{
+	return (unsigned long)GetCurrentThreadId ();
+}
+
+int Sys_NumCPUs (void)
+{
+	SYSTEM_INFO	info;
+
+	GetSystemInfo (&info);
+
+	return (info.dwNumberOfProcessors < 1) ? 1 : (int)info.dwNumberOfProcessors;
+}
+
+void *Sys_CreateMutex (void)
+{
+	CRITICAL_SECTION	*mutex;
+
+	mutex = Q_malloc (sizeof(CRITICAL_SECTION));
+	InitializeCriticalSection (mutex);
+
+	return mutex;
+}
+
+void Sys_DestroyMutex (void *mutex)
+{
+	DeleteCriticalSection ((CRITICAL_SECTION *)mutex);
+	free (mutex);
+}
+
+void Sys_LockMutex (void *mutex)
+{
+	EnterCriticalSection ((CRITICAL_SECTION *)mutex);
+}
+
+void Sys_UnlockMutex (void *mutex)
+{
+	LeaveCriticalSection ((CRITICAL_SECTION *)mutex);
+}
+
+void *Sys_CreateCond (void)
+{
+	CONDITION_VARIABLE	*cond;
+
+	cond = Q_malloc (sizeof(CONDITION_VARIABLE));
+	InitializeConditionVariable (cond);
+
+	return cond;
+}
+
+void Sys_DestroyCond (void *cond)
+{
+	free (cond);	// Win32 condition variables need no cleanup
+}
+
+void Sys_CondWait (void *cond, void *mutex)
+{
+	SleepConditionVariableCS ((CONDITION_VARIABLE *)cond, (CRITICAL_SECTION *)mutex, INFINITE);
+}
+
+void Sys_CondSignal (void *cond)
+{
+	WakeConditionVariable ((CONDITION_VARIABLE *)cond);
+}
+
+void Sys_CondBroadcast (void *cond)
+{
+	WakeAllConditionVariable ((CONDITION_VARIABLE *)cond);
+}
+
 /*
 ===============================================================================
 
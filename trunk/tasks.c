@@ -0,0 +1,274 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// tasks.c -- worker thread pool
+
+#include "quakedef.h"
+
+#define	MAX_WORKERS		16
+#define	DEFERPRINT_SIZE	16384
+
+typedef enum
+{
+	task_queued, task_running, task_done
+} taskstate_t;
+
+struct task_s
+{
+	taskfunc_t		func;
+	void			*data;
+	taskstate_t		state;
+	struct task_s	*next;
+};
+
+static	void	*workers[MAX_WORKERS];
+static	int		numworkers;
+static	qboolean	tasks_quit;
+
+static	void	*tasks_mutex;
+static	void	*tasks_wakeup;		// signalled when a task is queued
+static	void	*tasks_finished;	// broadcast when a task is done
+
+static	task_t	*queue_head, *queue_tail;
+
+static	unsigned long	mainthread;
+
+static	void	*deferprint_mutex;
+static	char	deferprint_buf[DEFERPRINT_SIZE];
+static	int		deferprint_len;
+
+static int Tasks_Worker (void *unused)
+{
+	task_t	*task;
+
+	Sys_LockMutex (tasks_mutex);
+	while (1)
+	{
+		while (!tasks_quit && !queue_head)
+			Sys_CondWait (tasks_wakeup, tasks_mutex);
+
+		if (tasks_quit)
+			break;
+
+		task = queue_head;
+		if (!(queue_head = task->next))
+			queue_tail = NULL;
+		task->state = task_running;
+		Sys_UnlockMutex (tasks_mutex);
+
+		task->func (task->data);
+
+		Sys_LockMutex (tasks_mutex);
+		task->state = task_done;
+		Sys_CondBroadcast (tasks_finished);
+	}
+	Sys_UnlockMutex (tasks_mutex);
+
+	return 0;
+}
+
+/*
+================
+Tasks_Init
+
+Uses one worker less than there are CPUs by default, the main thread helps
+out whenever it waits.  -threads <n> overrides the count, 0 runs everything
+on the main thread.
+================
+*/
+void Tasks_Init (void)
+{
+	int	i;
+
+	mainthread = Sys_ThreadID ();
+
+	deferprint_mutex = Sys_CreateMutex ();
+	tasks_mutex = Sys_CreateMutex ();
+	tasks_wakeup = Sys_CreateCond ();
+	tasks_finished = Sys_CreateCond ();
+
+	if ((i = COM_CheckParm("-threads")) && i + 1 < com_argc)
+		numworkers = Q_atoi(com_argv[i+1]);
+	else
+		numworkers = Sys_NumCPUs () - 1;
+	numworkers = bound(0, numworkers, MAX_WORKERS);
+
+	for (i = 0 ; i < numworkers ; i++)
+		workers[i] = Sys_CreateThread (Tasks_Worker, NULL);
+
+	Con_Printf ("Task workers: %d\n", numworkers);
+}
+
+/*
+================
+Tasks_Shutdown
+================
+*/
+void Tasks_Shutdown (void)
+{
+	int	i;
+
+	if (!tasks_mutex || !Tasks_IsMainThread())
+		return;		// Sys_Error on a worker can't join itself
+
+	Sys_LockMutex (tasks_mutex);
+	tasks_quit = true;
+	Sys_CondBroadcast (tasks_wakeup);
+	Sys_UnlockMutex (tasks_mutex);
+
+	for (i = 0 ; i < numworkers ; i++)
+		Sys_WaitThread (workers[i]);
+	numworkers = 0;
+}
+
+int Tasks_NumWorkers (void)
+{
+	return numworkers;
+}
+
+qboolean Tasks_IsMainThread (void)
+{
+	return !tasks_mutex || Sys_ThreadID () == mainthread;
+}
+
+/*
+================
+Task_Submit
+================
+*/
+task_t *Task_Submit (taskfunc_t func, void *data)
+{
+	task_t	*task;
+
+	task = Q_malloc (sizeof(task_t));
+	task->func = func;
+	task->data = data;
+	task->next = NULL;
+
+	if (!numworkers)
+	{
+		func (data);
+		task->state = task_done;
+		return task;
+	}
+
+	Sys_LockMutex (tasks_mutex);
+	task->state = task_queued;
+	if (queue_tail)
+		queue_tail->next = task;
+	else
+		queue_head = task;
+	queue_tail = task;
+	Sys_CondSignal (tasks_wakeup);
+	Sys_UnlockMutex (tasks_mutex);
+
+	return task;
+}
+
+/*
+================
+Task_Wait
+================
+*/
+void Task_Wait (task_t *task)
+{
+	task_t	**prev, *last;
+
+	if (numworkers)
+	{
+		Sys_LockMutex (tasks_mutex);
+		if (task->state == task_queued)
+		{
+			// nobody got to it yet, take it out of the queue and run it here
+			last = NULL;
+			for (prev = &queue_head ; *prev != task ; prev = &(*prev)->next)
+				last = *prev;
+			*prev = task->next;
+			if (queue_tail == task)
+				queue_tail = last;
+			Sys_UnlockMutex (tasks_mutex);
+
+			task->func (task->data);
+		}
+		else
+		{
+			while (task->state != task_done)
+				Sys_CondWait (tasks_finished, tasks_mutex);
+			Sys_UnlockMutex (tasks_mutex);
+		}
+	}
+
+	free (task);
+
+	if (Tasks_IsMainThread())
+		Tasks_Frame ();
+}
+
+/*
+================
+Tasks_DeferPrint
+
+Called by Con_Printf on worker threads, the console is main thread only
+================
+*/
+void Tasks_DeferPrint (char *msg)
+{
+	int	len;
+
+	Sys_LockMutex (deferprint_mutex);
+	len = min((int)strlen(msg), DEFERPRINT_SIZE - 1 - deferprint_len);
+	if (len > 0)
+	{
+		memcpy (deferprint_buf + deferprint_len, msg, len);
+		deferprint_len += len;
+	}
+	Sys_UnlockMutex (deferprint_mutex);
+}
+
+/*
+================
+Tasks_Frame
+
+Prints whatever the workers had to say since the last call
+================
+*/
+void Tasks_Frame (void)
+{
+	char	buf[DEFERPRINT_SIZE], *s, *e, c;
+
+	if (!deferprint_len)
+		return;
+
+	Sys_LockMutex (deferprint_mutex);
+	memcpy (buf, deferprint_buf, deferprint_len);
+	buf[deferprint_len] = 0;
+	deferprint_len = 0;
+	Sys_UnlockMutex (deferprint_mutex);
+
+	// a line at a time, Con_Printf has a smaller buffer than ours
+	for (s = buf ; *s ; s = e)
+	{
+		e = strchr (s, '\n');
+		e = e ? e + 1 : s + strlen(s);
+		c = *e;
+		*e = 0;
+		Con_Printf ("%s", s);
+		*e = c;
+	}
+}
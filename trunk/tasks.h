@@ -0,0 +1,43 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// tasks.h -- worker thread pool
+
+// Tasks must not touch the hunk, the zone, the file system search paths or
+// GL.  Con_Printf is safe to call, the text is printed by the main thread
+// on its next Tasks_Frame or Task_Wait.
+
+typedef struct task_s task_t;
+typedef void (*taskfunc_t) (void *data);
+
+void Tasks_Init (void);
+void Tasks_Shutdown (void);
+void Tasks_Frame (void);
+
+int Tasks_NumWorkers (void);
+qboolean Tasks_IsMainThread (void);
+
+// runs func(data) on a worker, or right away if there are no workers
+task_t *Task_Submit (taskfunc_t func, void *data);
+
+// blocks until the task has run, then releases the handle; a task that
+// no worker has picked up yet is run by the caller instead
+void Task_Wait (task_t *task);
+
+void Tasks_DeferPrint (char *msg);
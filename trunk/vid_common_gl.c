@@ -40,13 +40,23 @@ int			gl_textureunits = 1;
 qboolean	gl_anisotropy_able = false; //johnfitz
 float		gl_max_anisotropy; //johnfitz
 qboolean	gl_vbo_able = false;
+qboolean	gl_pbo_able = false;
 qboolean	gl_glsl_able = false;
 qboolean	gl_glsl_gamma_able = false;
 qboolean	gl_glsl_alias_able = false; //ericw
 qboolean	gl_packed_pixels = false;
 qboolean	gl_nv_depth_clamp = false;
+qboolean	gl_texture_s3tc_able = false;
+qboolean	gl_texture_bptc_able = false;
+qboolean	gl_occlusion_able = false;
 
 lpGenerateMipmapFUNC qglGenerateMipmap = NULL;
+lpCompressedTexImage2DFUNC qglCompressedTexImage2D = NULL;
+lpGenQueriesFUNC qglGenQueries = NULL;
+lpDeleteQueriesFUNC qglDeleteQueries = NULL;
+lpBeginQueryFUNC qglBeginQuery = NULL;
+lpEndQueryFUNC qglEndQuery = NULL;
+lpGetQueryObjectuivFUNC qglGetQueryObjectuiv = NULL;
 
 lpMTexFUNC	qglMultiTexCoord2f = NULL;
 lpSelTexFUNC qglActiveTexture = NULL;
@@ -55,6 +65,8 @@ lpBufferDataFUNC qglBufferData = NULL;
 lpBufferSubDataFUNC qglBufferSubData = NULL;
 lpDeleteBuffersFUNC qglDeleteBuffers = NULL;
 lpGenBuffersFUNC qglGenBuffers = NULL;
+lpMapBufferFUNC qglMapBuffer = NULL;
+lpUnmapBufferFUNC qglUnmapBuffer = NULL;
 
 lpCreateShaderFUNC qglCreateShader = NULL; //ericw
 lpDeleteShaderFUNC qglDeleteShader = NULL; //ericw
@@ -80,6 +92,7 @@ lpUniform1ivFUNC qglUniform1iv = NULL;
 lpUniform1fFUNC qglUniform1f = NULL; //ericw
 lpUniform3fFUNC qglUniform3f = NULL; //ericw
 lpUniform4fFUNC qglUniform4f = NULL; //ericw
+lpUniform4fvFUNC qglUniform4fv = NULL;
 lpUniformMatrix4fvFUNC qglUniformMatrix4fv = NULL;
 lpTexBufferFUNC qglTexBuffer = NULL;
 lpBindBufferBaseFUNC qglBindBufferBase = NULL;
@@ -127,6 +140,43 @@ void CheckGenerateMipmapExtension (void)
 	}
 }
 
+void CheckTextureCompressionExtensions (void)
+{
+	if (COM_CheckParm("-notexcompression") || gl_version_major < 2)
+		return;
+
+	if (!(qglCompressedTexImage2D = (void *)qglGetProcAddress("glCompressedTexImage2D")))
+		return;
+
+	if (CheckExtension("GL_EXT_texture_compression_s3tc"))
+	{
+		Con_Printf("S3TC texture compression found\n");
+		gl_texture_s3tc_able = true;
+	}
+	if (CheckExtension("GL_ARB_texture_compression_bptc") || gl_version_major >= 5 || (gl_version_major == 4 && gl_version_minor >= 2))
+	{
+		Con_Printf("BPTC texture compression found\n");
+		gl_texture_bptc_able = true;
+	}
+}
+
+void CheckOcclusionQueryExtensions (void)
+{
+	if (COM_CheckParm("-noocclusion") || (gl_version_major == 1 && gl_version_minor < 5))
+		return;
+
+	qglGenQueries = (void *)qglGetProcAddress("glGenQueries");
+	qglDeleteQueries = (void *)qglGetProcAddress("glDeleteQueries");
+	qglBeginQuery = (void *)qglGetProcAddress("glBeginQuery");
+	qglEndQuery = (void *)qglGetProcAddress("glEndQuery");
+	qglGetQueryObjectuiv = (void *)qglGetProcAddress("glGetQueryObjectuiv");
+	if (!qglGenQueries || !qglDeleteQueries || !qglBeginQuery || !qglEndQuery || !qglGetQueryObjectuiv)
+		return;
+
+	Con_Printf("Occlusion queries found\n");
+	gl_occlusion_able = true;
+}
+
 void CheckMultiTextureExtensions (void)
 {
 	if (!COM_CheckParm("-nomtex") && CheckExtension("GL_ARB_multitexture"))
@@ -215,6 +265,23 @@ void CheckVertexBufferExtensions(void)
 	}
 }
 
+void CheckPixelBufferExtensions (void)
+{
+	if (!gl_vbo_able || COM_CheckParm("-nopbo"))
+		return;
+
+	if (!CheckExtension("GL_ARB_pixel_buffer_object") && !(gl_version_major == 2 && gl_version_minor >= 1) && gl_version_major < 3)
+		return;
+
+	qglMapBuffer = (void *)qglGetProcAddress("glMapBufferARB");
+	qglUnmapBuffer = (void *)qglGetProcAddress("glUnmapBufferARB");
+	if (!qglMapBuffer || !qglUnmapBuffer)
+		return;
+
+	Con_Printf("Pixel buffer objects found\n");
+	gl_pbo_able = true;
+}
+
 void CheckGLSLExtensions(void)
 {
 	if (!COM_CheckParm("-noglsl") && gl_version_major >= 2)
@@ -243,6 +310,7 @@ void CheckGLSLExtensions(void)
 		qglUniform1f = (void *)qglGetProcAddress("glUniform1f");
 		qglUniform3f = (void *)qglGetProcAddress("glUniform3f");
 		qglUniform4f = (void *)qglGetProcAddress("glUniform4f");
+		qglUniform4fv = (void *)qglGetProcAddress("glUniform4fv");
 		qglUniformMatrix4fv = (void *)qglGetProcAddress("glUniformMatrix4fv");
 		qglTexBuffer = (void *)qglGetProcAddress("glTexBuffer");
 		qglBindBufferBase = (void *)qglGetProcAddress("glBindBufferBase");
@@ -273,6 +341,7 @@ void CheckGLSLExtensions(void)
 			qglUniform1f &&
 			qglUniform3f &&
 			qglUniform4f &&
+			qglUniform4fv &&
 			qglUniformMatrix4fv &&
 			qglTexBuffer &&
 			qglBindBufferBase &&
@@ -380,9 +449,12 @@ void GL_Init (void)
 
 	gl_add_ext = CheckExtension("GL_ARB_texture_env_add");
 	CheckGenerateMipmapExtension();
+	CheckTextureCompressionExtensions();
+	CheckOcclusionQueryExtensions();
 	CheckMultiTextureExtensions ();
 	CheckAnisotropicFilteringExtensions();
 	CheckVertexBufferExtensions();
+	CheckPixelBufferExtensions();
 	CheckGLSLExtensions();
 	CheckPackedPixelsExtensions();
 #if 0	//joe: removed due to causing issues in Re:Mobilize mod
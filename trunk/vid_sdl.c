@@ -71,6 +71,7 @@ static int		nummenumodes;
 static int		displayindex;
 
 static qboolean	vid_initialized = false;
+static qboolean	vid_headless = false;	// offscreen rendering, no display or input
 static cvar_t	vid_width = {"vid_width", "", CVAR_ARCHIVE};
 static cvar_t	vid_height = {"vid_height", "", CVAR_ARCHIVE};
 static cvar_t	vid_refreshrate = {"vid_refreshrate", "", CVAR_ARCHIVE};
@@ -403,7 +404,7 @@ static void SetMode (int width, int height, int refreshrate, qboolean fullscreen
 		SDL_ClearError();
 	}
 
-	if (SDL_SetRelativeMouseMode(VID_GetFullscreen() || _windowed_mouse.value != 0.0f) < 0)
+	if (!vid_headless && SDL_SetRelativeMouseMode(VID_GetFullscreen() || _windowed_mouse.value != 0.0f) < 0)
 		Sys_Error("Couldn't set mouse mode: %s", SDL_GetError());
 
 	CDAudio_Resume ();
@@ -491,7 +492,7 @@ static void VID_ForceMode_f (void)
 
 	if (vid_fullscreen.string[0] == '\0')
 		Cvar_SetValue(&vid_fullscreen, 0);
-	fullscreen = (int)vid_fullscreen.value;
+	fullscreen = (int)vid_fullscreen.value && !vid_headless;
 
 	// Check the mode set above is valid.
 	if (!VID_ValidMode(width, height, refreshrate, fullscreen))
@@ -603,7 +604,7 @@ static void VID_InitModelist (void)
 
 static qboolean OnChange_windowed_mouse (struct cvar_s *var, char *value)
 {
-	if (SDL_SetRelativeMouseMode(VID_GetFullscreen() || Q_atof (value) != 0.0f) < 0)
+	if (!vid_headless && SDL_SetRelativeMouseMode(VID_GetFullscreen() || Q_atof (value) != 0.0f) < 0)
 		Sys_Error("Couldn't set mouse mode: %s", SDL_GetError());
 	return false;
 }
@@ -630,6 +631,15 @@ void VID_Init (unsigned char *palette)
 	vid.colormap = host_colormap;
 	vid.fullbright = 256 - LittleLong (*((int *)vid.colormap + 2048));
 
+	// -headless renders into an EGL pbuffer through SDL's offscreen driver
+	// (SDL 2.0.22 or newer), which works with Mesa's software rasterizer on
+	// machines without a display or GPU
+	if (COM_CheckParm("-headless"))
+	{
+		vid_headless = true;
+		SDL_setenv ("SDL_VIDEODRIVER", "offscreen", 1);
+	}
+
 	if (SDL_InitSubSystem(SDL_INIT_VIDEO) < 0)
 		Sys_Error("Couldn't init SDL video: %s", SDL_GetError());
 